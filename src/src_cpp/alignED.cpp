@@ -1,27 +1,43 @@
 #include "alignED.hpp"
 #include "utilities.hpp"
 #include "segments.hpp"
+#include "graphlink.hpp"
+#include "routinglink.hpp"
+#include "successor.hpp"
 
 namespace AED
 {
+	/* 3 neighbors on each side of a pixel, across the 45-diagonal, vertical, 135-diagonal
+	and horizontal gradient orientation. Static, the per-pixel tests allocate nothing. */
+	static const int NEIGHBOR_DX[4][6] = {
+		{ 0, -1, -1, 0, 1, 1 }, { 1, 0, -1, -1, 0, 1 },
+		{ -1, -1, 0, 1, 1, 0 }, { -1, -1, -1, 1, 1, 1 }
+	};
+
+	static const int NEIGHBOR_DY[4][6] = {
+		{ -1, -1, 0, 1, 1, 0 }, { -1, -1, -1, 1, 1, 1 },
+		{ 0, 1, 1, 0, -1, -1 }, { -1, 0, 1, 1, 0, -1 }
+	};
+
+
 	/* @brief Pixel test for Edge Drawing. */
 	bool isAnchorED(
-		const GradientInfo* pGradInfo,
+		const GradientView& view,
 		const Pixel&        px,
 		float               anchorThresh
 	)
 	{
-		auto& gradx = pGradInfo->gradx;
-		auto& grady = pGradInfo->grady;
-		auto& mag = pGradInfo->mag;
+		auto& gradx = view.gradx;
+		auto& grady = view.grady;
+		auto& mag = view.mag;
 
 		if (px.val < MIN_GRAD_THRESH)
 			return false;
 
 		// Vertical pixel if ang < 45 degree, else horizontal
 		bool isVerticalPx =
-			std::abs(gradx.ptr<float>(px.y)[int(px.x)]) >
-			std::abs(grady.ptr<float>(px.y)[int(px.x)]);
+			std::abs(atPixel<float>(gradx, px)) >
+			std::abs(atPixel<float>(grady, px));
 
 		// initialize as current point.
 		Pixel px1(px), px2(px);
@@ -38,8 +54,8 @@ namespace AED
 
 		// if is greater than anchor threshold
 		if (px1.isInMatrix(mag) && px2.isInMatrix(mag) &&
-			px.val - anchorThresh > mag.ptr<float>(px1.y)[int(px1.x)] &&
-			px.val - anchorThresh > mag.ptr<float>(px2.y)[int(px2.x)])
+			px.val - anchorThresh > atPixel<float>(mag, px1) &&
+			px.val - anchorThresh > atPixel<float>(mag, px2))
 
 			return true;
 
@@ -47,6 +63,16 @@ namespace AED
 	}
 
 
+	bool isAnchorED(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		float               anchorThresh
+	)
+	{
+		return isAnchorED(GradientView(pGradInfo), px, anchorThresh);
+	}
+
+
 	/* @brief ED's method for anchors extraction. */
 	void extractAnchorED(
 		const GradientInfo*               pGradInfo,
@@ -57,9 +83,7 @@ namespace AED
 	{
 		anchorPixels.clear();
 
-		auto& gradx = pGradInfo->gradx;
-		auto& grady = pGradInfo->grady;
-		auto& mag = pGradInfo->mag;
+		const GradientView view(pGradInfo);
 
 		for (int ind = pxLinkLists.size() - 1; ind >= 0; --ind)
 		{
@@ -67,7 +91,7 @@ namespace AED
 			{
 				const Pixel& px = *it;
 
-				if (isAnchorED(pGradInfo, px, anchorThresh))
+				if (isAnchorED(view, px, anchorThresh))
 					anchorPixels.emplace_back(px);
 			}
 		}
@@ -92,164 +116,273 @@ namespace AED
 	{
 		alignedAnchors.clear();
 
-		auto& gradx = pGradInfo->gradx;
-		auto& grady = pGradInfo->grady;
-		auto& mag = pGradInfo->mag;
-		auto& ori = pGradInfo->ori;
+		// to avoid multiple anchors share the same pixel.
+		std::vector<bool> used(pGradInfo->gradx.rows * pGradInfo->gradx.cols, false);
 
-		PixelList localMaxPixels;
+		extractAlignedAnchors(pGradInfo, pxLinkLists, used, 
+			alignedAnchors, anchorThresh, angleTolerance);
 
-		// to avoid multiple anchors share the same pixel.
-		std::vector<bool> used(gradx.rows * gradx.cols, false);	
+		return;
+	}
 
-		for (int ind = pxLinkLists.size() - 1; ind >= 0; --ind)
+
+	/* @brief Test if a pixel is a local maximum across its gradient by at least anchorThresh.
+	Depends on magnitude and orientation only, not on extraction order. */
+	bool isAnchorCandidate(
+		const GradientView& view,
+		const Pixel&        px,
+		float               anchorThresh
+	)
+	{
+		auto& gradx = view.gradx;
+		auto& mag = view.mag;
+		auto& ori = view.ori;
+
+		// Split to 0, 45, 90, 135, 180 deg
+		const auto& gradAng = atPixel<float>(ori, px);
+
+		// split pixel to horizontal, vertical, 45-diagonal and 135-diagonal types.
+		const int* dx = NEIGHBOR_DX[3];
+		const int* dy = NEIGHBOR_DY[3];
+
+		Pixel px1, px2;	// temp variable, for local maximal
+
+		// Inspect neighbor pixels, check if it's local maximum.
+		if (gradAng >= 22.5f && gradAng < 67.5f) // 45-diagonal gradient orientation
+			dx = NEIGHBOR_DX[0], dy = NEIGHBOR_DY[0];
+		else if (gradAng >= 67.5f && gradAng < 112.5f) // vertical gradient orientation
+			dx = NEIGHBOR_DX[1], dy = NEIGHBOR_DY[1];
+		else if (gradAng >= 112.5f && gradAng < 157.5f) // 135-diagonal gradient orientation
+			dx = NEIGHBOR_DX[2], dy = NEIGHBOR_DY[2];
+
+		bool isLocalMax = true;
+
+		// Travel the top-down or left-right neighbors
+		for (int i = 0; i != 6 && isLocalMax; ++i)
 		{
-			auto it = pxLinkLists[ind].begin();
-			if (it == pxLinkLists[ind].end() || it->val < MIN_GRAD_THRESH)
-				continue;
+			// Check index if is valid
+			Pixel currPx(px.x + dx[i], px.y + dy[i]);
 
-			for (; it != pxLinkLists[ind].end(); ++it)
+			if (!currPx.isInMatrix(gradx))
+				break;
+
+			currPx.val = atPixel<float>(mag, currPx);
+
+			// Find local maximum of neighbors
+			if (i < 3 && px1.val < currPx.val)
 			{
-				const Pixel& px = *it;
+				px1 = currPx;
+			}
+			if (i >= 3 && px2.val < currPx.val)
+			{
+				px2 = currPx;
+			}
 
-				if (used[int(px.x) + int(px.y) * gradx.cols])
-					continue;
+			isLocalMax &= (px.val > currPx.val);
+		}
 
-				if (px.val < MIN_GRAD_THRESH)
-					break;
+		if (!isLocalMax || px1.val == FLT_MIN || px2.val == FLT_MIN)
+			return false;	// no valid pixels were found
+		
+		if (px.val - px1.val < anchorThresh &&
+			px.val - px2.val < anchorThresh)
+			return false;	// not local maximal
 
-				// Split to 0, 45, 90, 135, 180 deg
-				const auto& gradAng = atPixel<float>(ori, px);
+		return true;
+	}
 
-				// split pixel to horizontal, vertical, 45-diagonal and 135-diagonal types.
-				std::vector<int> dx(6);
-				std::vector<int> dy(6);
 
-				Pixel px1, px2;	// temp variable, for local maximal
-				Pixel px3, px4;	// temp variable, for aligned pixel 
+	bool isAnchorCandidate(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		float               anchorThresh
+	)
+	{
+		return isAnchorCandidate(GradientView(pGradInfo), px, anchorThresh);
+	}
 
-				// Inspect neighbor pixels, check if it's local maximum.
-				if (gradAng >= 22.5f && gradAng < 67.5f) // 45-diagonal gradient orientation
-				{
-					dx = { 0, -1, -1, 0, 1, 1 };
-					dy = { -1, -1, 0, 1, 1, 0 };
-				}
-				else if (gradAng >= 67.5f && gradAng < 112.5f) // vertical gradient orientation
-				{
-					dx = { 1, 0, -1, -1, 0, 1 };
-					dy = { -1, -1, -1, 1, 1, 1 };
-				}
-				else if (gradAng >= 112.5f && gradAng < 157.5f) // 135-diagonal gradient orientation
-				{
-					dx = { -1, -1, 0, 1, 1, 0 };
-					dy = { 0,  1, 1, 0, -1, -1 };
-				}
-				else	// horizontal gradient orientation
-				{
-					dx = { -1, -1, -1, 1, 1, 1 };
-					dy = { -1, 0, 1, 1, 0, -1 };
-				}
 
-				bool isLocalMax = true;
+	/* @brief Find the two neighbors of a candidate along its level-line, 
+	true if both exist and the candidate is aligned with one of them within angleTolerance. */
+	bool alignedNeighbors(
+		const GradientView& view,
+		const Pixel&        px,
+		Pixel&              px3,
+		Pixel&              px4,
+		float               angleTolerance
+	)
+	{
+		auto& gradx = view.gradx;
+		auto& mag = view.mag;
+		auto& ori = view.ori;
 
-				// Travel the top-down or left-right neighbors
-				for (int i = 0; i != 6 && isLocalMax; ++i)
-				{
-					// Check index if is valid
-					Pixel currPx(px.x + dx[i], px.y + dy[i]);
+		const auto& gradAng = atPixel<float>(ori, px);
 
-					if (!currPx.isInMatrix(gradx))
-						break;
+		// vertical level-line orientation if no other matches
+		const int* dx = NEIGHBOR_DX[1];
+		const int* dy = NEIGHBOR_DY[1];
 
-					currPx.val = atPixel<float>(mag, currPx);
+		px3 = Pixel(), px4 = Pixel();
 
-					// Find local maximum of neighbors
-					if (i < 3 && px1.val < currPx.val)
-					{
-						px1 = currPx;
-					}
-					if (i >= 3 && px2.val < currPx.val)
-					{
-						px2 = currPx;
-					}
+		// Inspect neighbor pixels, check if it's aligned with its neighbors.
+		if (gradAng >= 22.5f && gradAng < 67.5f) // -45-diagonal level-line orientation
+			dx = NEIGHBOR_DX[2], dy = NEIGHBOR_DY[2];
+		else if (gradAng > 67.5f && gradAng < 112.5f) // horizontal level-line orientation
+			dx = NEIGHBOR_DX[3], dy = NEIGHBOR_DY[3];
+		else if (gradAng >= 112.5f && gradAng <= 157.5f) // 45-diagonal level-line orientation
+			dx = NEIGHBOR_DX[0], dy = NEIGHBOR_DY[0];
 
-					isLocalMax &= (px.val > currPx.val);
-				}
+		for (int i = 0; i != 6; ++i)
+		{
+			// Check index if is valid
+			Pixel currPx(px.x + dx[i], px.y + dy[i]);
 
-				if (!isLocalMax || px1.val == FLT_MIN || px2.val == FLT_MIN)
-					continue;	// no valid pixels were found
-				
-				if (px.val - px1.val < anchorThresh &&
-					px.val - px2.val < anchorThresh)
-					continue;	// not local maximal
+			if (!currPx.isInMatrix(gradx))
+				break;
 
-				// Then, inspect neighbor pixels, check if it's aligned with its neighbors.
-				if (gradAng >= 22.5f && gradAng < 67.5f) // -45-diagonal level-line orientation
-				{
-					dx = { -1, -1, 0, 1, 1, 0 };
-					dy = { 0, 1, 1, 0, -1, -1 };
-				}
-				else if (gradAng > 67.5f && gradAng < 112.5f) // horizontal level-line orientation
-				{
-					dx = { -1, -1, -1, 1, 1, 1 };
-					dy = { -1, 0, 1, 1, 0, -1 };
-				}
-				else if (gradAng >= 112.5f && gradAng <= 157.5f) // 45-diagonal level-line orientation
-				{
-					dx = { 0, -1, -1, 0, 1, 1 };
-					dy = { -1, -1, 0, 1, 1, 0 };
-				}
-				else	// vertical level-line orientation
-				{
-					dx = { 1, 0, -1, -1, 0, 1 };
-					dy = { -1, -1, -1, 1, 1, 1 };
-				}
+			currPx.val = atPixel<float>(mag, currPx);
 
-				for (int i = 0; i != 6; ++i)
-				{
-					// Check index if is valid
-					Pixel currPx(px.x + dx[i], px.y + dy[i]);
+			// Find local maximum in left-right or top-down 3 connected components.
+			if (i < 3 && px3.val < currPx.val)	// top or left
+			{
+				px3 = currPx;
+			}
+			if (i >= 3 && px4.val < currPx.val)	// down or right
+			{
+				px4 = currPx;
+			}
+		}
 
-					if (!currPx.isInMatrix(gradx))
-						break;
+		// Only if valid pixel was found
+		if (px3.val == FLT_MIN || px4.val == FLT_MIN)
+			return false;
 
-					currPx.val = atPixel<float>(mag, currPx);
+		// Test if is aligned
+		const auto& ang = atPixel<float>(ori, px);
+		const auto& ang1 = atPixel<float>(ori, px3);
+		const auto& ang2 = atPixel<float>(ori, px4);
 
-					// Find local maximum in left-right or top-down 3 connected components.
-					if (i < 3 && px3.val < currPx.val)	// top or left
-					{
-						px3 = currPx;
-					}
-					if (i >= 3 && px4.val < currPx.val)	// down or right
-					{
-						px4 = currPx;
-					}
-				}
+		return angleDiff(ang, ang1) <= angleTolerance ||
+			angleDiff(ang, ang2) <= angleTolerance;
+	}
 
-				// Only if valid pixel was found or not used, then
-				if (px3.val != FLT_MIN && px4.val != FLT_MIN &&
-					used[int(px3.x) + int(px3.y) * gradx.cols] == false &&
-					used[int(px4.x) + int(px4.y) * gradx.cols] == false)
-				{
-					// Test if is aligned
-					const auto& ang = atPixel<float>(ori, px);
-					const auto& ang1 = atPixel<float>(ori, px3);
-					const auto& ang2 = atPixel<float>(ori, px4);
-
-					// if aligned, push pixel and its neighbor to vector
-					if (angleDiff(ang, ang1) <= ANG_TOLERANCE ||
-						angleDiff(ang, ang2) <= ANG_TOLERANCE)
-					{
-						alignedAnchors.emplace_back(px3);
-						alignedAnchors.emplace_back(px);
-						alignedAnchors.emplace_back(px4);
-
-						// set to used
-						used[int(px3.x) + int(px3.y) * gradx.cols] = true;
-						used[int(px.x) + int(px.y) * gradx.cols] = true;
-						used[int(px4.x) + int(px4.y) * gradx.cols] = true;
-					}
-				}
+
+	bool alignedNeighbors(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		Pixel&              px3,
+		Pixel&              px4,
+		float               angleTolerance
+	)
+	{
+		return alignedNeighbors(GradientView(pGradInfo), px, px3, px4, angleTolerance);
+	}
+
+
+	/* @brief Append a candidate and its two aligned neighbors if it is aligned with them.
+	Pixels already marked in used-map are never shared. */
+	bool appendAlignedCandidate(
+		const GradientView& view,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               angleTolerance
+	)
+	{
+		const int cols = view.gradx.width;
+
+		Pixel px3, px4;	// temp variable, for aligned pixel 
+		if (!alignedNeighbors(view, px, px3, px4, angleTolerance) ||
+			used[int(px3.x) + int(px3.y) * cols] ||
+			used[int(px4.x) + int(px4.y) * cols])
+			return false;
+
+		// if aligned and not used, push pixel and its neighbor to vector
+		alignedAnchors.emplace_back(px3);
+		alignedAnchors.emplace_back(px);
+		alignedAnchors.emplace_back(px4);
+
+		// set to used
+		used[int(px3.x) + int(px3.y) * cols] = true;
+		used[int(px.x) + int(px.y) * cols] = true;
+		used[int(px4.x) + int(px4.y) * cols] = true;
+
+		return true;
+	}
+
+
+	bool appendAlignedCandidate(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               angleTolerance
+	)
+	{
+		return appendAlignedCandidate(GradientView(pGradInfo), px, used, alignedAnchors, angleTolerance);
+	}
+
+
+	/* @brief Test a pixel for an aligned anchor, and append it with its two aligned neighbors.
+	Pixels already marked in used-map are never shared. */
+	bool appendAlignedAnchor(
+		const GradientView& view,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               anchorThresh,
+		float               angleTolerance
+	)
+	{
+		return isAnchorCandidate(view, px, anchorThresh) &&
+			appendAlignedCandidate(view, px, used, alignedAnchors, angleTolerance);
+	}
+
+
+	bool appendAlignedAnchor(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               anchorThresh,
+		float               angleTolerance
+	)
+	{
+		return appendAlignedAnchor(GradientView(pGradInfo), px, used, alignedAnchors, anchorThresh, angleTolerance);
+	}
+
+
+	/* @brief Extract aligned anchors, appending to the output. 
+	Pixels already marked in used-map are never shared by new anchors. */
+	void extractAlignedAnchors(
+		const GradientInfo*               pGradInfo,
+		const std::vector<PixelLinkList>& pxLinkLists,
+		std::vector<bool>&                used,
+		PixelList&                        alignedAnchors,
+		float                             anchorThresh,
+		float                             angleTolerance
+	)
+	{
+		const GradientView view(pGradInfo);
+		const int cols = view.gradx.width;
+
+		for (int ind = pxLinkLists.size() - 1; ind >= 0; --ind)
+		{
+			auto it = pxLinkLists[ind].begin();
+			if (it == pxLinkLists[ind].end() || it->val < MIN_GRAD_THRESH)
+				continue;
+
+			for (; it != pxLinkLists[ind].end(); ++it)
+			{
+				const Pixel& px = *it;
+
+				if (used[int(px.x) + int(px.y) * cols])
+					continue;
+
+				if (px.val < MIN_GRAD_THRESH)
+					break;
+
+				appendAlignedAnchor(view, px, used, alignedAnchors, anchorThresh, angleTolerance);
 			}
 		}
 
@@ -261,12 +394,15 @@ namespace AED
 	bool alignedDensityValidate(
 		const cv::Mat&     ori,
 		const LineSegment& seg,
-		float              densityThresh
+		float              densityThresh,
+		FrameArena*        arena
 	)
 	{
-		PixelList pixels;
+		ArenaVector<Pixel> pixels(arena);
 		bresenham(seg.begPx, seg.endPx, pixels);
 
+		const ImageView<const float> oriView(ori);
+
 		int totalNum = 0;
 		int alignedNum = 0;
 
@@ -274,10 +410,10 @@ namespace AED
 
 		for (const auto& px : pixels)
 		{
-			if (px.isInMatrix(ori))
+			if (px.isInMatrix(oriView))
 			{
 				++totalNum;
-				if (angleDiff(atPixel<float>(ori, px), gradAng) <= ANG_TOLERANCE)
+				if (angleDiff(atPixel<float>(oriView, px), gradAng) <= ANG_TOLERANCE)
 					++alignedNum;
 			}
 		}
@@ -293,6 +429,8 @@ namespace AED
 		float                         densityThresh
 	)
 	{
+		const ImageView<const float> oriView(ori);
+
 		int totalNum = 0;
 		int alignedNum = 0;
 
@@ -301,7 +439,7 @@ namespace AED
 		for (const auto& pt : pts)
 		{
 			++totalNum;
-			if (angleDiff(atPixel<float>(ori, pt), gradAng) <= ANG_TOLERANCE)
+			if (angleDiff(atPixel<float>(oriView, pt), gradAng) <= ANG_TOLERANCE)
 				++alignedNum;
 			
 		}
@@ -314,21 +452,24 @@ namespace AED
 	bool anchorDensityValidate(
 		const cv::Mat&     labels,
 		const LineSegment& seg,
-		float              densityThresh
+		float              densityThresh,
+		FrameArena*        arena
 	)
 	{
-		PixelList pixels;
+		ArenaVector<Pixel> pixels(arena);
 		bresenham(seg.begPx, seg.endPx, pixels);
 
+		const ImageView<const int> labelView(labels);
+
 		int totalNum = 0;
 		int anchorNum = 0;
 
 		for (const auto& px : pixels)
 		{
-			if (px.isInMatrix(labels))
+			if (px.isInMatrix(labelView))
 			{
 				++totalNum;
-				if (atPixel<int>(labels, px) != -1)
+				if (atPixel<int>(labelView, px) != -1)
 					++anchorNum;
 			}
 		}
@@ -339,7 +480,7 @@ namespace AED
 
 	/* @brief Walk to next pixel according to line orientation. */
 	Pixel walkToNextPixel(
-		const GradientInfo* pGradInfo,
+		const GradientView& view,
 		const cv::Vec4f&    prevLine,
 		const cv::Vec4f&    line,
 		const Pixel&        currPx,
@@ -347,91 +488,32 @@ namespace AED
 		bool&               reverseFlag
 	)
 	{
-		auto& gradx = pGradInfo->gradx;
-		auto& grady = pGradInfo->grady;
-		auto& mag = pGradInfo->mag;
-		auto& ori = pGradInfo->ori;
+		auto& mag = view.mag;
+		auto& successors = view.successors;
 
 		// line angle guided
-		double prevAng = lineAngle(prevLine, true);
-		double lineAng = lineAngle(line, true);	// [-90.0, 90.0]
-
-		if (prevAng >= -90.0 && prevAng < -67.5 && lineAng >= -67.5 && lineAng < -22.5 ||
-			prevAng >= -67.5 && prevAng < -22.5 && lineAng >= -90.0 && lineAng < -67.5)
-			reverseFlag = true;
-
-		std::vector<int> dx(3), dy(3);
-
-
-		if (lineAng >= -67.5 && lineAng < -22.5)	// -45-diagonal
-		{
-			dx = { 1, 1, 0 };
-			dy = { 0, -1, -1 };
-			if (!posDir)
-			{
-				dx = { -1, -1, 0 };
-				dy = { 0, 1, 1 };
-			}
+		int sector = walkSector(prevLine, line, posDir, reverseFlag);
+		const int* dx = SECTOR_DX[sector];
+		const int* dy = SECTOR_DY[sector];
 
-			if (reverseFlag)
-			{
-				dx = { -1, -1, 0 };
-				dy = { 0, 1, 1 };
-				if (!posDir)
-				{
-					dx = { 1, 1, 0 };
-					dy = { 0, -1, -1 };
-				}
-			}
-		}
-		else if (lineAng >= -22.5 && lineAng < 22.5)	// horizontal
-		{
-			dx = { 1, 1, 1 };
-			dy = { -1, 0, 1 };
-			if (!posDir)
-			{
-				dx = { -1, -1, -1 };
-				dy = { -1, 0, 1 };
-			}
-		}
-		else if (lineAng >= 22.5 && lineAng < 67.5)	// 45-diagonal
+		// precomputed selection, see calcSuccessorMap
+		if (!successors.empty() && currPx.isInMatrix(successors))
 		{
-			dx = { 0, 1, 1 };
-			dy = { 1, 1, 0 };
-			if (!posDir)
-			{
-				dx = { 0, -1, -1 };
-				dy = { -1, -1, 0 };
-			}
-		}
-		else // vertical
-		{
-			dx = { -1, 0, 1 };
-			dy = { 1, 1, 1 };
-			if (!posDir)
-			{
-				dx = { -1, 0, 1 };
-				dy = { -1, -1, -1 };
-			}
+			int code = successorCode(successors, int(currPx.x), int(currPx.y), sector);
+			if (code == SUCCESSOR_NONE)
+				return Pixel();
 
-			if (reverseFlag)
-			{
-				dx = { -1, 0, 1 };
-				dy = { -1, -1, -1 };
-				if (!posDir)
-				{
-					dx = { -1, 0, 1 };
-					dy = { 1, 1, 1 };
-				}
-			}
+			Pixel nextPx(currPx.x + dx[code], currPx.y + dy[code]);
+			nextPx.val = atPixel<float>(mag, nextPx);
+			return nextPx;
 		}
 
 		Pixel nextPx;
 		// Select the max one as next
-		for (int i = 0; i != dx.size(); ++i)
+		for (int i = 0; i != 3; ++i)
 		{
 			Pixel temp(currPx.x + dx[i], currPx.y + dy[i]);
-			if (!temp.isInMatrix(gradx)) 
+			if (!temp.isInMatrix(mag)) 
 				continue;
 
 			temp.val = atPixel<float>(mag, temp);
@@ -447,23 +529,49 @@ namespace AED
 	}
 
 
+	Pixel walkToNextPixel(
+		const GradientInfo* pGradInfo,
+		const cv::Vec4f&    prevLine,
+		const cv::Vec4f&    line,
+		const Pixel&        currPx,
+		bool                posDir,
+		bool&               reverseFlag
+	)
+	{
+		return walkToNextPixel(GradientView(pGradInfo), prevLine, line, currPx, posDir, reverseFlag);
+	}
+
+
+	/* @brief cv::fitLine of arena points, wrapped in place instead of copied. */
+	static void fitPoints(
+		ArenaVector<cv::Point>& points,
+		cv::Vec4f&              line
+	)
+	{
+		cv::Mat pointMat(int(points.size()), 1, CV_32SC2, points.data());
+		cv::fitLine(pointMat, line, cv::DIST_L2, 0, 0.01, 0.01);
+
+		return;
+	}
+
+
 	/* @brief Meet aligned-group which direction changed. */
 	Pixel extendAlongLineDirection(
 		const GradientInfo*     pGradInfo,
-		const cv::Mat&          labels,
-		cv::Mat&                visited,
-		const PixelList&        alignedAnchors,
-		std::vector<cv::Vec4f>& alignedLines,
+		LinkWorkspace&          ws,
 		const cv::Vec4f&        prevLine,
 		cv::Vec4f&              currLine,
-		std::vector<cv::Point>& points,
-		std::vector<bool>&      isLink,
+		ArenaVector<cv::Point>& points,
 		const Pixel&            begPx,
 		int                     remainStep,
 		bool                    posDir,
 		bool&                   reverseFlag
 	)
 	{
+		const ImageView<const int> labels(ws.labels);
+		auto& visited = ws.visited;
+		auto& groups = ws.groups;
+
 		bool isHorizontal = currLine[1] / currLine[0] <= 1.0;
 
 		int dx = isHorizontal ? 1 : 0;
@@ -485,30 +593,30 @@ namespace AED
 
 			nextPx = nextPx.round();
 
-			if (!nextPx.isInMatrix(labels) || atPixel<bool>(visited, nextPx))
+			if (!nextPx.isInMatrix(labels) || visited.test(nextPx))
 				break;	// out of range
 
 			int nextGroupInd = atPixel<int>(labels, nextPx);
-			if (nextGroupInd >= 0 && isLink[nextGroupInd] == false)
+			if (nextGroupInd >= 0 && !groups.isLink[nextGroupInd])
 			{
 				float currLineAng = lineAngle(currLine, true);
-				float candidateAng = lineAngle(alignedLines[nextGroupInd], true);
+				float candidateAng = lineAngle(groups.line(nextGroupInd), true);
 
 				// only difference between two anchor-lines is less than angle tolerance, then
 				if (angleDiff(currLineAng, candidateAng) <= ANG_TOLERANCE)
 				{
-					isLink[nextGroupInd] = true;
+					groups.isLink[nextGroupInd] = true;
 
 					// add current group of anchors to point-set and update
 					for (int i = 0; i != 3; ++i)
 					{
-						points.emplace_back(alignedAnchors[3 * nextGroupInd + i].point());
-						atPixel<bool>(visited, alignedAnchors[3 * nextGroupInd + i]) = true;
+						points.emplace_back(groups.point(nextGroupInd, i));
+						visited.set(points.back());
 					}
 
-					cv::fitLine(points, currLine, cv::DIST_L2, 0, 0.01, 0.01);
-					retPx = walkToNextPixel(pGradInfo, prevLine, currLine, 
-						alignedAnchors[3 * nextGroupInd + 1], posDir, reverseFlag);
+					fitPoints(points, currLine);
+					retPx = walkToNextPixel(ws.view, prevLine, currLine, 
+						groups.center(nextGroupInd), posDir, reverseFlag);
 					break;
 				}
 			}
@@ -672,54 +780,54 @@ namespace AED
 
 	/* @brief Link aligned anchors to other aligned anchors. */
 	LineSegment linkAlignedAnchorGroup(
-		const GradientInfo*     pGradInfo,
-		const PixelList&        alignedAnchors,
-		const cv::Mat&          labels,
-		LineSegList&            candidateSegments,
-		std::vector<cv::Vec4f>& alignedLines,
-		std::vector<bool>&      isLink,
-		int                     groupInd
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        candidateSegments,
+		int                 groupInd,
+		const LinkParams&   params
 	)
 	{
+		const ImageView<const int> labels(ws.labels);
+		const GradientView& view = ws.view;
+		auto& groups = ws.groups;
+		auto& isLink = groups.isLink;
 		if (isLink[groupInd]) 
 			return LineSegment();
 
 		bool reverseFlag = false;
 
-		auto& gradx = pGradInfo->gradx;
-		auto& grady = pGradInfo->grady;
-		auto& mag = pGradInfo->mag;
-		auto& ori = pGradInfo->ori;
+		auto& mag = view.mag;
 
 		int currGroupInd = groupInd;
 
 		// a pixel if is visted in this round
-		cv::Mat_<bool> visited(gradx.size(), false);
+		auto& visited = ws.visited;
+		visited.next();
 
 		// current linked aligned-anchor group
-		std::vector<int> linkIndices;
+		ArenaVector<int> linkIndices(&ws.arena);
 
 		// current line segment's number of aligned-group
 		int alignedCnt = 0;
 
 		// initialize points set, [cos_theta, sin_theta, x0, y0]
-		cv::Vec4f lineRes(alignedLines[groupInd]);
+		cv::Vec4f lineRes(groups.line(groupInd));
 		cv::Vec4f prevLine(lineRes);
 
-		std::vector<cv::Point> pts;	// for cv::fitLine
-		for (size_t i = 0; i != 3; ++i)
+		ArenaVector<cv::Point> pts(&ws.arena);	// for cv::fitLine
+		for (int i = 0; i != 3; ++i)
 		{
-			pts.emplace_back(alignedAnchors[3 * groupInd + i].point());
-			atPixel<bool>(visited, alignedAnchors[3 * groupInd + i]) = true;
+			pts.emplace_back(groups.point(groupInd, i));
+			visited.set(pts.back());
 		}
 
 		// 2 end-points of a line segment, initialize as the mid-point of aligned anchors.
-		Pixel endPx1(walkToNextPixel(pGradInfo, prevLine, lineRes, Pixel(pts[1]), true, reverseFlag));
-		Pixel endPx2(walkToNextPixel(pGradInfo, prevLine, lineRes, Pixel(pts[1]), false, reverseFlag));
+		Pixel endPx1(walkToNextPixel(view, prevLine, lineRes, Pixel(pts[1]), true, reverseFlag));
+		Pixel endPx2(walkToNextPixel(view, prevLine, lineRes, Pixel(pts[1]), false, reverseFlag));
 
 		// Go toward positive direction, until arriving boundary, 
 		// no remain steps, the distance of current pixel to line is greater than tolerance.
-		constexpr int REMAIN_STEPS = 7;
+		const int REMAIN_STEPS = params.remainSteps;
 		int remainSteps = REMAIN_STEPS; // steps remain
 		
 		Pixel currPx(endPx1);
@@ -727,14 +835,14 @@ namespace AED
 
 		while (remainSteps > 0)
 		{
-			Pixel nextPx(walkToNextPixel(pGradInfo, prevLine, lineRes, currPx, true, reverseFlag));
+			Pixel nextPx(walkToNextPixel(view, prevLine, lineRes, currPx, true, reverseFlag));
 
 			if (nextPx.val == FLT_MIN ||
-				atPixel<bool>(visited, nextPx))	// out of matrix or visited
+				visited.test(nextPx))	// out of matrix or visited
 				break;
 
 			// set be visted
-			atPixel<bool>(visited, nextPx) = true;
+			visited.set(nextPx);
 
 			// Calculate distance point to line
 			LineSegment tempSeg(lineRes);
@@ -748,7 +856,7 @@ namespace AED
 				// meet an ED anchor,  just put it into point-set and update line
 				pts.emplace_back(nextPx.point());
 				prevLine = lineRes;
-				cv::fitLine(pts, lineRes, cv::DIST_L2, 0, 0.01, 0.01);
+				fitPoints(pts, lineRes);
 
 				// update status
 				currPx = nextPx;
@@ -762,7 +870,7 @@ namespace AED
 			{
 				// find other not-linked aligned anchors
 				// then, check their direction if is aligned
-				const cv::Vec4f& candidateLine = alignedLines[nextGroupInd];
+				const cv::Vec4f candidateLine = groups.line(nextGroupInd);
 				
 				float currLineAng = lineAngle(lineRes, true);
 				float candidateAng = lineAngle(candidateLine, true);
@@ -773,19 +881,19 @@ namespace AED
 					// add current group of anchors to point-set and update
 					for (int i = 0; i != 3; ++i)
 					{
-						pts.emplace_back(alignedAnchors[3 * nextGroupInd + i].point());
-						atPixel<bool>(visited, alignedAnchors[3 * nextGroupInd + i]) = true;
+						pts.emplace_back(groups.point(nextGroupInd, i));
+						visited.set(pts.back());
 					}
 					prevLine = lineRes;
-					cv::fitLine(pts, lineRes, cv::DIST_L2, 0, 0.01, 0.01);
+					fitPoints(pts, lineRes);
 
 					// update status
 					isLink[groupInd] = true;	// only link to other aligned anchors
 					isLink[nextGroupInd] = true;
 					linkIndices.push_back(nextGroupInd);
 					
-					endPx1 = alignedAnchors[3 * nextGroupInd + 1];
-					currPx = walkToNextPixel(pGradInfo, prevLine, lineRes, endPx1, true, reverseFlag);
+					endPx1 = groups.center(nextGroupInd);
+					currPx = walkToNextPixel(view, prevLine, lineRes, endPx1, true, reverseFlag);
 					currGroupInd = nextGroupInd;
 
 					remainSteps = REMAIN_STEPS;
@@ -794,8 +902,8 @@ namespace AED
 				// we may meet an aligend-anchor group, but direction change
 				else
 				{
-					Pixel tempPx = extendAlongLineDirection(pGradInfo, labels, visited, alignedAnchors, 
-						alignedLines, prevLine, lineRes, pts, isLink, nextPx, REMAIN_STEPS, true, reverseFlag);
+					Pixel tempPx = extendAlongLineDirection(pGradInfo, ws,
+						prevLine, lineRes, pts, nextPx, REMAIN_STEPS, true, reverseFlag);
 
 					if (!(tempPx == Pixel()))
 					{
@@ -832,14 +940,14 @@ namespace AED
 
 		while (remainSteps > 0)
 		{
-			Pixel nextPx(walkToNextPixel(pGradInfo, prevLine, lineRes, currPx, false, reverseFlag));
+			Pixel nextPx(walkToNextPixel(view, prevLine, lineRes, currPx, false, reverseFlag));
 
 			if (nextPx.val == FLT_MIN ||
-				atPixel<bool>(visited, nextPx))	// out of matrix or visited
+				visited.test(nextPx))	// out of matrix or visited
 				break;
 
 			// set be visted
-			atPixel<bool>(visited, nextPx) = true;
+			visited.set(nextPx);
 
 			// Calculate distance point to line
 			LineSegment tempSeg(lineRes);
@@ -853,7 +961,7 @@ namespace AED
 				// meet an ED anchor,  just put it into point-set and update line
 				pts.emplace_back(nextPx.point());
 				prevLine = lineRes;
-				cv::fitLine(pts, lineRes, cv::DIST_L2, 0, 0.01, 0.01);
+				fitPoints(pts, lineRes);
 
 				// update status
 				currPx = nextPx;
@@ -868,7 +976,7 @@ namespace AED
 			{
 				// find other not-linked aligned anchors
 				// then, check their direction if is aligned
-				const cv::Vec4f& candidateLine = alignedLines[nextGroupInd];
+				const cv::Vec4f candidateLine = groups.line(nextGroupInd);
 
 				float currLineAng = lineAngle(lineRes, true);
 				float candidateAng = lineAngle(candidateLine, true);
@@ -879,18 +987,18 @@ namespace AED
 					// add current group of anchors to point-set and update
 					for (int i = 0; i != 3; ++i)
 					{
-						pts.emplace_back(alignedAnchors[3 * nextGroupInd + i].point());
-						atPixel<bool>(visited, alignedAnchors[3 * nextGroupInd + i]) = true;
+						pts.emplace_back(groups.point(nextGroupInd, i));
+						visited.set(pts.back());
 					}
 					prevLine = lineRes;
-					cv::fitLine(pts, lineRes, cv::DIST_L2, 0, 0.01, 0.01);
+					fitPoints(pts, lineRes);
 
 					// update status
 					isLink[nextGroupInd] = true;
 					linkIndices.push_back(nextGroupInd);
 
-					endPx2 = alignedAnchors[3 * nextGroupInd + 1];
-					currPx = walkToNextPixel(pGradInfo, prevLine, lineRes, endPx2, false, reverseFlag);
+					endPx2 = groups.center(nextGroupInd);
+					currPx = walkToNextPixel(view, prevLine, lineRes, endPx2, false, reverseFlag);
 
 					currGroupInd = nextGroupInd;
 
@@ -900,8 +1008,8 @@ namespace AED
 				// we may meet an aligend-anchor group, but direction change
 				else
 				{
-					Pixel tempPx = extendAlongLineDirection(pGradInfo, labels, visited, alignedAnchors,
-						alignedLines, prevLine, lineRes, pts, isLink, nextPx, REMAIN_STEPS, false, reverseFlag);
+					Pixel tempPx = extendAlongLineDirection(pGradInfo, ws,
+						prevLine, lineRes, pts, nextPx, REMAIN_STEPS, false, reverseFlag);
 
 					if (!(tempPx == Pixel()))
 					{
@@ -943,15 +1051,15 @@ namespace AED
 			segRes.endPx = Pixel(endPx2.x, retY(endPx2.x, lineRes));
 		}
 
-		// filter non-aligned segment
+		// filter non-aligned or short segment, before density validation
 		if (alignedCnt < 1 || 
-			segRes.length() < 5 || 
-			!anchorDensityValidate(labels, segRes, 0.5))
+			segRes.length() < params.minLength || 
+			!anchorDensityValidate(ws.labels, segRes, params.anchorDensity, &ws.arena))
 			return LineSegment();
 
 		// for short or weak segment
 		if (alignedCnt < 3 || 
-			!alignedDensityValidate(ori, segRes, 0.9))
+			!alignedDensityValidate(pGradInfo->ori, segRes, params.alignedDensity, &ws.arena))
 		{
 			for (auto& linkInd : linkIndices)
 				isLink[linkInd] = false;
@@ -965,69 +1073,187 @@ namespace AED
 	}
 
 
-	/* @brief My routing method. */
-	void detect(
+	/* @brief Build label map, anchor-lines and link status for linking. */
+	void initLinkWorkspace(
 		const GradientInfo* pGradInfo,
 		const PixelList&    alignedAnchors,
 		const PixelList&    edAnchors,
-		LineSegList&        lineSegments,
-		LineSegList&        candidateSegments
+		LinkWorkspace&      ws
 	)
 	{
 		auto& gradx = pGradInfo->gradx;
-		auto& grady = pGradInfo->grady;
-		auto& mag = pGradInfo->mag;
 		auto& ori = pGradInfo->ori;
 
-		/* label map, value means:
-		-1: background
-		-2: ED anchor point
-		>=0: aligned anchor point. */
-		cv::Mat_<int> labels(gradx.rows, gradx.cols, -1);
-
-		cv::Mat segmentMap = cv::Mat::zeros(gradx.size(), CV_8UC1);
+		ws.view = GradientView(pGradInfo);
+		// the map of the previous frame is cleared if the size is unchanged
+		if (ws.labels.rows == gradx.rows && ws.labels.cols == gradx.cols)
+			ws.labels.setTo(-1);
+		else
+			ws.labels = cv::Mat_<int>(gradx.rows, gradx.cols, -1);
+		ws.visited.init(gradx.size());
+		ws.arena.reset();
 
 		for (size_t ind = 0; ind != edAnchors.size(); ++ind)
 		{
 			const auto& px = edAnchors[ind];
-			labels.ptr<int>(px.y)[int(px.x)] = -2;
+			ws.labels.ptr<int>(px.y)[int(px.x)] = -2;
 		}
 
 		for (size_t ind = 0; ind != alignedAnchors.size(); ++ind)
 		{
 			const auto& px = alignedAnchors[ind];
-			labels.ptr<int>(px.y)[int(px.x)] = ind / 3;
+			ws.labels.ptr<int>(px.y)[int(px.x)] = ind / 3;
 		}
 
-		// link status
-		std::vector<bool> isLink(alignedAnchors.size() / 3, false);
+		// link status and aligned-anchor-line
+		ws.groups.assign(alignedAnchors, ori);
 
-		// aligned-anchor-line
-		std::vector<cv::Vec4f> alignedLines(isLink.size(), cv::Vec4f(0, 0, 0, 0));
-		for (size_t ind = 0; ind != alignedLines.size(); ++ind)
-		{
-			for (int i = 0; i != 3; ++i)
-			{
-				const auto& ang = atPixel<float>(ori, alignedAnchors[3 * ind + i]) - 90.0;
+		return;
+	}
 
-				alignedLines[ind][0] += std::cos(ang * CV_PI / 180.0);
-				alignedLines[ind][1] += std::sin(ang * CV_PI / 180.0);
-			}
-			// middle pixel as init point
-			alignedLines[ind][2] = alignedAnchors[3 * ind + 1].x;
-			alignedLines[ind][3] = alignedAnchors[3 * ind + 1].y;	
-		}
 
-		for (int groupInd = 0; groupInd != isLink.size(); ++groupInd)
+	/* @brief Link the given seed groups in order. */
+	void linkSeeds(
+		const GradientInfo*     pGradInfo,
+		LinkWorkspace&          ws,
+		const std::vector<int>& seeds,
+		LineSegList&            lineSegments,
+		LineSegList&            candidateSegments,
+		const LinkParams&       params
+	)
+	{
+		for (int groupInd : seeds)
 		{
 			LineSegment seg = linkAlignedAnchorGroup(
-				pGradInfo, alignedAnchors, labels, 
-				candidateSegments, alignedLines, isLink, groupInd);
+				pGradInfo, ws, candidateSegments, groupInd, params);
 
-			if(seg != LineSegment())
+			if (seg != LineSegment())
 				lineSegments.emplace_back(seg);
 		}
 
+		return;
+	}
+
+
+	/* @brief Link all groups in anchor-extraction order by the sequential walk. */
+	void linkWalk(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	)
+	{
+		std::vector<int> seeds(ws.groups.size());
+		for (int groupInd = 0; groupInd != seeds.size(); ++groupInd)
+			seeds[groupInd] = groupInd;
+
+		linkSeeds(pGradInfo, ws, seeds, lineSegments, candidateSegments, params);
+
+		return;
+	}
+
+
+	// engines by LinkEngineType
+	static const struct
+	{
+		LinkEngine  engine;
+		const char* name;
+	} LINK_ENGINES[] = {
+		{ linkWalk, "walk" },
+		{ linkGraph, "graph" },
+		{ linkRouting, "routing" }
+	};
+
+	constexpr int NUM_LINK_ENGINES = sizeof(LINK_ENGINES) / sizeof(LINK_ENGINES[0]);
+
+
+	/* @brief Engine of the type, the walk for an unknown type. */
+	LinkEngine getLinkEngine(LinkEngineType engine)
+	{
+		if (engine < 0 || engine >= NUM_LINK_ENGINES)
+			return linkWalk;
+
+		return LINK_ENGINES[engine].engine;
+	}
+
+
+	/* @brief Name of the engine. */
+	const char* linkEngineName(LinkEngineType engine)
+	{
+		if (engine < 0 || engine >= NUM_LINK_ENGINES)
+			return "unknown";
+
+		return LINK_ENGINES[engine].name;
+	}
+
+
+	/* @brief Engine type by its name. */
+	bool parseLinkEngine(
+		const std::string& name,
+		LinkEngineType&    engine
+	)
+	{
+		for (int ind = 0; ind != NUM_LINK_ENGINES; ++ind)
+		{
+			if (name == LINK_ENGINES[ind].name)
+			{
+				engine = LinkEngineType(ind);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+
+	/* @brief Link the groups of a workspace by the engine of params. */
+	void linkGroups(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	)
+	{
+		getLinkEngine(params.engine)(pGradInfo, ws, lineSegments, candidateSegments, params);
+
+		return;
+	}
+
+
+	/* @brief My routing method. */
+	void detect(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	)
+	{
+		LinkWorkspace ws;
+		detect(pGradInfo, alignedAnchors, edAnchors, ws, lineSegments, candidateSegments, params);
+
+		return;
+	}
+
+
+	/* @brief My routing method on a kept workspace. */
+	void detect(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	)
+	{
+		initLinkWorkspace(pGradInfo, alignedAnchors, edAnchors, ws);
+
+		linkGroups(pGradInfo, ws, lineSegments, candidateSegments, params);
+
 		//for (int groupInd = 0; groupInd != isLink.size(); ++groupInd)
 		//{
 		//	LineSegment seg = linkPixels(
@@ -1043,17 +1269,29 @@ namespace AED
 	/* @brief Validate candidate line segments. */
 	void validateCandidateSegments(
 		const GradientInfo* pGradInfo,
-		LineSegList&        candidateSegments
+		LineSegList&        candidateSegments,
+		FrameArena*         arena
 	)
 	{
 		auto& mag = pGradInfo->mag;
 
+		const ImageView<const float> magView(mag);
+
+		FrameArena localArena;
+		if (arena == nullptr)
+			arena = &localArena;
+
 		LineSegList remains;
 
+		// scratch of all segments, cleared per segment and grown in the arena
+		ArenaVector<double> rectData(arena);
+		ArenaVector<double> segData(arena);
+		ArenaVector<Pixel> pixels(arena);
+
 		for (const auto& segment : candidateSegments)
 		{
-			std::vector<double> rectData;
-			std::vector<double> segData;
+			rectData.clear();
+			segData.clear();
 
 			cv::Rect rect = segmentBoundingRect(mag.size(), segment);
 
@@ -1062,28 +1300,24 @@ namespace AED
 			if (!getMeanStd<float>(mag, rect, rectMean, rectStd))
 				continue;
 
-			size_t sz = rect.width * rect.height;
-			float* ptr = (float*)mag.ptr<float>();
-
-
-			for (int row = rect.y; row < rect.y + rect.height; ++row)
+			rectData.resize(size_t(rect.width) * rect.height);
+			for (int row = 0; row != rect.height; ++row)
 			{
-				for (int col = rect.x; col < rect.x + rect.width; ++col)
-				{
-					rectData.push_back(mag.ptr<float>(row)[col]);
-				}
+				const float* ptr = magView.row(rect.y + row) + rect.x;
+				double* dst = rectData.data() + size_t(row) * rect.width;
+				for (int col = 0; col != rect.width; ++col)
+					dst[col] = ptr[col];
 			}
 
 			double segMean = 0.0;
 			double segStd = 0.0;
-			PixelList pixels;
 			bresenham(segment.begPx, segment.endPx, pixels);
 			for (const auto& px : pixels)
 			{
-				if (px.isInMatrix(mag))
+				if (px.isInMatrix(magView))
 				{
-					segData.push_back(atPixel<float>(mag, px));
-					segMean += atPixel<float>(mag, px);
+					segData.push_back(atPixel<float>(magView, px));
+					segMean += atPixel<float>(magView, px);
 				}
 
 			}
@@ -1091,9 +1325,9 @@ namespace AED
 
 			for (const auto& px : pixels)
 			{
-				if (px.isInMatrix(mag))
-					segStd += (atPixel<float>(mag, px) - segMean) * 
-						(atPixel<float>(mag, px) - segMean);
+				if (px.isInMatrix(magView))
+					segStd += (atPixel<float>(magView, px) - segMean) * 
+						(atPixel<float>(magView, px) - segMean);
 			}
 			segStd = std::sqrt(segStd / pixels.size());
 
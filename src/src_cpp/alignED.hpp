@@ -5,6 +5,7 @@
 #include <opencv2/opencv.hpp>
 #include "utilities.hpp"
 #include "segments.hpp"
+#include "anchorgroups.hpp"
 
 
 namespace AED
@@ -16,6 +17,95 @@ namespace AED
 	};
 
 
+	/* @brief Pixels visited by the current walk. A new walk advances the stamp
+	instead of clearing the map, so one map serves all walks of all frames of a size. */
+	struct VisitMap
+	{
+		cv::Mat_<int>  stamps;
+		ImageView<int> view;	// of stamps
+		int            stamp = 0;
+
+		/* @brief Fit the map to the image size, keeps it if the size is unchanged. */
+		void init(const cv::Size& size)
+		{
+			if (stamps.size() == size)
+				return;
+
+			stamps = cv::Mat_<int>(size.height, size.width, 0);
+			view = ImageView<int>(stamps);
+			stamp = 0;
+		}
+
+		/* @brief Start a new walk, no pixel is visited. */
+		void next()
+		{
+			if (++stamp == INT_MAX)
+				stamps.setTo(0), stamp = 1;
+		}
+
+		bool test(const Pixel& px) const { return view(int(px.x), int(px.y)) == stamp; }
+
+		bool test(const cv::Point& pt) const { return view(pt) == stamp; }
+
+		void set(const Pixel& px) { view(int(px.x), int(px.y)) = stamp; }
+
+		void set(const cv::Point& pt) { view(pt) = stamp; }
+	};
+
+
+	/* @brief Linking state shared by different seeding strategies. */
+	struct LinkWorkspace
+	{
+		/* label map, value means:
+		-1: background
+		-2: ED anchor point
+		>=0: aligned anchor point. */
+		cv::Mat_<int> labels;
+
+		// anchor pixels, anchor-lines and link status of each group
+		AnchorGroups groups;
+
+		// typed views of the frame's gradient maps
+		GradientView view;
+
+		// visited pixels of the current walk
+		VisitMap visited;
+
+		// scratch of walks and validation, released by initLinkWorkspace at frame start
+		FrameArena arena;
+	};
+
+
+	/* @brief Linking engines. */
+	enum LinkEngineType
+	{
+		LINK_WALK = 0,	// sequential direction-guided walk from each seed group
+		LINK_GRAPH,		// union-find over a compatibility graph of groups, see graphlink.hpp
+		LINK_ROUTING	// extend-and-jump routing from each seed group, see routinglink.hpp
+	};
+
+
+	/* @brief Parameters of linking and validation. */
+	struct LinkParams
+	{
+		LinkEngineType engine = LINK_WALK;
+
+		// steps a walk goes on without meeting an anchor
+		int remainSteps = 7;
+
+		// density thresholds of anchors and aligned points along a segment
+		float anchorDensity = 0.5f;
+		float alignedDensity = 0.9f;
+
+		// shorter segments are dropped before density validation
+		float minLength = 5.0f;
+
+		// build the successor map right after the gradient, see successor.hpp;
+		// read by the pipelines that compute the gradient, walks use any map the frame has
+		bool useSuccessors = false;
+	};
+
+
 	/* @brief Pixel test for Edge Drawing. */
 	bool isAnchorED(
 		const GradientInfo* pGradInfo,
@@ -23,6 +113,12 @@ namespace AED
 		float               anchorThresh
 	);
 
+	bool isAnchorED(
+		const GradientView& view,
+		const Pixel&        px,
+		float               anchorThresh
+	);
+
 
 	/* @brief ED's method for anchors extraction. */
 	void extractAnchorED(
@@ -44,12 +140,107 @@ namespace AED
 	);
 
 
+	/* @brief Test if a pixel is a local maximum across its gradient by at least anchorThresh.
+	Depends on magnitude and orientation only, not on extraction order. */
+	extern
+	bool isAnchorCandidate(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		float               anchorThresh
+	);
+
+	bool isAnchorCandidate(
+		const GradientView& view,
+		const Pixel&        px,
+		float               anchorThresh
+	);
+
+
+	/* @brief Find the two neighbors of a candidate along its level-line, 
+	true if both exist and the candidate is aligned with one of them within angleTolerance.
+	Depends on magnitude and orientation only, not on extraction order. */
+	extern
+	bool alignedNeighbors(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		Pixel&              px3,
+		Pixel&              px4,
+		float               angleTolerance = 22.5f
+	);
+
+	bool alignedNeighbors(
+		const GradientView& view,
+		const Pixel&        px,
+		Pixel&              px3,
+		Pixel&              px4,
+		float               angleTolerance = 22.5f
+	);
+
+
+	/* @brief Append a candidate and its two aligned neighbors if it is aligned with them.
+	Pixels already marked in used-map are never shared.
+	* @return true if the anchor was appended. */
+	extern
+	bool appendAlignedCandidate(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               angleTolerance = 22.5f
+	);
+
+	bool appendAlignedCandidate(
+		const GradientView& view,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               angleTolerance = 22.5f
+	);
+
+
+	/* @brief Test a pixel for an aligned anchor, and append it with its two aligned neighbors.
+	Pixels already marked in used-map are never shared.
+	* @return true if the anchor was appended. */
+	extern
+	bool appendAlignedAnchor(
+		const GradientInfo* pGradInfo,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               anchorThresh,
+		float               angleTolerance = 22.5f
+	);
+
+	bool appendAlignedAnchor(
+		const GradientView& view,
+		const Pixel&        px,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               anchorThresh,
+		float               angleTolerance = 22.5f
+	);
+
+
+	/* @brief Extract aligned anchors, appending to the output. 
+	Pixels already marked in used-map are never shared by new anchors. */
+	extern
+	void extractAlignedAnchors(
+		const GradientInfo*               pGradInfo,
+		const std::vector<PixelLinkList>& pxLinkLists,
+		std::vector<bool>&                used,
+		PixelList&                        alignedAnchors,
+		float                             anchorThresh = 3.0f,
+		float                             angleTolerance = 22.5f
+	);
+
+
 	/* @brief Validate a line by its aligned-point density. */
 	extern
 	bool alignedDensityValidate(
 		const cv::Mat&     ori,
 		const LineSegment& seg,
-		float              densityThresh = 0.7f
+		float              densityThresh = 0.7f,
+		FrameArena*        arena = nullptr
 	);
 
 	bool alignedDensityValidate(
@@ -65,7 +256,8 @@ namespace AED
 	bool anchorDensityValidate(
 		const cv::Mat&     labels,
 		const LineSegment& seg,
-		float              densityThresh = 0.55f
+		float              densityThresh = 0.55f,
+		FrameArena*        arena = nullptr
 	);
 
 	
@@ -80,19 +272,24 @@ namespace AED
 		bool&               reverseFlag
 	);
 
+	Pixel walkToNextPixel(
+		const GradientView& view,
+		const cv::Vec4f&    prevLine,
+		const cv::Vec4f&    line,
+		const Pixel&        currPx,
+		bool                posDir,
+		bool&               reverseFlag
+	);
+
 
 	/* @brief Meet aligned-group which direction changed. */
 	extern
 	Pixel extendAlongLineDirection(
 		const GradientInfo*     pGradInfo,
-		const cv::Mat&          labels,
-		cv::Mat&                visited,
-		const PixelList&        alignedAnchors,
-		std::vector<cv::Vec4f>& alignedLines,
+		LinkWorkspace&          ws,
 		const cv::Vec4f&        prevLine,
 		cv::Vec4f&              currLine,
-		std::vector<cv::Point>& points,
-		std::vector<bool>&      isLink,
+		ArenaVector<cv::Point>& points,
 		const Pixel&            begPx,
 		int                     remainStep,
 		bool                    posDir,
@@ -100,17 +297,15 @@ namespace AED
 	);
 
 
-	/* @brief Link aligned anchors to other aligned anchors. */
+	/* @brief Link aligned anchors to other aligned anchors.
+	Visited pixels and scratch points live in the workspace, a walk allocates nothing once warm. */
 	extern
 	LineSegment linkAlignedAnchorGroup(
-		const GradientInfo*     pGradInfo,
-		const PixelList&        alignedAnchors,
-		cv::Mat&                visited,
-		const cv::Mat&          labels,
-		LineSegList&            candidateSegments,
-		std::vector<cv::Vec4f>& alignedLines,
-		std::vector<bool>&      isLink,
-		int                     groupInd
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        candidateSegments,
+		int                 groupInd,
+		const LinkParams&   params = LinkParams()
 	);
 
 
@@ -126,8 +321,119 @@ namespace AED
 	);
 
 
-	/* @brief Merge near line segment */
+	/* @brief Parameters of merging near collinear segments. */
+	struct MergeParams
+	{
+		// max difference of segment angles, in degree
+		float angleTolerance = 5.0f;
+
+		// max distance of the shorter segment's end-points to the longer one's line
+		float distTolerance = float(DIST_TOLERANCE);
+
+		// max gap between the two segments along the line, overlapping is gap 0
+		float maxGap = 7.0f;
+
+		// aligned-point density of a merged segment
+		float alignedDensity = 0.7f;
+	};
+
+
+	/* @brief Counts and time of a merging run. */
+	struct MergeStats
+	{
+		size_t numInput = 0;
+		size_t numOutput = 0;
+		size_t numMerged = 0;	// merges accepted
+		size_t numRejected = 0;	// collinear pairs whose merged segment failed validation
+		double ms = 0.0;
+	};
+
 
+	/* @brief Merge near line segment.
+	Segments are bucketed by cell and angle in a hash grid, only pairs sharing a bucket
+	neighborhood are tested. Merged segments are re-validated by aligned-point density. */
+	extern
+	void mergeCollinearSegments(
+		const GradientInfo* pGradInfo,
+		LineSegList&        lineSegments,
+		const MergeParams&  params = MergeParams(),
+		MergeStats*         stats = nullptr
+	);
+
+
+	/* @brief Build label map, anchor-lines and link status for linking,
+	and release the scratch of the previous frame. */
+	extern
+	void initLinkWorkspace(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		LinkWorkspace&      ws
+	);
+
+
+	/* @brief Link the given seed groups in order. */
+	extern
+	void linkSeeds(
+		const GradientInfo*     pGradInfo,
+		LinkWorkspace&          ws,
+		const std::vector<int>& seeds,
+		LineSegList&            lineSegments,
+		LineSegList&            candidateSegments,
+		const LinkParams&       params = LinkParams()
+	);
+
+
+	/* @brief Link all groups in anchor-extraction order by the sequential walk. */
+	extern
+	void linkWalk(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params = LinkParams()
+	);
+
+
+	/* @brief Interface of linking engines: link the groups of a workspace built by initLinkWorkspace,
+	append line segments and candidates. An engine changes only link status, visit map and arena,
+	so engines can be compared on one workspace by restoring the link status in between. */
+	typedef void (*LinkEngine)(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	);
+
+
+	/* @brief Engine of the type, the walk for an unknown type. */
+	extern
+	LinkEngine getLinkEngine(LinkEngineType engine);
+
+
+	/* @brief Name of the engine: "walk", "graph" or "routing". */
+	extern
+	const char* linkEngineName(LinkEngineType engine);
+
+
+	/* @brief Engine type by its name, false if unknown. */
+	extern
+	bool parseLinkEngine(
+		const std::string& name,
+		LinkEngineType&    engine
+	);
+
+
+	/* @brief Link the groups of a workspace by the engine of params. */
+	extern
+	void linkGroups(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params = LinkParams()
+	);
 
 
 	/* @brief My routing method. */
@@ -137,24 +443,44 @@ namespace AED
 		const PixelList&    alignedAnchors,
 		const PixelList&    normalAnchors,
 		LineSegList&        lineSegments,
-		LineSegList&        candidateSegments
+		LineSegList&        candidateSegments,
+		const LinkParams&   params = LinkParams()
+	);
+
+
+	/* @brief My routing method on a kept workspace, whose label map, visit map and arena
+	are reused across frames of the same size. */
+	extern
+	void detect(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    normalAnchors,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params = LinkParams()
 	);
 
 
-	/* @brief Validate candidate line segments. */
+	/* @brief Validate candidate line segments.
+	* @param arena: scratch of the statistics, a local arena is used if null. */
 	extern
 	void validateCandidateSegments(
 		const GradientInfo* pGradInfo,
-		LineSegList&        candidateSegments
+		LineSegList&        candidateSegments,
+		FrameArena*         arena = nullptr
 	);
 
 
-	/* @brief Pseudo-sort the input image's each pixel. */
+	/* @brief Pseudo-sort the input image's each pixel.
+	* @param magRange: magnitudes at or above it fall into the last bin,
+	L1 magnitude of MASK2x2 reaches 510. */
 	template <typename T = float>
 	void pseudoSort(
-		const cv::Mat& src,
+		const cv::Mat&              src,
 		std::vector<PixelLinkList>& pxLists,
-		int                         bins = 1024
+		int                         bins = 1024,
+		double                      magRange = 255.0
 	)
 	{
 		if (src.empty() || src.channels() > 1)
@@ -163,21 +489,22 @@ namespace AED
 		pxLists.clear();
 		pxLists.resize(bins);
 
-		// max gradient magnitude is set to 255.
-		double binStep = 255.0 / bins;
+		double binStep = magRange / bins;
 
-		const T* ptr = (T*)src.ptr<T>();
-		size_t sz = src.rows * src.cols;
+		const ImageView<const T> view(src);
 
-		for (size_t ind = 0; ind != sz; ++ind)
+		for (int y = 0; y != view.height; ++y)
 		{
-			const auto& val = ptr[ind];
+			const T* ptr = view.row(y);
+			for (int x = 0; x != view.width; ++x)
+			{
+				const auto& val = ptr[x];
 
-			int binInd = val / binStep;
-			binInd = binInd >= bins ? bins - 1 : binInd;	// avoid out of range
+				int binInd = val / binStep;
+				binInd = binInd >= bins ? bins - 1 : binInd;	// avoid out of range
 
-			pxLists[binInd].emplace_back(
-				/*x*/ind % src.cols, /*y*/ind / src.cols, val);
+				pxLists[binInd].emplace_back(x, y, val);
+			}
 		}
 
 		// descending sort
@@ -0,0 +1,87 @@
+#ifndef __ANCHOR_GROUPS_HPP__
+#define __ANCHOR_GROUPS_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include "utilities.hpp"
+#include "segments.hpp"
+
+
+namespace AED
+{
+	/* @brief Aligned-anchor groups for linking, one column per attribute.
+	Group g is the triplet (neighbor, anchor, neighbor) at 3 * g .. 3 * g + 2 of the coordinate columns.
+	25 bytes per group, against 52 bytes of 3 Pixels, a cv::Vec4f and a link bit. It is a copy for
+	the linking loops, the extracted PixelList stays with the caller.
+	Coordinates are int16, assign rejects images over 32767 pixels a side. */
+	struct AnchorGroups
+	{
+		std::vector<int16_t> xs, ys;	// 3 per group
+		std::vector<float>   dirX, dirY;	// sum of level-line directions of the 3 pixels
+		std::vector<float>   strength;	// magnitude of the middle anchor
+		std::vector<uint8_t> isLink;	// link status
+
+		size_t size() const { return strength.size(); }
+
+		bool empty() const { return strength.empty(); }
+
+		void clear()
+		{
+			xs.clear(), ys.clear();
+			dirX.clear(), dirY.clear();
+			strength.clear();
+			isLink.clear();
+		}
+
+		cv::Point point(int groupInd, int i) const
+		{
+			return cv::Point(xs[3 * groupInd + i], ys[3 * groupInd + i]);
+		}
+
+		/* @brief The middle anchor with its magnitude. */
+		Pixel center(int groupInd) const
+		{
+			return Pixel(xs[3 * groupInd + 1], ys[3 * groupInd + 1], strength[groupInd]);
+		}
+
+		/* @brief Aligned-anchor-line, [cos_theta, sin_theta, x0, y0] up to scale of direction. */
+		cv::Vec4f line(int groupInd) const
+		{
+			return cv::Vec4f(dirX[groupInd], dirY[groupInd], xs[3 * groupInd + 1], ys[3 * groupInd + 1]);
+		}
+
+		/* @brief Fill from anchor triplets as extracted, direction is taken from orientation map. */
+		void assign(const PixelList& alignedAnchors, const cv::Mat& ori)
+		{
+			// coordinates would wrap in int16
+			CV_Assert(ori.cols <= INT16_MAX && ori.rows <= INT16_MAX);
+
+			size_t numGroups = alignedAnchors.size() / 3;
+			const ImageView<const float> oriView(ori);
+
+			xs.resize(3 * numGroups), ys.resize(3 * numGroups);
+			dirX.assign(numGroups, 0.0f), dirY.assign(numGroups, 0.0f);
+			strength.resize(numGroups);
+			isLink.assign(numGroups, 0);
+
+			for (size_t ind = 0; ind != 3 * numGroups; ++ind)
+			{
+				const auto& px = alignedAnchors[ind];
+				xs[ind] = int16_t(px.x), ys[ind] = int16_t(px.y);
+
+				const auto& ang = atPixel<float>(oriView, px) - 90.0;
+				dirX[ind / 3] += std::cos(ang * CV_PI / 180.0);
+				dirY[ind / 3] += std::sin(ang * CV_PI / 180.0);
+			}
+
+			for (size_t groupInd = 0; groupInd != numGroups; ++groupInd)
+				strength[groupInd] = alignedAnchors[3 * groupInd + 1].val;
+
+			return;
+		}
+	};
+}
+
+
+#endif // !__ANCHOR_GROUPS_HPP__
@@ -0,0 +1,620 @@
+#include "anchormask.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace AED
+{
+	/* @brief Index of the lowest set bit, word must not be 0. */
+	static inline int lowestBit(uint64_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long ind;
+		_BitScanForward64(&ind, word);
+		return int(ind);
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+
+
+	/* @brief Smallest float f with double(f) >= MIN_GRAD_THRESH, for float comparisons. */
+	static float minGradThresh()
+	{
+		float thresh = float(MIN_GRAD_THRESH);
+		if (double(thresh) < MIN_GRAD_THRESH)
+			thresh = std::nextafter(thresh, FLT_MAX);
+		return thresh;
+	}
+
+
+	/* @brief Bin of a magnitude, the same as pseudoSort. */
+	static inline int binIndex(float val, double binStep, int bins)
+	{
+		int binInd = val / binStep;
+		return binInd >= bins ? bins - 1 : binInd;
+	}
+
+
+	/* @brief Set bits of the mask in bins above minBin by counting sort, row-major inside
+	a bin like pseudoSort. Pixel indices of bin b are sorted[offsets[b], offsets[b + 1]). */
+	static void sortByBin(
+		const ImageView<const float>& mag,
+		const AnchorCandidateMask&    mask,
+		int                           bins,
+		double                        binStep,
+		int                           minBin,
+		std::vector<int>&             sorted,
+		std::vector<int>&             offsets
+	)
+	{
+		std::vector<int> inds, indBins;
+		for (int y = 0; y != mask.height; ++y)
+		{
+			const uint64_t* words = mask.row(y);
+			const float* magPtr = mag.row(y);
+			for (int w = 0; w != mask.wordsPerRow; ++w)
+			{
+				for (uint64_t word = words[w]; word != 0; word &= word - 1)
+				{
+					int x = (w << 6) + lowestBit(word);
+					int binInd = binIndex(magPtr[x], binStep, bins);
+					if (binInd > minBin)
+					{
+						inds.push_back(x + y * mag.width);
+						indBins.push_back(binInd);
+					}
+				}
+			}
+		}
+
+		offsets.assign(bins + 1, 0);
+		for (int binInd : indBins)
+			++offsets[binInd + 1];
+		for (int binInd = 0; binInd != bins; ++binInd)
+			offsets[binInd + 1] += offsets[binInd];
+
+		sorted.resize(inds.size());
+		std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i != inds.size(); ++i)
+			sorted[fill[indBins[i]]++] = inds[i];
+
+		return;
+	}
+
+
+	/* @brief Pack per-pixel flags of a row into the mask. */
+	static void packRow(AnchorCandidateMask& mask, int y, const std::vector<uint8_t>& flags)
+	{
+		uint64_t* words = mask.row(y);
+		for (int x = 0; x != mask.width; ++x)
+			words[x >> 6] |= uint64_t(flags[x]) << (x & 63);
+	}
+
+
+	/* @brief Size the mask to the image, all bits cleared. */
+	static void resetMask(AnchorCandidateMask& mask, int rows, int cols)
+	{
+		mask.width = cols;
+		mask.height = rows;
+		mask.wordsPerRow = (cols + 63) / 64;
+		mask.bits.assign(size_t(rows) * mask.wordsPerRow, 0);
+	}
+
+
+	/* @brief Smallest float whose bin is at least binInd, for float comparisons. */
+	static float binLowerBound(int binInd, double binStep, int bins)
+	{
+		float val = float(binInd * binStep);
+		while (val > 0.0f && binIndex(std::nextafter(val, 0.0f), binStep, bins) >= binInd)
+			val = std::nextafter(val, 0.0f);
+		while (binIndex(val, binStep, bins) < binInd)
+			val = std::nextafter(val, FLT_MAX);
+		return val;
+	}
+
+
+	/* @brief List walk of the bin holding MIN_GRAD_THRESH: skipped if its first pixel is weak,
+	otherwise stopped at the first weak pixel not used yet. Rows collect the bin's candidates and
+	weak pixels in parallel, by 2 comparisons per pixel; only those are replayed in serial order,
+	since used changes with each anchor taken. */
+	static void replayThreshBin(
+		const GradientInfo*        pGradInfo,
+		const AnchorCandidateMask& mask,
+		std::vector<bool>&         used,
+		PixelList&                 alignedAnchors,
+		int                        bins,
+		double                     binStep,
+		int                        threshBin,
+		float                      angleTolerance
+	)
+	{
+		const GradientView view(pGradInfo);
+		auto& mag = view.mag;
+		const int rows = mag.height, cols = mag.width;
+
+		// the bin is [binLow, binHigh) of magnitude, the last bin has no upper end
+		const float binLow = binLowerBound(threshBin, binStep, bins);
+		const float binHigh = threshBin == bins - 1 ?
+			std::numeric_limits<float>::infinity() : binLowerBound(threshBin + 1, binStep, bins);
+		const float minGrad = minGradThresh();
+
+		// per row: candidates as x, weak pixels as ~x; whether the row's first pixel of the bin is weak
+		std::vector<std::vector<int>> rowPixels(rows);
+		std::vector<int8_t> rowFirst(rows, -1);
+
+		cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+			for (int y = range.start; y != range.end; ++y)
+			{
+				const float* magPtr = mag.row(y);
+				auto& pixels = rowPixels[y];
+				for (int x = 0; x != cols; ++x)
+				{
+					float val = magPtr[x];
+					if (val < binLow || val >= binHigh)
+						continue;
+
+					bool isWeak = val < minGrad;
+					if (rowFirst[y] == -1)
+						rowFirst[y] = isWeak;
+
+					if (isWeak)
+						pixels.push_back(~x);
+					else if (mask.test(x, y))
+						pixels.push_back(x);
+				}
+			}
+		});
+
+		int firstRow = 0;
+		while (firstRow != rows && rowFirst[firstRow] == -1)
+			++firstRow;
+		if (firstRow == rows || rowFirst[firstRow] == 1)
+			return;
+
+		for (int y = firstRow; y != rows; ++y)
+		{
+			for (int code : rowPixels[y])
+			{
+				int x = code < 0 ? ~code : code;
+				if (used[x + y * cols])
+					continue;
+				if (code < 0)
+					return;
+
+				Pixel px(x, y);
+				px.val = mag.row(y)[x];
+				appendAlignedCandidate(view, px, used, alignedAnchors, angleTolerance);
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief An aligned candidate with its neighbors, key orders like the serial extraction:
+	descending bin in the high 32 bits, pixel index in the low ones. */
+	struct Triplet
+	{
+		uint64_t key;
+		int      inds[3];	// px3, px, px4
+	};
+
+
+	/* @brief Number of set bits. */
+	size_t AnchorCandidateMask::count() const
+	{
+		size_t num = 0;
+		for (uint64_t word : bits)
+		{
+			for (; word != 0; word &= word - 1)
+				++num;
+		}
+
+		return num;
+	}
+
+
+	/* @brief Mark pixels passing isAnchorCandidate with magnitude at least MIN_GRAD_THRESH. */
+	void calcAnchorCandidates(
+		const GradientInfo*  pGradInfo,
+		AnchorCandidateMask& mask,
+		float                anchorThresh
+	)
+	{
+		const GradientView view(pGradInfo);
+		auto& mag = view.mag;
+		auto& ori = view.ori;
+		const int rows = mag.height, cols = mag.width;
+		const float minGrad = minGradThresh();
+
+		resetMask(mask, rows, cols);
+
+		// scalar test where some neighbors are outside, its early exits decide there
+		auto borderTest = [&](int x, int y)->bool {
+			Pixel px(x, y);
+			px.val = mag.row(y)[x];
+			return px.val >= minGrad && isAnchorCandidate(view, px, anchorThresh);
+		};
+
+		cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+			std::vector<uint8_t> flags(cols, 0);
+
+			for (int y = range.start; y != range.end; ++y)
+			{
+				if (y == 0 || y == rows - 1)
+				{
+					for (int x = 0; x != cols; ++x)
+						flags[x] = borderTest(x, y);
+				}
+				else
+				{
+					const float* m0 = mag.row(y - 1);
+					const float* m1 = mag.row(y);
+					const float* m2 = mag.row(y + 1);
+					const float* angs = ori.row(y);
+					uint8_t* flag = flags.data();
+
+					// the 6 neighbors of each orientation are in the 3x3 window,
+					// the first and last 3 give the maxima on both sides of the gradient
+					for (int x = 1; x < cols - 1; ++x)
+					{
+						float t0 = m0[x - 1], t1 = m0[x], t2 = m0[x + 1];
+						float l = m1[x - 1], v = m1[x], r = m1[x + 1];
+						float b0 = m2[x - 1], b1 = m2[x], b2 = m2[x + 1];
+						float ang = angs[x];
+
+						bool isDiag45 = ang >= 22.5f && ang < 67.5f;
+						bool isVertical = ang >= 67.5f && ang < 112.5f;
+						bool isDiag135 = ang >= 112.5f && ang < 157.5f;
+
+						float side1 = isDiag45 ? std::max(std::max(t1, t0), l) :
+							isVertical ? std::max(std::max(t2, t1), t0) :
+							isDiag135 ? std::max(std::max(l, b0), b1) : std::max(std::max(t0, l), b0);
+						float side2 = isDiag45 ? std::max(std::max(b1, b2), r) :
+							isVertical ? std::max(std::max(b0, b1), b2) :
+							isDiag135 ? std::max(std::max(r, t2), t1) : std::max(std::max(b2, r), t2);
+
+						flag[x] = v >= minGrad && v > side1 && v > side2 &&
+							side1 > FLT_MIN && side2 > FLT_MIN &&
+							!(v - side1 < anchorThresh && v - side2 < anchorThresh);
+					}
+
+					flags[0] = borderTest(0, y);
+					if (cols > 1)
+						flags[cols - 1] = borderTest(cols - 1, y);
+				}
+
+				// words of a row belong to this row only
+				packRow(mask, y, flags);
+			}
+		});
+
+		return;
+	}
+
+
+	/* @brief Extract aligned anchors visiting only candidates, appending to the output. */
+	void extractAlignedAnchors(
+		const GradientInfo*        pGradInfo,
+		const AnchorCandidateMask& mask,
+		std::vector<bool>&         used,
+		PixelList&                 alignedAnchors,
+		int                        bins,
+		double                     magRange,
+		float                      angleTolerance
+	)
+	{
+		const GradientView view(pGradInfo);
+		auto& mag = view.mag;
+		const int cols = mag.width;
+		const double binStep = magRange / bins;
+
+		// bin of MIN_GRAD_THRESH, all pixels above it are strong, all below are weak
+		const int threshBin = std::min(int(MIN_GRAD_THRESH / binStep), bins - 1);
+
+		// candidates of strong bins
+		std::vector<int> sorted, offsets;
+		sortByBin(mag, mask, bins, binStep, threshBin, sorted, offsets);
+
+		for (int binInd = bins - 1; binInd > threshBin; --binInd)
+		{
+			for (int i = offsets[binInd]; i != offsets[binInd + 1]; ++i)
+			{
+				int ind = sorted[i];
+				if (used[ind])
+					continue;
+
+				Pixel px(ind % cols, ind / cols);
+				px.val = mag(ind % cols, ind / cols);
+				appendAlignedCandidate(view, px, used, alignedAnchors, angleTolerance);
+			}
+		}
+
+		replayThreshBin(pGradInfo, mask, used, alignedAnchors, bins, binStep, threshBin, angleTolerance);
+
+		return;
+	}
+
+
+	/* @brief Extract aligned anchors in parallel tiles, appending to the output. */
+	void extractAlignedAnchorsTiled(
+		const GradientInfo*        pGradInfo,
+		const AnchorCandidateMask& mask,
+		std::vector<bool>&         used,
+		PixelList&                 alignedAnchors,
+		int                        bins,
+		double                     magRange,
+		float                      angleTolerance,
+		int                        tileSize,
+		size_t*                    numDeferred,
+		double*                    replayMs
+	)
+	{
+		const GradientView view(pGradInfo);
+		auto& mag = view.mag;
+		const int rows = mag.height, cols = mag.width;
+		const double binStep = magRange / bins;
+		const int threshBin = std::min(int(MIN_GRAD_THRESH / binStep), bins - 1);
+
+		tileSize = std::max(tileSize, 8);
+		const int tilesX = (cols + tileSize - 1) / tileSize;
+		const int tilesY = (rows + tileSize - 1) / tileSize;
+
+		std::vector<std::vector<Triplet>> accepted(tilesX * tilesY), deferred(tilesX * tilesY);
+
+		// 1. Tiles in parallel, candidates in local serial order. used is only read here.
+		cv::parallel_for_(cv::Range(0, tilesX * tilesY), [&](const cv::Range& range) {
+			std::vector<Triplet> triplets;
+			std::vector<uint8_t> state;
+
+			for (int tileInd = range.start; tileInd != range.end; ++tileInd)
+			{
+				const int x0 = tileInd % tilesX * tileSize, x1 = std::min(x0 + tileSize, cols);
+				const int y0 = tileInd / tilesX * tileSize, y1 = std::min(y0 + tileSize, rows);
+
+				// pixels a triplet of another tile may take, the outermost ring except at image borders
+				const int innerX0 = x0 == 0 ? 0 : x0 + 1, innerX1 = x1 == cols ? cols : x1 - 1;
+				const int innerY0 = y0 == 0 ? 0 : y0 + 1, innerY1 = y1 == rows ? rows : y1 - 1;
+
+				triplets.clear();
+				for (int y = y0; y != y1; ++y)
+				{
+					const uint64_t* words = mask.row(y);
+					const float* magPtr = mag.row(y);
+					for (int w = x0 >> 6; w <= (x1 - 1) >> 6; ++w)
+					{
+						for (uint64_t word = words[w]; word != 0; word &= word - 1)
+						{
+							int x = (w << 6) + lowestBit(word);
+							if (x < x0 || x >= x1)
+								continue;
+
+							int binInd = binIndex(magPtr[x], binStep, bins);
+							Pixel px(x, y), px3, px4;
+							px.val = magPtr[x];
+							if (binInd <= threshBin || !alignedNeighbors(view, px, px3, px4, angleTolerance))
+								continue;
+
+							Triplet triplet;
+							triplet.key = uint64_t(bins - 1 - binInd) << 32 | uint32_t(x + y * cols);
+							triplet.inds[0] = int(px3.x) + int(px3.y) * cols;
+							triplet.inds[1] = x + y * cols;
+							triplet.inds[2] = int(px4.x) + int(px4.y) * cols;
+							triplets.push_back(triplet);
+						}
+					}
+				}
+
+				std::sort(triplets.begin(), triplets.end(),
+					[](const Triplet& lhs, const Triplet& rhs)->bool { return lhs.key < rhs.key; });
+
+				// 0: free, 1: taken by an accepted triplet, 2: tainted by a deferred one
+				state.assign(size_t(x1 - x0) * (y1 - y0), 0);
+				auto localInd = [&](int ind)->int {
+					int x = ind % cols, y = ind / cols;
+					return x < x0 || x >= x1 || y < y0 || y >= y1 ? -1 : (x - x0) + (y - y0) * (x1 - x0);
+				};
+
+				for (const auto& triplet : triplets)
+				{
+					bool isTaken = false, isDeferred = false;
+					for (int ind : triplet.inds)
+					{
+						int x = ind % cols, y = ind / cols;
+						int local = localInd(ind);
+
+						isTaken |= used[ind] || (local != -1 && state[local] == 1);
+						isDeferred |= x < innerX0 || x >= innerX1 || y < innerY0 || y >= innerY1 ||
+							(local != -1 && state[local] == 2);
+					}
+
+					// a taken pixel was taken by an earlier triplet whose decision is final
+					if (isTaken)
+						continue;
+
+					// contested, or depends on a contested one: resolved in global order later
+					uint8_t mark = isDeferred ? 2 : 1;
+					for (int ind : triplet.inds)
+					{
+						int local = localInd(ind);
+						if (local != -1)
+							state[local] = mark;
+					}
+
+					(isDeferred ? deferred : accepted)[tileInd].push_back(triplet);
+				}
+			}
+		});
+
+		// 2. Accepted triplets never conflict with an earlier deferred one, mark them first.
+		std::vector<Triplet> all;
+		for (const auto& tileAccepted : accepted)
+		{
+			for (const auto& triplet : tileAccepted)
+			{
+				for (int ind : triplet.inds)
+					used[ind] = true;
+			}
+			all.insert(all.end(), tileAccepted.begin(), tileAccepted.end());
+		}
+
+		// 3. Deferred triplets in global order, as the serial extraction.
+		std::vector<Triplet> contested;
+		for (const auto& tileDeferred : deferred)
+			contested.insert(contested.end(), tileDeferred.begin(), tileDeferred.end());
+		std::sort(contested.begin(), contested.end(),
+			[](const Triplet& lhs, const Triplet& rhs)->bool { return lhs.key < rhs.key; });
+		if (numDeferred != nullptr)
+			*numDeferred = contested.size();
+
+		for (const auto& triplet : contested)
+		{
+			if (used[triplet.inds[0]] || used[triplet.inds[1]] || used[triplet.inds[2]])
+				continue;
+
+			for (int ind : triplet.inds)
+				used[ind] = true;
+			all.push_back(triplet);
+		}
+
+		// 4. Output in global order, bins by counting sort and each bin sorted in parallel.
+		std::vector<int> offsets(bins + 1, 0);
+		for (const auto& triplet : all)
+			++offsets[(triplet.key >> 32) + 1];
+		for (int binInd = 0; binInd != bins; ++binInd)
+			offsets[binInd + 1] += offsets[binInd];
+
+		std::vector<Triplet> sorted(all.size());
+		std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+		for (const auto& triplet : all)
+			sorted[fill[triplet.key >> 32]++] = triplet;
+
+		cv::parallel_for_(cv::Range(0, bins), [&](const cv::Range& range) {
+			for (int binInd = range.start; binInd != range.end; ++binInd)
+				std::sort(sorted.begin() + offsets[binInd], sorted.begin() + offsets[binInd + 1],
+					[](const Triplet& lhs, const Triplet& rhs)->bool { return lhs.key < rhs.key; });
+		});
+
+		size_t base = alignedAnchors.size();
+		alignedAnchors.resize(base + 3 * sorted.size());
+		cv::parallel_for_(cv::Range(0, int(sorted.size())), [&](const cv::Range& range) {
+			for (int i = range.start; i != range.end; ++i)
+			{
+				for (int k = 0; k != 3; ++k)
+				{
+					int ind = sorted[i].inds[k];
+					alignedAnchors[base + 3 * i + k] = Pixel(ind % cols, ind / cols, mag(ind % cols, ind / cols));
+				}
+			}
+		});
+
+		int64 t0 = cv::getTickCount();
+		replayThreshBin(pGradInfo, mask, used, alignedAnchors, bins, binStep, threshBin, angleTolerance);
+		if (replayMs != nullptr)
+			*replayMs = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+
+		return;
+	}
+
+
+	/* @brief Mark pixels passing isAnchorED. */
+	void calcAnchorEDMask(
+		const GradientInfo*  pGradInfo,
+		AnchorCandidateMask& mask,
+		float                anchorThresh
+	)
+	{
+		const GradientView view(pGradInfo);
+		auto& gradx = view.gradx;
+		auto& grady = view.grady;
+		auto& mag = view.mag;
+		const int rows = mag.height, cols = mag.width;
+		const float minGrad = minGradThresh();
+
+		resetMask(mask, rows, cols);
+
+		auto borderTest = [&](int x, int y)->bool {
+			Pixel px(x, y);
+			px.val = mag.row(y)[x];
+			return isAnchorED(view, px, anchorThresh);
+		};
+
+		cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+			std::vector<uint8_t> flags(cols, 0);
+
+			for (int y = range.start; y != range.end; ++y)
+			{
+				if (y == 0 || y == rows - 1)
+				{
+					for (int x = 0; x != cols; ++x)
+						flags[x] = borderTest(x, y);
+				}
+				else
+				{
+					const float* m0 = mag.row(y - 1);
+					const float* m1 = mag.row(y);
+					const float* m2 = mag.row(y + 1);
+					const float* gxPtr = gradx.row(y);
+					const float* gyPtr = grady.row(y);
+					uint8_t* flag = flags.data();
+
+					// vertical pixels compare with left and right, horizontal ones with top and bottom
+					for (int x = 1; x < cols - 1; ++x)
+					{
+						bool isVerticalPx = std::abs(gxPtr[x]) > std::abs(gyPtr[x]);
+						float mag1 = isVerticalPx ? m1[x - 1] : m0[x];
+						float mag2 = isVerticalPx ? m1[x + 1] : m2[x];
+						float v = m1[x];
+
+						flag[x] = v >= minGrad && v - anchorThresh > mag1 && v - anchorThresh > mag2;
+					}
+
+					flags[0] = borderTest(0, y);
+					if (cols > 1)
+						flags[cols - 1] = borderTest(cols - 1, y);
+				}
+
+				packRow(mask, y, flags);
+			}
+		});
+
+		return;
+	}
+
+
+	/* @brief ED anchors of the mask, in the order extractAnchorED gives over pseudoSort's lists. */
+	void extractAnchorED(
+		const GradientInfo*        pGradInfo,
+		const AnchorCandidateMask& mask,
+		PixelList&                 anchorPixels,
+		int                        bins,
+		double                     magRange
+	)
+	{
+		anchorPixels.clear();
+
+		const GradientView view(pGradInfo);
+		auto& mag = view.mag;
+		const int cols = mag.width;
+
+		std::vector<int> sorted, offsets;
+		sortByBin(mag, mask, bins, magRange / bins, -1, sorted, offsets);
+
+		anchorPixels.reserve(sorted.size());
+		for (int binInd = bins - 1; binInd >= 0; --binInd)
+		{
+			for (int i = offsets[binInd]; i != offsets[binInd + 1]; ++i)
+			{
+				int ind = sorted[i];
+				anchorPixels.emplace_back(ind % cols, ind / cols, mag(ind % cols, ind / cols));
+			}
+		}
+
+		return;
+	}
+}
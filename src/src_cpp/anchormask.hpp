@@ -0,0 +1,108 @@
+#ifndef __ANCHOR_MASK_HPP__
+#define __ANCHOR_MASK_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <cstdint>
+#include "utilities.hpp"
+#include "segments.hpp"
+#include "alignED.hpp"
+
+
+namespace AED
+{
+	/* @brief One bit per pixel, rows padded to 64-bit words. */
+	struct AnchorCandidateMask
+	{
+		int                   width = 0;
+		int                   height = 0;
+		int                   wordsPerRow = 0;
+		std::vector<uint64_t> bits;
+
+		const uint64_t* row(int y) const { return bits.data() + size_t(y) * wordsPerRow; }
+
+		uint64_t* row(int y) { return bits.data() + size_t(y) * wordsPerRow; }
+
+		bool test(int x, int y) const { return (row(y)[x >> 6] >> (x & 63) & 1) != 0; }
+
+		/* @brief Number of set bits. */
+		size_t count() const;
+	};
+
+
+	/* @brief Mark pixels passing isAnchorCandidate with magnitude at least MIN_GRAD_THRESH.
+	The test is independent of extraction order, so rows are streamed in parallel with
+	branch-free loops over the 3x3 neighbourhood; only border pixels use isAnchorCandidate. */
+	extern
+	void calcAnchorCandidates(
+		const GradientInfo*  pGradInfo,
+		AnchorCandidateMask& mask,
+		float                anchorThresh = 3.0f
+	);
+
+
+	/* @brief Extract aligned anchors visiting only candidates, appending to the output.
+	Candidates are visited in the order of pseudoSort(mag, bins, magRange) followed by the
+	list-based extraction, so the anchors are identical; the list of all pixels is not built.
+	Pixels already marked in used-map are never shared by new anchors. */
+	extern
+	void extractAlignedAnchors(
+		const GradientInfo*        pGradInfo,
+		const AnchorCandidateMask& mask,
+		std::vector<bool>&         used,
+		PixelList&                 alignedAnchors,
+		int                        bins = 1024,
+		double                     magRange = 255.0,
+		float                      angleTolerance = 22.5f
+	);
+
+
+	/* @brief Parallel extractAlignedAnchors over the mask, the anchors and their order are the same.
+	Tiles take their candidates in local serial order. A triplet is deferred if it may share a pixel
+	with a triplet of another tile (it touches the outermost ring of its tile) or with an earlier
+	deferred triplet; otherwise its decision cannot depend on other tiles and is final. Deferred
+	triplets are then resolved serially in global order, so the result is exact and no tolerance
+	is needed. Pixels of the bin holding MIN_GRAD_THRESH are collected by rows in parallel and
+	replayed serially, only the collected ones.
+	* @param numDeferred: if given, the number of triplets resolved serially.
+	* @param replayMs: if given, the time of the threshold-bin pass in ms. */
+	extern
+	void extractAlignedAnchorsTiled(
+		const GradientInfo*        pGradInfo,
+		const AnchorCandidateMask& mask,
+		std::vector<bool>&         used,
+		PixelList&                 alignedAnchors,
+		int                        bins = 1024,
+		double                     magRange = 255.0,
+		float                      angleTolerance = 22.5f,
+		int                        tileSize = 256,
+		size_t*                    numDeferred = nullptr,
+		double*                    replayMs = nullptr
+	);
+
+
+	/* @brief Mark pixels passing isAnchorED, rows in parallel with branch-free loops,
+	only border pixels use isAnchorED. */
+	extern
+	void calcAnchorEDMask(
+		const GradientInfo*  pGradInfo,
+		AnchorCandidateMask& mask,
+		float                anchorThresh = 1.f
+	);
+
+
+	/* @brief ED anchors of the mask, in the order extractAnchorED gives over the lists of
+	pseudoSort(mag, bins, magRange): descending bins, row-major inside a bin. */
+	extern
+	void extractAnchorED(
+		const GradientInfo*        pGradInfo,
+		const AnchorCandidateMask& mask,
+		PixelList&                 anchorPixels,
+		int                        bins = 1024,
+		double                     magRange = 255.0
+	);
+}
+
+
+#endif // !__ANCHOR_MASK_HPP__
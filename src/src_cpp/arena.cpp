@@ -0,0 +1,99 @@
+#include "arena.hpp"
+#include <cstdint>
+
+
+FrameArena::FrameArena(size_t _blockSize) : blockSize(_blockSize)
+{
+}
+
+
+FrameArena::~FrameArena()
+{
+	for (auto& block : blocks)
+		::operator delete(block.data);
+}
+
+
+/* @brief Memory of given size and alignment (a power of 2), valid until reset(). */
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+	++allocs;
+
+	// the first block is only taken on demand, an unused arena costs nothing
+	if (blocks.empty())
+		addBlock(size + alignment);
+
+	for (;;)
+	{
+		Block& block = blocks[current];
+		uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+		uintptr_t aligned = (base + offset + alignment - 1) & ~uintptr_t(alignment - 1);
+		size_t end = size_t(aligned - base) + size;
+
+		if (end <= block.size)
+		{
+			offset = end;
+			return reinterpret_cast<void*>(aligned);
+		}
+
+		// next kept block, or a new one large enough
+		offset = 0;
+		if (++current == blocks.size())
+			addBlock(size + alignment);
+	}
+}
+
+
+/* @brief Release all allocations of the frame, keeps the memory for the next one. */
+void FrameArena::reset()
+{
+	// one block of the total size serves the next such frame without growing
+	if (blocks.size() > 1)
+	{
+		size_t total = capacity();
+		for (auto& block : blocks)
+			::operator delete(block.data);
+		blocks.clear();
+
+		blocks.push_back({ static_cast<char*>(::operator new(total)), total });
+	}
+
+	current = 0;
+	offset = 0;
+	allocs = 0;
+	blockAllocs = 0;
+
+	return;
+}
+
+
+/* @brief Bytes handed out since the last reset, padding included. */
+size_t FrameArena::bytesUsed() const
+{
+	size_t used = offset;
+	for (size_t ind = 0; ind < current && ind < blocks.size(); ++ind)
+		used += blocks[ind].size;
+
+	return used;
+}
+
+
+/* @brief Bytes of all blocks. */
+size_t FrameArena::capacity() const
+{
+	size_t total = 0;
+	for (const auto& block : blocks)
+		total += block.size;
+
+	return total;
+}
+
+
+void FrameArena::addBlock(size_t minSize)
+{
+	size_t size = blockSize > minSize ? blockSize : minSize;
+	blocks.push_back({ static_cast<char*>(::operator new(size)), size });
+	++blockAllocs;
+
+	return;
+}
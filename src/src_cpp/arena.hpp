@@ -0,0 +1,106 @@
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+
+/* @brief Monotonic memory of a frame's scratch containers.
+Allocation bumps a pointer in the current block, deallocation is a no-op and everything
+is released at once by reset(). Blocks are kept across frames, after a frame that needed
+several blocks they are merged into one, so a warm arena does no system allocation.
+Not thread-safe, parallel code keeps one arena per thread or uses the heap. */
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t blockSize = size_t(1) << 20);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	/* @brief Memory of given size and alignment (a power of 2), valid until reset(). */
+	void* allocate(size_t size, size_t alignment);
+
+	/* @brief Release all allocations of the frame, keeps the memory for the next one. */
+	void reset();
+
+	/* @brief Allocations served since the last reset. */
+	size_t numAllocs() const { return allocs; }
+
+	/* @brief Blocks taken from the system since the last reset. */
+	size_t numBlockAllocs() const { return blockAllocs; }
+
+	/* @brief Bytes handed out since the last reset, padding included. */
+	size_t bytesUsed() const;
+
+	/* @brief Bytes of all blocks. */
+	size_t capacity() const;
+
+private:
+	struct Block
+	{
+		char*  data;
+		size_t size;
+	};
+
+	void addBlock(size_t minSize);
+
+	std::vector<Block> blocks;
+	size_t             current = 0;	// block being filled
+	size_t             offset = 0;	// bytes used of the current block
+	size_t             blockSize;
+
+	size_t             allocs = 0;
+	size_t             blockAllocs = 0;
+};
+
+
+/* @brief std-compatible allocator over a FrameArena, the heap is used if the arena is null. */
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena* _arena = nullptr) noexcept : arena(_arena) { }
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) { }
+
+	T* allocate(size_t n)
+	{
+		if (arena == nullptr)
+			return std::allocator<T>().allocate(n);
+		return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* ptr, size_t n) noexcept
+	{
+		if (arena == nullptr)
+			std::allocator<T>().deallocate(ptr, n);
+	}
+
+	FrameArena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+	return lhs.arena == rhs.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+	return lhs.arena != rhs.arena;
+}
+
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+
+#endif // !__ARENA_HPP__
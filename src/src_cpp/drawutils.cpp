@@ -1,4 +1,5 @@
 #include "drawutils.hpp"
+#include "iofile.hpp"
 
 
 /* @brief Draw Rectangle. */
@@ -144,56 +145,13 @@ cv::Mat drawCompare(
 }
 
 
+/* @brief Read YorkUrban labels, segments are appended. */
 void extractYUK(
 	const std::string& txtname,
 	LineSegList&       segments,
 	const char         splitText
 )
 {
-	std::ifstream ifs(txtname);
-
-	if (!ifs.is_open())
-	{
-		ifs.close();
-		return;
-	}
-
-	std::string line;
-	std::unordered_set<char> iset {'.', 'e', 'E', '+', '-'};
-
-	while (std::getline(ifs, line))
-	{
-		if (line.empty() || std::isspace(line[0]))
-			continue;
-
-		int cnt = 0;
-		float val[4] = { FLT_MIN, FLT_MIN, FLT_MIN, FLT_MIN, };
-
-		std::string digit;
-		for (size_t ind = 0; ind != line.size(); ++ind)
-		{
-			if (!std::isdigit(line[ind]) &&
-				!std::isspace(line[ind]) &&
-				iset.find(line[ind]) == iset.end() &&
-				line[ind] != splitText)
-				return;
-
-			if (ind == line.size() - 1 && std::isdigit(line[ind]))
-				digit.push_back(line[ind]);
-
-			if (line[ind] == splitText || ind == line.size() - 1)
-			{
-				val[cnt++] = std::stof(digit);
-				digit.clear();
-				continue;
-			}
-			digit.push_back(line[ind]);
-		}
-
-
-		segments.emplace_back(val[0], val[1], val[2], val[3]);
-	}
-
-	ifs.close();
+	readSegmentText(txtname, segments, splitText);
 	return;
-}
\ No newline at end of file
+}
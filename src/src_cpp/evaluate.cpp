@@ -0,0 +1,858 @@
+#include "evaluate.hpp"
+#include <algorithm>
+#include <fstream>
+
+
+/*---------------------- Uniform grid ----------------------*/
+
+/* @brief Uniform grid of boxes, a box is stored in every cell it covers.
+Cells are stored as compressed rows, built once and read-only after. */
+class BoxGrid
+{
+public:
+	/* @brief Build grid of boxes. */
+	void build(
+		const std::vector<cv::Rect2f>& boxes,
+		float                          _cellSize
+	)
+	{
+		cellSize = _cellSize;
+		cellStart.clear();
+		items.clear();
+		stamps.assign(boxes.size(), -1);
+		query = 0;
+
+		if (boxes.empty())
+		{
+			cols = rows = 0;
+			return;
+		}
+
+		float x1 = -FLT_MAX, y1 = -FLT_MAX;
+		x0 = y0 = FLT_MAX;
+		for (const auto& box : boxes)
+		{
+			x0 = MIN(x0, box.x);
+			y0 = MIN(y0, box.y);
+			x1 = MAX(x1, box.x + box.width);
+			y1 = MAX(y1, box.y + box.height);
+		}
+
+		cols = int((x1 - x0) / cellSize) + 1;
+		rows = int((y1 - y0) / cellSize) + 1;
+
+		// count, prefix sum, then fill
+		cellStart.assign(size_t(cols) * rows + 1, 0);
+		for (const auto& box : boxes)
+		{
+			cv::Rect cells = cellRange(box);
+			for (int r = cells.y; r < cells.y + cells.height; ++r)
+				for (int c = cells.x; c < cells.x + cells.width; ++c)
+					++cellStart[size_t(r) * cols + c + 1];
+		}
+
+		for (size_t i = 1; i != cellStart.size(); ++i)
+			cellStart[i] += cellStart[i - 1];
+
+		items.resize(cellStart.back());
+		std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+		for (int ind = 0; ind != boxes.size(); ++ind)
+		{
+			cv::Rect cells = cellRange(boxes[ind]);
+			for (int r = cells.y; r < cells.y + cells.height; ++r)
+				for (int c = cells.x; c < cells.x + cells.width; ++c)
+					items[fill[size_t(r) * cols + c]++] = ind;
+		}
+	}
+
+	/* @brief Return indices of boxes sharing a cell with the box, ascending. */
+	void find(
+		const cv::Rect2f& box,
+		std::vector<int>& inds
+	)
+	{
+		inds.clear();
+		if (cols == 0)
+			return;
+
+		++query;
+		cv::Rect cells = cellRange(box);
+		for (int r = cells.y; r < cells.y + cells.height; ++r)
+		{
+			for (int c = cells.x; c < cells.x + cells.width; ++c)
+			{
+				size_t cell = size_t(r) * cols + c;
+				for (int i = cellStart[cell]; i != cellStart[cell + 1]; ++i)
+				{
+					int ind = items[i];
+					if (stamps[ind] != query)
+					{
+						stamps[ind] = query;
+						inds.push_back(ind);
+					}
+				}
+			}
+		}
+
+		std::sort(inds.begin(), inds.end());
+	}
+
+private:
+	/* @brief Cells covered by the box, clipped to the grid, may be empty. */
+	cv::Rect cellRange(const cv::Rect2f& box) const
+	{
+		int c0 = MAX(int(std::floor((box.x - x0) / cellSize)), 0);
+		int r0 = MAX(int(std::floor((box.y - y0) / cellSize)), 0);
+		int c1 = MIN(int(std::floor((box.x + box.width - x0) / cellSize)), cols - 1);
+		int r1 = MIN(int(std::floor((box.y + box.height - y0) / cellSize)), rows - 1);
+
+		return cv::Rect(c0, r0, MAX(c1 - c0 + 1, 0), MAX(r1 - r0 + 1, 0));
+	}
+
+private:
+	float            x0 = 0.0f, y0 = 0.0f;
+	float            cellSize = 16.0f;
+	int              cols = 0, rows = 0;
+	std::vector<int> cellStart;
+	std::vector<int> items;
+	std::vector<int> stamps;	// last query visiting the box
+	int              query = 0;
+};
+
+
+/* @brief Bounding box of a segment. */
+static cv::Rect2f segmentBox(const LineSegment& seg)
+{
+	float x0 = MIN(seg.begPx.x, seg.endPx.x), y0 = MIN(seg.begPx.y, seg.endPx.y);
+	float x1 = MAX(seg.begPx.x, seg.endPx.x), y1 = MAX(seg.begPx.y, seg.endPx.y);
+
+	return cv::Rect2f(x0, y0, x1 - x0, y1 - y0);
+}
+
+
+/* @brief Segment's length in float. */
+static inline float segLength(const LineSegment& seg)
+{
+	float dx = seg.begPx.x - seg.endPx.x, dy = seg.begPx.y - seg.endPx.y;
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+
+/*---------------------- HPatches repeatability ----------------------*/
+
+/* @brief Open a directory of CSV files or a binary segment file. */
+bool DetectionSource::open(const std::string& path)
+{
+	std::error_code ec;
+	if (fs::is_directory(path, ec))
+	{
+		dir = path;
+		isBinary = false;
+		return true;
+	}
+
+	if (!reader.open(path))
+	{
+		std::cerr << "Opening " << path << " failed." << std::endl;
+		return false;
+	}
+
+	// image name, e.g. 'i_ajuntament/2.ppm' -> 'i_ajuntament/2' and '2'
+	stems.clear();
+	names.clear();
+	for (size_t i = 0; i != reader.size(); ++i)
+	{
+		fs::path name(reader.name(i));
+		std::string stem = name.stem().string();
+		stems[name.parent_path().filename().string() + '/' + stem] = i;
+		names[stem] = i;
+	}
+
+	isBinary = true;
+	return true;
+}
+
+
+/* @brief Load detections of an image by stem. */
+bool DetectionSource::load(
+	const std::string&  stem,
+	LineSegList&        segments,
+	std::vector<float>* scores
+) const
+{
+	segments.clear();
+	if (scores != nullptr)
+		scores->clear();
+
+	if (!isBinary)
+	{
+		std::string filepath = dir + '/' + stem + ".csv";
+		std::error_code ec;
+		return fs::is_regular_file(filepath, ec) && readSegmentText(filepath, segments, ',');
+	}
+
+	const auto& lookup = stem.find('/') == std::string::npos ? names : stems;
+	auto it = lookup.find(stem);
+	if (it == lookup.end())
+		return false;
+
+	SegmentView segView = reader.view(it->second);
+	segView.toList(segments);
+
+	if (scores != nullptr && reader.hasScore())
+	{
+		scores->resize(segView.count);
+		for (size_t i = 0; i != segView.count; ++i)
+			(*scores)[i] = segView.score(i);
+	}
+
+	return true;
+}
+
+
+/* @brief Read a 3x3 homography matrix of HPatches. */
+bool readHomography(
+	const std::string& filepath,
+	cv::Matx33f&       H
+)
+{
+	std::ifstream ifs(filepath);
+	if (!ifs.is_open())
+		return false;
+
+	for (int i = 0; i != 9; ++i)
+	{
+		if (!(ifs >> H.val[i]))
+			return false;
+	}
+
+	return true;
+}
+
+
+/* @brief Apply homography to segments, the same as transform_ref_segments. */
+void transformSegments(
+	const LineSegList& segments,
+	const cv::Matx33f& H,
+	LineSegList&       result
+)
+{
+	auto warp = [&H](const Pixel& px)->Pixel {
+		float x = H(0, 0) * px.x + H(0, 1) * px.y + H(0, 2);
+		float y = H(1, 0) * px.x + H(1, 1) * px.y + H(1, 2);
+		float w = H(2, 0) * px.x + H(2, 1) * px.y + H(2, 2);
+		return Pixel(x / w, y / w);
+	};
+
+	result.clear();
+	result.reserve(segments.size());
+	for (const auto& seg : segments)
+		result.emplace_back(warp(seg.begPx), warp(seg.endPx));
+
+	return;
+}
+
+
+/* @brief Project a point to the line of segment, the same as proj_points_to_line. */
+static inline Pixel projectPoint(
+	const LineSegment& seg,
+	const Pixel&       px
+)
+{
+	float vx = seg.endPx.x - seg.begPx.x, vy = seg.endPx.y - seg.begPx.y;
+	float mx = px.x - seg.begPx.x, my = px.y - seg.begPx.y;
+
+	float dot = vx * mx + vy * my;
+	float norm = vx * vx + vy * vy;
+
+	return Pixel(seg.begPx.x + vx * dot / norm, seg.begPx.y + vy * dot / norm);
+}
+
+
+/* @brief Perpendicular distance from the point to the line of segment. */
+static inline float perpendDistance(
+	const LineSegment& seg,
+	const Pixel&       px
+)
+{
+	Pixel proj = projectPoint(seg, px);
+	float dx = proj.x - px.x, dy = proj.y - px.y;
+
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+
+/* @brief Line angle, the same as line_angle_diff. */
+static inline float lineAngleRad(const LineSegment& seg)
+{
+	const float eps = 1e-6f;
+	return std::atan((seg.endPx.y - seg.begPx.y) / (seg.endPx.x - seg.begPx.x + eps));
+}
+
+
+/* @brief Intersection length of reference segment and predicted segment projected on it,
+the same as intersec_length. */
+static float intersecLength(
+	const LineSegment& ref,
+	const LineSegment& pred
+)
+{
+	// if result <= 0, point a is in segment (b, c)
+	auto isIn = [](const Pixel& a, const Pixel& b, const Pixel& c)->bool {
+		return (b.x - a.x) * (c.x - a.x) + (b.y - a.y) * (c.y - a.y) <= 0.0f; };
+
+	auto dist = [](const Pixel& a, const Pixel& b)->float {
+		return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y)); };
+
+	LineSegment proj(projectPoint(ref, pred.begPx), projectPoint(ref, pred.endPx));
+
+	float lenRef = segLength(ref);
+	float lenProj = segLength(proj);
+	if (lenProj < 1.0f)
+		return 0.0f;
+
+	bool proj0In = isIn(proj.begPx, ref.begPx, ref.endPx);
+	bool proj1In = isIn(proj.endPx, ref.begPx, ref.endPx);
+	bool ref0In = isIn(ref.begPx, proj.begPx, proj.endPx);
+	bool ref1In = isIn(ref.endPx, proj.begPx, proj.endPx);
+
+	// reference segment is in projected segment
+	if (ref0In && ref1In)
+		return lenRef;
+
+	// projected segment is in reference segment
+	if (proj0In && proj1In)
+		return lenProj;
+
+	if (proj0In && !proj1In && ref0In && !ref1In)
+		return dist(proj.begPx, ref.begPx);
+
+	if (!proj0In && proj1In && ref0In && !ref1In)
+		return dist(proj.endPx, ref.begPx);
+
+	if (proj0In && !proj1In && !ref0In && ref1In)
+		return dist(proj.begPx, ref.endPx);
+
+	if (!proj0In && proj1In && !ref0In && ref1In)
+		return dist(proj.endPx, ref.endPx);
+
+	// no intersection
+	return 0.0f;
+}
+
+
+/* @brief Repeatability between reference segments and predicted segments. */
+bool repeatability(
+	const LineSegList&  refSegments,
+	const LineSegList&  predSegments,
+	const RepeatParams& params,
+	double&             rep
+)
+{
+	rep = 0.0;
+
+	size_t numRef = refSegments.size(), numPred = predSegments.size();
+	if (numRef == 0 || numPred == 0)
+		return false;
+
+	std::vector<float> refLens(numRef), predLens(numPred), predAngs(numPred);
+	std::vector<Pixel> predMids(numPred);
+	for (size_t i = 0; i != numPred; ++i)
+	{
+		const auto& pred = predSegments[i];
+		predLens[i] = segLength(pred);
+		predAngs[i] = lineAngleRad(pred);
+		predMids[i] = Pixel((pred.begPx.x + pred.endPx.x) * 0.5f, (pred.begPx.y + pred.endPx.y) * 0.5f);
+	}
+
+	// A pair is matched only if the predicted segment, projected on the reference line,
+	// overlaps the reference segment. Its center is then within distThresh of the line
+	// and half its length of the segment's extent along the line, so a square of
+	// radius distThresh + length / 2 around the center touches the reference segment.
+	// Without area threshold any pair may match, and all pairs are checked.
+	std::vector<cv::Rect2f> boxes(numPred);
+	for (size_t i = 0; i != numPred; ++i)
+	{
+		float radius = params.distThresh + 0.5f * predLens[i] + 1.0f;
+		boxes[i] = cv::Rect2f(predMids[i].x - radius, predMids[i].y - radius, 2 * radius, 2 * radius);
+	}
+
+	BoxGrid grid;
+	grid.build(boxes, 16.0f);
+
+	double numTPInst = 0.0, numTPPixel = 0.0;
+	double sumRefLen = 0.0, sumPredLen = 0.0;
+
+	std::vector<int> candidates;
+	for (size_t ind = 0; ind != numRef; ++ind)
+	{
+		const auto& ref = refSegments[ind];
+		refLens[ind] = segLength(ref);
+
+		Pixel refMid((ref.begPx.x + ref.endPx.x) * 0.5f, (ref.begPx.y + ref.endPx.y) * 0.5f);
+		float refAng = lineAngleRad(ref);
+
+		if (params.areaThresh > 0.0f)
+		{
+			grid.find(segmentBox(ref), candidates);
+		}
+		else
+		{
+			candidates.resize(numPred);
+			for (int i = 0; i != numPred; ++i)
+				candidates[i] = i;
+		}
+
+		bool isMatched = false;
+		float sumIntersec = 0.0f;
+		for (int predInd : candidates)
+		{
+			const auto& pred = predSegments[predInd];
+
+			// center distances of both directions, and angle difference
+			if (perpendDistance(ref, predMids[predInd]) > params.distThresh ||
+				perpendDistance(pred, refMid) > params.distThresh ||
+				refAng - predAngs[predInd] > params.angThresh)
+				continue;
+
+			// cross check, in order to avoid over-connection
+			float intersec = intersecLength(ref, pred);
+			if (intersec / refLens[ind] >= params.areaThresh &&
+				intersec / predLens[predInd] >= params.areaThresh)
+			{
+				isMatched = true;
+				sumIntersec += intersec;
+			}
+		}
+
+		if (isMatched)
+		{
+			numTPInst += 1.0;
+			numTPPixel += sumIntersec;
+		}
+	}
+
+	if (params.pixelwise)
+	{
+		for (float len : refLens)
+			sumRefLen += len;
+		for (float len : predLens)
+			sumPredLen += len;
+
+		rep = 0.5 * numTPPixel * (1.0 / sumRefLen + 1.0 / sumPredLen);
+	}
+	else
+	{
+		rep = 0.5 * numTPInst * (1.0 / numRef + 1.0 / numPred);
+	}
+
+	return true;
+}
+
+
+/* @brief Evaluate every sequence of HPatches in parallel, sorted by name. */
+bool evaluateHPatches(
+	const std::string&           hpatchesDir,
+	const DetectionSource&       source,
+	const RepeatParams&          params,
+	std::vector<SequenceResult>& results
+)
+{
+	results.clear();
+
+	std::error_code ec;
+	if (!fs::is_directory(hpatchesDir, ec))
+	{
+		std::cerr << "The directory does not exist or is not a directory." << std::endl;
+		return false;
+	}
+
+	for (const auto& entry : fs::directory_iterator(hpatchesDir, ec))
+	{
+		if (entry.is_directory(ec))
+		{
+			results.emplace_back();
+			results.back().name = entry.path().filename().string();
+		}
+	}
+
+	std::sort(results.begin(), results.end(),
+		[](const SequenceResult& lhs, const SequenceResult& rhs)->bool { return lhs.name < rhs.name; });
+
+	cv::parallel_for_(cv::Range(0, int(results.size())), [&](const cv::Range& range) {
+		LineSegList refSegments, homoSegments, predSegments;
+
+		for (int seqInd = range.start; seqInd != range.end; ++seqInd)
+		{
+			auto& result = results[seqInd];
+			result.isValid = source.load(result.name, 1, refSegments);
+
+			double meanRep = 0.0;
+			for (int i = 2; i <= 6 && result.isValid; ++i)
+			{
+				cv::Matx33f H;
+				std::string homoPath = hpatchesDir + '/' + result.name + "/H_1_" + std::to_string(i);
+
+				double rep = 0.0;
+				result.isValid = readHomography(homoPath, H) &&
+					source.load(result.name, i, predSegments);
+
+				if (result.isValid)
+				{
+					// apply homography to reference segments
+					transformSegments(refSegments, H, homoSegments);
+					result.isValid = repeatability(homoSegments, predSegments, params, rep);
+				}
+
+				meanRep += rep;
+			}
+
+			result.rep = meanRep / 5.0;
+		}
+	});
+
+	bool isOK = true;
+	for (const auto& result : results)
+	{
+		if (!result.isValid)
+		{
+			std::cerr << "Evaluating " << result.name << " failed." << std::endl;
+			isOK = false;
+		}
+	}
+
+	return isOK;
+}
+
+
+/*---------------------- YorkUrban accuracy ----------------------*/
+
+/* @brief Add counts of another image. */
+void AccuracyCounts::merge(const AccuracyCounts& other)
+{
+	if (tpPred.empty())
+	{
+		tpPred.assign(other.tpPred.size(), 0.0);
+		tpGT.assign(other.tpGT.size(), 0.0);
+		ranks.resize(other.ranks.size());
+	}
+
+	for (size_t k = 0; k != tpPred.size(); ++k)
+	{
+		tpPred[k] += other.tpPred[k];
+		tpGT[k] += other.tpGT[k];
+	}
+
+	for (size_t k = 0; k != ranks.size(); ++k)
+		ranks[k].insert(ranks[k].end(), other.ranks[k].begin(), other.ranks[k].end());
+
+	numPredPx += other.numPredPx;
+	numGTPx += other.numGTPx;
+	numGT += other.numGT;
+
+	return;
+}
+
+
+/* @brief Distance from the point to the segment. */
+static inline float pointSegDist(
+	const LineSegment& seg,
+	const Pixel&       px
+)
+{
+	float vx = seg.endPx.x - seg.begPx.x, vy = seg.endPx.y - seg.begPx.y;
+	float wx = px.x - seg.begPx.x, wy = px.y - seg.begPx.y;
+
+	float norm = vx * vx + vy * vy;
+	float t = norm > 0.0f ? (vx * wx + vy * wy) / norm : 0.0f;
+	t = MIN(MAX(t, 0.0f), 1.0f);
+
+	float dx = wx - t * vx, dy = wy - t * vy;
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+
+/* @brief Sample points along the segment at unit spacing, both endpoints included. */
+static void samplePoints(
+	const LineSegment& seg,
+	std::vector<Pixel>& pts
+)
+{
+	int num = MAX(int(std::round(segLength(seg))), 1);
+	float dx = (seg.endPx.x - seg.begPx.x) / num, dy = (seg.endPx.y - seg.begPx.y) / num;
+
+	pts.resize(num + 1);
+	for (int i = 0; i <= num; ++i)
+		pts[i] = Pixel(seg.begPx.x + i * dx, seg.begPx.y + i * dy);
+
+	return;
+}
+
+
+/* @brief Count sample points of segments within each threshold of any segment of the other set. */
+static void countMatchedPixels(
+	const LineSegList&        segments,
+	const LineSegList&        others,
+	const std::vector<float>& thresh,
+	std::vector<double>&      matched,
+	double&                   total
+)
+{
+	matched.assign(thresh.size(), 0.0);
+	total = 0.0;
+
+	float maxThresh = 0.0f;
+	for (float t : thresh)
+		maxThresh = MAX(maxThresh, t);
+
+	std::vector<cv::Rect2f> boxes(others.size());
+	for (size_t i = 0; i != others.size(); ++i)
+	{
+		cv::Rect2f box = segmentBox(others[i]);
+		boxes[i] = cv::Rect2f(box.x - maxThresh, box.y - maxThresh,
+			box.width + 2 * maxThresh, box.height + 2 * maxThresh);
+	}
+
+	BoxGrid grid;
+	grid.build(boxes, 16.0f);
+
+	std::vector<Pixel> pts;
+	std::vector<int> candidates;
+	for (const auto& seg : segments)
+	{
+		samplePoints(seg, pts);
+		total += pts.size();
+
+		for (const auto& px : pts)
+		{
+			grid.find(cv::Rect2f(px.x, px.y, 0.0f, 0.0f), candidates);
+
+			float minDist = FLT_MAX;
+			for (int ind : candidates)
+				minDist = MIN(minDist, pointSegDist(others[ind], px));
+
+			for (size_t k = 0; k != thresh.size(); ++k)
+				matched[k] += minDist <= thresh[k];
+		}
+	}
+
+	return;
+}
+
+
+/* @brief Accumulate accuracy counts of an image. */
+void accumulateAccuracy(
+	const LineSegList&        gtSegments,
+	const LineSegList&        predSegments,
+	const std::vector<float>& scores,
+	const AccuracyParams&     params,
+	AccuracyCounts&           counts
+)
+{
+	AccuracyCounts image;
+
+	// 1. pixel-level, precision from detections, recall from ground truth
+	countMatchedPixels(predSegments, gtSegments, params.pixelThresh, image.tpPred, image.numPredPx);
+	countMatchedPixels(gtSegments, predSegments, params.pixelThresh, image.tpGT, image.numGTPx);
+
+	// 2. structural AP, a detection is matched to its nearest ground truth,
+	// which is true positive if close enough and not matched by a higher-ranked detection
+	size_t numThresh = params.sapThresh.size();
+	image.ranks.resize(numThresh);
+	image.numGT = gtSegments.size();
+
+	std::vector<float> keys(scores);
+	if (keys.size() != predSegments.size())
+	{
+		keys.resize(predSegments.size());
+		for (size_t i = 0; i != keys.size(); ++i)
+			keys[i] = segLength(predSegments[i]);
+	}
+
+	std::vector<int> order(predSegments.size());
+	for (int i = 0; i != order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](int lhs, int rhs)->bool {
+		return keys[lhs] > keys[rhs]; });
+
+	// both endpoints of a matched pair are within this radius in image coordinates
+	float maxThresh = 0.0f;
+	for (float t : params.sapThresh)
+		maxThresh = MAX(maxThresh, t);
+	float radius = std::sqrt(maxThresh) / params.sapScale;
+
+	std::vector<cv::Rect2f> boxes(gtSegments.size());
+	for (size_t i = 0; i != gtSegments.size(); ++i)
+	{
+		cv::Rect2f box = segmentBox(gtSegments[i]);
+		boxes[i] = cv::Rect2f(box.x - radius, box.y - radius, box.width + 2 * radius, box.height + 2 * radius);
+	}
+
+	BoxGrid grid;
+	grid.build(boxes, 16.0f);
+
+	auto sqDist = [](const Pixel& a, const Pixel& b)->float {
+		return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y); };
+
+	float scale2 = params.sapScale * params.sapScale;
+	std::vector<std::vector<bool>> isHit(numThresh, std::vector<bool>(gtSegments.size(), false));
+	std::vector<int> candidates;
+
+	for (int predInd : order)
+	{
+		const auto& pred = predSegments[predInd];
+		grid.find(segmentBox(pred), candidates);
+
+		int nearest = -1;
+		float minDist = FLT_MAX;
+		for (int gtInd : candidates)
+		{
+			const auto& gt = gtSegments[gtInd];
+			float dist = scale2 * MIN(
+				sqDist(pred.begPx, gt.begPx) + sqDist(pred.endPx, gt.endPx),
+				sqDist(pred.begPx, gt.endPx) + sqDist(pred.endPx, gt.begPx));
+
+			if (dist < minDist)
+			{
+				minDist = dist;
+				nearest = gtInd;
+			}
+		}
+
+		for (size_t k = 0; k != numThresh; ++k)
+		{
+			bool isTP = nearest >= 0 && minDist < params.sapThresh[k] && !isHit[k][nearest];
+			if (isTP)
+				isHit[k][nearest] = true;
+
+			image.ranks[k].emplace_back(keys[predInd], isTP);
+		}
+	}
+
+	counts.merge(image);
+
+	return;
+}
+
+
+/* @brief Average precision of ranked detections, as L-CNN. */
+static double averagePrecision(
+	std::vector<std::pair<float, bool>> ranks,
+	size_t                              numGT
+)
+{
+	if (numGT == 0)
+		return 0.0;
+
+	std::stable_sort(ranks.begin(), ranks.end(),
+		[](const std::pair<float, bool>& lhs, const std::pair<float, bool>& rhs)->bool {
+		return lhs.first > rhs.first; });
+
+	// recall and precision, padded with (0, 0) and (1, 0)
+	std::vector<double> recall(1, 0.0), precision(1, 0.0);
+	double tp = 0.0;
+	for (size_t i = 0; i != ranks.size(); ++i)
+	{
+		tp += ranks[i].second;
+		recall.push_back(tp / numGT);
+		precision.push_back(tp / (i + 1));
+	}
+	recall.push_back(1.0);
+	precision.push_back(0.0);
+
+	// precision envelope
+	for (size_t i = precision.size() - 1; i != 0; --i)
+		precision[i - 1] = MAX(precision[i - 1], precision[i]);
+
+	double ap = 0.0;
+	for (size_t i = 0; i + 1 != recall.size(); ++i)
+	{
+		if (recall[i + 1] != recall[i])
+			ap += (recall[i + 1] - recall[i]) * precision[i + 1];
+	}
+
+	return ap;
+}
+
+
+/* @brief Compute metrics from accumulated counts. */
+void computeAccuracy(
+	const AccuracyCounts& counts,
+	AccuracyResult&       result
+)
+{
+	size_t numThresh = counts.tpPred.size();
+	result.precision.assign(numThresh, 0.0);
+	result.recall.assign(numThresh, 0.0);
+	result.fscore.assign(numThresh, 0.0);
+
+	for (size_t k = 0; k != numThresh; ++k)
+	{
+		double p = counts.numPredPx > 0 ? counts.tpPred[k] / counts.numPredPx : 0.0;
+		double r = counts.numGTPx > 0 ? counts.tpGT[k] / counts.numGTPx : 0.0;
+
+		result.precision[k] = 100.0 * p;
+		result.recall[k] = 100.0 * r;
+		result.fscore[k] = p + r > 0 ? 100.0 * 2 * p * r / (p + r) : 0.0;
+	}
+
+	result.sAP.resize(counts.ranks.size());
+	for (size_t k = 0; k != counts.ranks.size(); ++k)
+		result.sAP[k] = 100.0 * averagePrecision(counts.ranks[k], counts.numGT);
+
+	return;
+}
+
+
+/* @brief Evaluate every label file of YorkUrban in parallel. */
+bool evaluateYorkUrban(
+	const std::string&     labelDir,
+	const DetectionSource& source,
+	const AccuracyParams&  params,
+	AccuracyResult&        result
+)
+{
+	result = AccuracyResult();
+
+	std::vector<std::string> filenames;
+	std::vector<LineSegList> gtLists;
+	if (!loadSegmentDir(labelDir, ".txt", filenames, gtLists))
+		return false;
+
+	std::vector<AccuracyCounts> imageCounts(filenames.size());
+	std::vector<uchar> isValid(filenames.size(), 0);
+
+	cv::parallel_for_(cv::Range(0, int(filenames.size())), [&](const cv::Range& range) {
+		LineSegList predSegments;
+		std::vector<float> scores;
+
+		for (int i = range.start; i != range.end; ++i)
+		{
+			std::string stem = fs::path(filenames[i]).stem().string();
+			isValid[i] = source.load(stem, predSegments, &scores);
+
+			if (isValid[i])
+				accumulateAccuracy(gtLists[i], predSegments, scores, params, imageCounts[i]);
+		}
+	});
+
+	// merged in file order, results do not depend on scheduling
+	bool isOK = true;
+	AccuracyCounts counts;
+	for (size_t i = 0; i != filenames.size(); ++i)
+	{
+		if (!isValid[i])
+		{
+			std::cerr << "No detection of " << filenames[i] << "." << std::endl;
+			isOK = false;
+			continue;
+		}
+
+		counts.merge(imageCounts[i]);
+		++result.numImages;
+	}
+
+	computeAccuracy(counts, result);
+
+	return isOK;
+}
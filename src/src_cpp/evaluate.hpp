@@ -0,0 +1,183 @@
+#ifndef __EVALUATE_HPP__
+#define __EVALUATE_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "segments.hpp"
+#include "iofile.hpp"
+
+
+/*---------------------- HPatches repeatability ----------------------*/
+
+/* @brief Thresholds of repeatability, defaults are the ones of evaluation/repeatability_eval.py. */
+struct RepeatParams
+{
+	float distThresh = 3.0f;						// perpendicular distance between centers
+	float angThresh = float(3.0 * CV_PI / 180.0);	// angle difference in radian
+	float areaThresh = 0.75f;						// intersection ratio of both segments
+	bool  pixelwise = false;						// pixel-level or instance-level
+};
+
+
+/* @brief Repeatability result of a HPatches sequence. */
+struct SequenceResult
+{
+	std::string name;
+	double      rep = 0.0;	// mean of 5 image pairs
+	bool        isValid = false;
+};
+
+
+/* @brief Detections of images, from CSV files '<dir>/<stem>.csv' or a binary segment file.
+A stem is an image name without extension, optionally with its parent folder,
+e.g. '<sequence>/<i>' of HPatches, or 'P1020171' of YorkUrban. */
+class DetectionSource
+{
+public:
+	/* @brief Open a directory of CSV files or a binary segment file. */
+	bool open(const std::string& path);
+
+	/* @brief Load detections of an image by stem, thread-safe.
+	* @param scores: scores of segments if not null, empty if the source has no score. */
+	bool load(
+		const std::string&  stem,
+		LineSegList&        segments,
+		std::vector<float>* scores = nullptr
+	) const;
+
+	/* @brief Load detections of i-th image of the HPatches sequence. */
+	bool load(
+		const std::string& sequence,
+		int                ind,
+		LineSegList&       segments
+	) const
+	{
+		return load(sequence + '/' + std::to_string(ind), segments);
+	}
+
+private:
+	std::string                             dir;
+	bool                                    isBinary = false;
+	SegmentFileReader                       reader;
+	std::unordered_map<std::string, size_t> stems;	// '<parent>/<stem>' -> image index
+	std::unordered_map<std::string, size_t> names;	// '<stem>' -> image index
+};
+
+
+/* @brief Read a 3x3 homography matrix of HPatches, e.g. 'H_1_2'. */
+extern
+bool readHomography(
+	const std::string& filepath,
+	cv::Matx33f&       H
+);
+
+
+/* @brief Apply homography to segments, the same as transform_ref_segments. */
+extern
+void transformSegments(
+	const LineSegList& segments,
+	const cv::Matx33f& H,
+	LineSegList&       result
+);
+
+
+/* @brief Repeatability between reference segments (warped to the test image) and predicted segments.
+Candidate pairs are limited by a uniform grid, the result equals the all-pairs evaluation.
+* @return false if any of the segment lists is empty. */
+extern
+bool repeatability(
+	const LineSegList&  refSegments,
+	const LineSegList&  predSegments,
+	const RepeatParams& params,
+	double&             rep
+);
+
+
+/* @brief Evaluate every sequence of HPatches in parallel, sorted by name.
+Image 1 is the reference of images 2..6 in each sequence. */
+extern
+bool evaluateHPatches(
+	const std::string&           hpatchesDir,
+	const DetectionSource&       source,
+	const RepeatParams&          params,
+	std::vector<SequenceResult>& results
+);
+
+
+/*---------------------- YorkUrban accuracy ----------------------*/
+
+/* @brief Thresholds of accuracy metrics. */
+struct AccuracyParams
+{
+	// a pixel is matched if it is within the distance of a segment of the other set
+	std::vector<float> pixelThresh = { 1.0f, 2.0f, 3.0f };
+
+	// structural AP, sum of squared endpoint distances, as L-CNN
+	std::vector<float> sapThresh = { 5.0f, 10.0f, 15.0f };
+
+	// coordinates are scaled before sAP matching, e.g. 128 / 640 for the L-CNN convention
+	float sapScale = 1.0f;
+};
+
+
+/* @brief Counts of an image, summed over the dataset before computing metrics. */
+struct AccuracyCounts
+{
+	// per pixel threshold
+	std::vector<double> tpPred, tpGT;
+	double numPredPx = 0.0, numGTPx = 0.0;
+
+	// per sAP threshold, (score, is true positive) of every detection
+	std::vector<std::vector<std::pair<float, bool>>> ranks;
+	size_t numGT = 0;
+
+	/* @brief Add counts of another image. */
+	void merge(const AccuracyCounts& other);
+};
+
+
+/* @brief Metrics of the dataset, in percentage. */
+struct AccuracyResult
+{
+	std::vector<double> precision, recall, fscore;	// per pixel threshold
+	std::vector<double> sAP;						// per sAP threshold
+	int                 numImages = 0;
+};
+
+
+/* @brief Accumulate accuracy counts of an image.
+Segments of the other set are found through a uniform grid, not all pairs.
+* @param scores: ranking of detections for sAP, segment length is used if empty. */
+extern
+void accumulateAccuracy(
+	const LineSegList&        gtSegments,
+	const LineSegList&        predSegments,
+	const std::vector<float>& scores,
+	const AccuracyParams&     params,
+	AccuracyCounts&           counts
+);
+
+
+/* @brief Compute metrics from accumulated counts. */
+extern
+void computeAccuracy(
+	const AccuracyCounts& counts,
+	AccuracyResult&       result
+);
+
+
+/* @brief Evaluate every label file of YorkUrban in parallel, e.g. '<labelDir>/P1020171.txt'
+read by extractYUK, detections are found by the label's stem. */
+extern
+bool evaluateYorkUrban(
+	const std::string&     labelDir,
+	const DetectionSource& source,
+	const AccuracyParams&  params,
+	AccuracyResult&        result
+);
+
+
+#endif // !__EVALUATE_HPP__
@@ -0,0 +1,360 @@
+#include "gradcache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+
+constexpr uint32_t GRADCACHE_MAGIC = 'A' | 'A' << 8 | 'G' << 16 | 'C' << 24;
+constexpr uint32_t GRADCACHE_VERSION = 2;
+constexpr uint32_t GRADCACHE_HAS_GRAD = 1;
+
+
+struct GradCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t flags;
+	int32_t  width;
+	int32_t  height;
+	int32_t  kernelType;
+	int32_t  blurSize;
+	uint32_t reserved0;
+	double   blurSigma;
+	uint64_t contentHash;
+	uint64_t contentSize;	// bytes of the image file
+	uint64_t contentCheck;	// second hash of the image file, independent of the key
+};
+
+static_assert(sizeof(GradCacheHeader) == 64, "cache header must be 64 bytes");
+
+
+/* @brief 64-bit FNV-1a hash, continued from the given hash. */
+static uint64_t fnv1a(
+	const void* data,
+	size_t      size,
+	uint64_t    hash = 14695981039346656037ull
+)
+{
+	const uint8_t* ptr = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i != size; ++i)
+	{
+		hash ^= ptr[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+
+/* @brief Multiply-xorshift hash of 8-byte words, unrelated to FNV-1a, tells apart files whose keys collide. */
+static uint64_t wordHash(
+	const void* data,
+	size_t      size
+)
+{
+	const uint8_t* ptr = static_cast<const uint8_t*>(data);
+	uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, ptr + i, sizeof(word));
+		hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+		hash ^= hash >> 32;
+	}
+
+	uint64_t tail = 0;
+	std::memcpy(&tail, ptr + i, size - i);
+	hash = (hash ^ tail) * 0xc4ceb9fe1a85ec53ull;
+
+	return hash ^ (hash >> 29);
+}
+
+
+/* @brief Rebuild gx/gy from L1 magnitude and orientation in [0, 180].
+Signs follow the folded orientation, consumers only read absolute values and ratios. */
+static void rebuildGradients(GradientInfo* pGradInfo)
+{
+	const cv::Mat& mag = pGradInfo->mag;
+	const cv::Mat& ori = pGradInfo->ori;
+
+	pGradInfo->gradx.create(mag.rows, mag.cols, CV_32FC1);
+	pGradInfo->grady.create(mag.rows, mag.cols, CV_32FC1);
+
+	for (int row = 0; row != mag.rows; ++row)
+	{
+		const float* magPtr = mag.ptr<float>(row);
+		const float* oriPtr = ori.ptr<float>(row);
+		float* gxPtr = pGradInfo->gradx.ptr<float>(row);
+		float* gyPtr = pGradInfo->grady.ptr<float>(row);
+
+		for (int col = 0; col != mag.cols; ++col)
+		{
+			float rad = oriPtr[col] * float(CV_PI / 180.0);
+			float c = std::cos(rad), s = std::sin(rad);
+			float norm = std::abs(c) + std::abs(s);
+
+			gxPtr[col] = magPtr[col] * c / norm;
+			gyPtr[col] = magPtr[col] * s / norm;
+		}
+	}
+
+	return;
+}
+
+
+/* @brief Open or create the cache directory, and evict files over the limit. */
+bool GradientCache::open(
+	const std::string& _dir,
+	uint64_t           _maxBytes,
+	bool               _storeGrad
+)
+{
+	std::error_code ec;
+	fs::create_directories(_dir, ec);
+	if (!fs::is_directory(_dir, ec))
+	{
+		std::cerr << "Creating cache directory failed." << std::endl;
+		return false;
+	}
+
+	dir = _dir;
+	maxBytes = _maxBytes;
+	storeGrad = _storeGrad;
+	hits = misses = 0;
+
+	evict();
+
+	return true;
+}
+
+
+/* @brief Gradient information of an image file, from cache if present. */
+bool GradientCache::load(
+	const std::string& imgPath,
+	GradientInfo*      pGradInfo,
+	int                kernelType,
+	int                blurSize,
+	double             blurSigma,
+	bool*              isHit
+)
+{
+	if (isHit != nullptr)
+		*isHit = false;
+
+	MappedFile img;
+	if (pGradInfo == nullptr || !img.open(imgPath))
+		return false;
+
+	// key of content and parameters
+	uint64_t contentHash = fnv1a(img.data(), img.size());
+	uint64_t contentCheck = wordHash(img.data(), img.size());
+	uint64_t key = fnv1a(&kernelType, sizeof(kernelType), contentHash);
+	key = fnv1a(&blurSize, sizeof(blurSize), key);
+	key = fnv1a(&blurSigma, sizeof(blurSigma), key);
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.grad", (unsigned long long)key);
+	std::string filepath = dir + '/' + name;
+
+	if (isOpen() && readEntry(filepath, contentHash, img.size(), contentCheck,
+		kernelType, blurSize, blurSigma, pGradInfo))
+	{
+		// most recently used
+		std::error_code ec;
+		fs::last_write_time(filepath, fs::file_time_type::clock::now(), ec);
+
+		++hits;
+		if (isHit != nullptr)
+			*isHit = true;
+		return true;
+	}
+
+	// decode from the mapped bytes, the file is not read twice
+	cv::Mat gray = cv::imdecode(cv::Mat(1, int(img.size()), CV_8UC1, const_cast<char*>(img.data())),
+		cv::IMREAD_GRAYSCALE);
+	if (gray.empty() || !calcGradInfo(makeImageView(gray), pGradInfo, kernelType, blurSize, blurSigma))
+		return false;
+
+	++misses;
+
+	if (isOpen() && writeEntry(filepath, contentHash, img.size(), contentCheck,
+		kernelType, blurSize, blurSigma, pGradInfo) &&
+		totalBytes > maxBytes)
+		evict();
+
+	return true;
+}
+
+
+/* @brief Read cache file, false if missing or not matched. */
+bool GradientCache::readEntry(
+	const std::string& filepath,
+	uint64_t           contentHash,
+	uint64_t           contentSize,
+	uint64_t           contentCheck,
+	int                kernelType,
+	int                blurSize,
+	double             blurSigma,
+	GradientInfo*      pGradInfo
+) const
+{
+	MappedFile file;
+	if (!file.open(filepath) || file.size() < sizeof(GradCacheHeader))
+		return false;
+
+	GradCacheHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if (header.magic != GRADCACHE_MAGIC || header.version != GRADCACHE_VERSION ||
+		header.contentHash != contentHash || header.contentSize != contentSize ||
+		header.contentCheck != contentCheck || header.kernelType != kernelType ||
+		header.blurSize != blurSize || header.blurSigma != blurSigma ||
+		header.width <= 0 || header.height <= 0)
+		return false;
+
+	bool hasGrad = (header.flags & GRADCACHE_HAS_GRAD) != 0;
+	size_t planeBytes = size_t(header.width) * header.height * sizeof(float);
+	if (file.size() != sizeof(header) + (hasGrad ? 4 : 2) * planeBytes)
+		return false;
+
+	// one copy per plane, the mapping is released after loading
+	cv::Mat* planes[4] = { &pGradInfo->mag, &pGradInfo->ori, &pGradInfo->gradx, &pGradInfo->grady };
+	const char* ptr = file.data() + sizeof(header);
+	for (int i = 0; i != (hasGrad ? 4 : 2); ++i, ptr += planeBytes)
+	{
+		planes[i]->create(header.height, header.width, CV_32FC1);
+		std::memcpy(planes[i]->ptr<float>(), ptr, planeBytes);
+	}
+
+	if (!hasGrad)
+		rebuildGradients(pGradInfo);
+
+	// not cached, built on demand by AED::calcSuccessorMap
+	pGradInfo->successors.release();
+
+	return true;
+}
+
+
+/* @brief Write cache file through a temporary file. */
+bool GradientCache::writeEntry(
+	const std::string&  filepath,
+	uint64_t            contentHash,
+	uint64_t            contentSize,
+	uint64_t            contentCheck,
+	int                 kernelType,
+	int                 blurSize,
+	double              blurSigma,
+	const GradientInfo* pGradInfo
+)
+{
+	GradCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = GRADCACHE_MAGIC;
+	header.version = GRADCACHE_VERSION;
+	header.flags = storeGrad ? GRADCACHE_HAS_GRAD : 0;
+	header.width = pGradInfo->mag.cols;
+	header.height = pGradInfo->mag.rows;
+	header.kernelType = kernelType;
+	header.blurSize = blurSize;
+	header.blurSigma = blurSigma;
+	header.contentHash = contentHash;
+	header.contentSize = contentSize;
+	header.contentCheck = contentCheck;
+
+	// unique per thread, concurrent writers of the same entry do not collide
+	std::string tmpPath = filepath + ".tmp" +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	{
+		std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!ofs.is_open())
+			return false;
+
+		ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		const cv::Mat* planes[4] = { &pGradInfo->mag, &pGradInfo->ori, &pGradInfo->gradx, &pGradInfo->grady };
+		for (int i = 0; i != (storeGrad ? 4 : 2); ++i)
+		{
+			for (int row = 0; row != planes[i]->rows; ++row)
+				ofs.write(planes[i]->ptr<char>(row), planes[i]->cols * sizeof(float));
+		}
+
+		if (!ofs.good())
+		{
+			ofs.close();
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+	}
+
+	// an entry being replaced, e.g. stale or of a colliding key, leaves the total
+	std::error_code ec;
+	uint64_t replacedBytes = fs::file_size(filepath, ec);
+	if (ec)
+		replacedBytes = 0;
+
+	fs::rename(tmpPath, filepath, ec);
+	if (ec)
+	{
+		fs::remove(tmpPath, ec);
+		return false;
+	}
+
+	size_t planeBytes = size_t(header.width) * header.height * sizeof(float);
+	totalBytes += sizeof(header) + (storeGrad ? 4 : 2) * planeBytes;
+
+	// never below 0, a concurrent evict may have recounted already
+	uint64_t total = totalBytes.load();
+	while (!totalBytes.compare_exchange_weak(total, total - std::min(total, replacedBytes)))
+		;
+
+	return true;
+}
+
+
+/* @brief Remove least recently used files until the size is under the limit. */
+void GradientCache::evict()
+{
+	std::lock_guard<std::mutex> lock(evictMutex);
+
+	struct Entry
+	{
+		fs::file_time_type time;
+		uint64_t           size;
+		fs::path           path;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+
+	std::error_code ec;
+	for (const auto& entry : fs::directory_iterator(dir, ec))
+	{
+		if (!entry.is_regular_file(ec) || entry.path().extension() != ".grad")
+			continue;
+
+		Entry e{ entry.last_write_time(ec), entry.file_size(ec), entry.path() };
+		if (ec)
+			continue;	// removed by another process
+
+		total += e.size;
+		entries.push_back(e);
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs)->bool {
+		return lhs.time < rhs.time; });
+
+	for (size_t i = 0; i != entries.size() && total > maxBytes; ++i)
+	{
+		if (fs::remove(entries[i].path, ec))
+			total -= entries[i].size;
+	}
+
+	totalBytes = total;
+
+	return;
+}
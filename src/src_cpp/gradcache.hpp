@@ -0,0 +1,96 @@
+#ifndef __GRAD_CACHE_HPP__
+#define __GRAD_CACHE_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "utilities.hpp"
+#include "iofile.hpp"
+
+
+/* On-disk cache of blurred gradient information, one file per image and parameters.
+* File name: 16 hex digits of FNV-1a hash of the image file's content and the parameters.
+* Layout, little-endian:
+*   header: 'AAGC', version, flags(bit0: has gx/gy), width, height, kernel type,
+*           blur size, blur sigma(double), content hash(uint64), content size(uint64),
+*           second content hash(uint64), 64 bytes
+*   planes: mag, ori[, gx, gy], each width * height float32, row-major
+* The header repeats the key's inputs plus the image file's size and a second, unrelated hash,
+* so a stale file or a key collision reads as a miss and the entry is rewritten.
+* Files are written to a temporary name then renamed, so a reader never sees a partial file.
+* Last-write time is touched on every hit, eviction removes the least recently used files. */
+class GradientCache
+{
+public:
+	GradientCache() = default;
+	GradientCache(const GradientCache&) = delete;
+	GradientCache& operator=(const GradientCache&) = delete;
+
+	/* @brief Open or create the cache directory, and evict files over the limit.
+	* @param maxBytes: size limit of all cache files.
+	* @param storeGrad: store gx/gy, otherwise they are rebuilt from mag and ori. */
+	bool open(
+		const std::string& dir,
+		uint64_t           maxBytes = uint64_t(1) << 30,
+		bool               storeGrad = true
+	);
+
+	bool isOpen() const { return !dir.empty(); }
+
+	/* @brief Gradient information of an image file, from cache if present,
+	otherwise read, blurred and computed as calcGradInfo, then stored. Thread-safe.
+	* @param isHit: true if loaded from cache. */
+	bool load(
+		const std::string& imgPath,
+		GradientInfo*      pGradInfo,
+		int                kernelType = 0,
+		int                blurSize = 5,
+		double             blurSigma = 1.0,
+		bool*              isHit = nullptr
+	);
+
+	/* @brief Remove least recently used files until the size is under the limit. */
+	void evict();
+
+	size_t numHits() const { return hits; }
+
+	size_t numMisses() const { return misses; }
+
+private:
+	/* @brief Read cache file, false if missing or not matched. */
+	bool readEntry(
+		const std::string& filepath,
+		uint64_t           contentHash,
+		uint64_t           contentSize,
+		uint64_t           contentCheck,
+		int                kernelType,
+		int                blurSize,
+		double             blurSigma,
+		GradientInfo*      pGradInfo
+	) const;
+
+	/* @brief Write cache file through a temporary file. */
+	bool writeEntry(
+		const std::string&  filepath,
+		uint64_t            contentHash,
+		uint64_t            contentSize,
+		uint64_t            contentCheck,
+		int                 kernelType,
+		int                 blurSize,
+		double              blurSigma,
+		const GradientInfo* pGradInfo
+	);
+
+private:
+	std::string           dir;
+	uint64_t              maxBytes = 0;
+	bool                  storeGrad = true;
+	std::atomic<uint64_t> totalBytes{ 0 };
+	std::atomic<size_t>   hits{ 0 }, misses{ 0 };
+	std::mutex            evictMutex;
+};
+
+
+#endif // !__GRAD_CACHE_HPP__
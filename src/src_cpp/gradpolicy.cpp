@@ -0,0 +1,140 @@
+#include "gradpolicy.hpp"
+
+
+/* @brief Filter taps of a pixel from the rows above, at and below it,
+xl and xr are the left and right columns, clamped at the borders. */
+template <int Kernel>
+static inline void gradientTaps(
+	const uchar* r0,
+	const uchar* r1,
+	const uchar* r2,
+	int          xl,
+	int          x,
+	int          xr,
+	float&       gx,
+	float&       gy
+)
+{
+	if (Kernel == MASK2x2)
+	{
+		// the 2x2 window is anchored at its bottom-right pixel, rows y-1 and y
+		gx = float(r0[x] - r0[xl] + r1[x] - r1[xl]);
+		gy = float(r1[xl] + r1[x] - r0[xl] - r0[x]);
+	}
+	else
+	{
+		gx = float(r0[xr] - r0[xl] + 2 * (r1[xr] - r1[xl]) + r2[xr] - r2[xl]);
+		gy = float(r2[xl] + 2 * r2[x] + r2[xr] - r0[xl] - 2 * r0[x] - r0[xr]);
+	}
+}
+
+
+/* @brief Magnitude and orientation of a gradient, as calcMagnitude and calcOrientation. */
+template <typename Policy>
+static inline void magnitudeOrientation(
+	float  gx,
+	float  gy,
+	float& mag,
+	float& ori
+)
+{
+	float val = Policy::useL1 ? std::abs(gx) + std::abs(gy) : std::sqrt(gx * gx + gy * gy);
+	mag = val < Policy::minGrad ? 0.f : val;
+
+	// negative y is flipped to the other half-plane, the range is [0, 180]
+	bool isFlip = gy < 0 && gx != 0;
+	ori = std::atan2(isFlip ? -gy : gy, isFlip ? -gx : gx) * 180.0 / CV_PI;
+}
+
+
+/* @brief Gradient, magnitude and orientation of an 8-bit gray image in one pass. */
+template <typename Policy>
+bool calcGradInfoFused(
+	const cv::Mat& src,
+	GradientInfo*  pGradInfo
+)
+{
+	if (src.empty() || src.type() != CV_8UC1 || pGradInfo == nullptr)
+		return false;
+
+	const int rows = src.rows, cols = src.cols;
+
+	// a successor map of previous magnitudes is stale
+	pGradInfo->successors.release();
+
+	pGradInfo->gradx.create(rows, cols, CV_32FC1);
+	pGradInfo->grady.create(rows, cols, CV_32FC1);
+	pGradInfo->mag.create(rows, cols, CV_32FC1);
+	pGradInfo->ori.create(rows, cols, CV_32FC1);
+
+	const ImageView<const uchar> srcView(src);
+	const ImageView<float> gradx(pGradInfo->gradx), grady(pGradInfo->grady);
+	const ImageView<float> mag(pGradInfo->mag), ori(pGradInfo->ori);
+
+	cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+		for (int y = range.start; y != range.end; ++y)
+		{
+			// BORDER_REPLICATE
+			const uchar* r0 = srcView.row(MAX(y - 1, 0));
+			const uchar* r1 = srcView.row(y);
+			const uchar* r2 = srcView.row(MIN(y + 1, rows - 1));
+
+			float* gxPtr = gradx.row(y);
+			float* gyPtr = grady.row(y);
+			float* magPtr = mag.row(y);
+			float* oriPtr = ori.row(y);
+
+			auto pixel = [&](int xl, int x, int xr) {
+				gradientTaps<Policy::kernel>(r0, r1, r2, xl, x, xr, gxPtr[x], gyPtr[x]);
+				magnitudeOrientation<Policy>(gxPtr[x], gyPtr[x], magPtr[x], oriPtr[x]);
+			};
+
+			pixel(0, 0, MIN(1, cols - 1));
+
+			// interior columns without clamping, the taps vectorize
+			for (int x = 1; x < cols - 1; ++x)
+				gradientTaps<Policy::kernel>(r0, r1, r2, x - 1, x, x + 1, gxPtr[x], gyPtr[x]);
+			for (int x = 1; x < cols - 1; ++x)
+				magnitudeOrientation<Policy>(gxPtr[x], gyPtr[x], magPtr[x], oriPtr[x]);
+
+			if (cols > 1)
+				pixel(cols - 2, cols - 1, cols - 1);
+		}
+	});
+
+	return true;
+}
+
+
+template bool calcGradInfoFused<Mask2x2L1Policy>(const cv::Mat&, GradientInfo*);
+template bool calcGradInfoFused<Mask2x2L2Policy>(const cv::Mat&, GradientInfo*);
+template bool calcGradInfoFused<SobelL1Policy>(const cv::Mat&, GradientInfo*);
+template bool calcGradInfoFused<SobelL2Policy>(const cv::Mat&, GradientInfo*);
+
+
+/* @brief Select the specialized gradient stage once per frame and run it. */
+bool calcGradInfoFused(
+	const cv::Mat& src,
+	GradientInfo*  pGradInfo,
+	int            kernelType,
+	bool           useL1
+)
+{
+	if (src.empty() || pGradInfo == nullptr)
+		return false;
+
+	if (src.type() != CV_8UC1)
+	{
+		if (!calcGradInfo(src, pGradInfo, kernelType))
+			return false;
+
+		return useL1 || calcMagnitude(pGradInfo->gradx, pGradInfo->grady, pGradInfo->mag, false);
+	}
+
+	if (kernelType == SOBEL)
+		return useL1 ? calcGradInfoFused<SobelL1Policy>(src, pGradInfo) :
+			calcGradInfoFused<SobelL2Policy>(src, pGradInfo);
+
+	return useL1 ? calcGradInfoFused<Mask2x2L1Policy>(src, pGradInfo) :
+		calcGradInfoFused<Mask2x2L2Policy>(src, pGradInfo);
+}
@@ -0,0 +1,49 @@
+#ifndef __GRAD_POLICY_HPP__
+#define __GRAD_POLICY_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+
+
+/* @brief Compile-time configuration of the gradient stage.
+Each policy gets its own fused kernel with the filter taps, the magnitude norm and
+the magnitude floor folded in as constants. */
+template <int Kernel, bool UseL1>
+struct GradientPolicy
+{
+	static constexpr int    kernel = Kernel;
+	static constexpr bool   useL1 = UseL1;
+	static constexpr double minGrad = MIN_GRAD_THRESH;	// smaller magnitudes are set to 0
+};
+
+typedef GradientPolicy<MASK2x2, true>  Mask2x2L1Policy;
+typedef GradientPolicy<MASK2x2, false> Mask2x2L2Policy;
+typedef GradientPolicy<SOBEL, true>    SobelL1Policy;
+typedef GradientPolicy<SOBEL, false>   SobelL2Policy;
+
+
+/* @brief Gradient, magnitude and orientation of an 8-bit gray image in one pass,
+specialized by the policy. The maps equal those of calcGradInfo with the policy's kernel
+and calcMagnitude with the policy's norm: BORDER_REPLICATE, magnitudes below minGrad set to 0,
+orientation in [0, 180] degree. Instantiated for the 4 policies above.
+* @return false if the input is not 8-bit gray. */
+template <typename Policy>
+bool calcGradInfoFused(
+	const cv::Mat& src,
+	GradientInfo*  pGradInfo
+);
+
+
+/* @brief Select the specialized gradient stage once per frame and run it.
+Inputs other than 8-bit gray fall back to the generic calcGradInfo, which only has L1. */
+extern
+bool calcGradInfoFused(
+	const cv::Mat& src,
+	GradientInfo*  pGradInfo,
+	int            kernelType = MASK2x2,
+	bool           useL1 = true
+);
+
+
+#endif // !__GRAD_POLICY_HPP__
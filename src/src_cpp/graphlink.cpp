@@ -0,0 +1,247 @@
+#include "graphlink.hpp"
+#include <atomic>
+#include <numeric>
+
+
+namespace AED
+{
+	/* @brief Root of a node, halving the path on the way. */
+	static int findRoot(
+		std::vector<std::atomic<int>>& parent,
+		int                            ind
+	)
+	{
+		while (true)
+		{
+			int p = parent[ind].load();
+			if (p == ind)
+				return ind;
+
+			int gp = parent[p].load();
+			if (p != gp)
+				parent[ind].compare_exchange_weak(p, gp);
+			ind = gp;
+		}
+	}
+
+
+	/* @brief Join the sets of two nodes, safe to call concurrently.
+	A root is only attached under a smaller root, so each component ends up rooted
+	at its smallest node whatever the order of unions. */
+	static void unite(
+		std::vector<std::atomic<int>>& parent,
+		int                            lhs,
+		int                            rhs
+	)
+	{
+		while (true)
+		{
+			lhs = findRoot(parent, lhs);
+			rhs = findRoot(parent, rhs);
+			if (lhs == rhs)
+				return;
+
+			if (lhs < rhs)
+				std::swap(lhs, rhs);
+
+			int expected = lhs;
+			if (parent[lhs].compare_exchange_strong(expected, rhs))
+				return;
+		}
+	}
+
+
+	/* @brief Fit a segment to the anchor pixels of the groups, dropping groups off the line once. */
+	static LineSegment fitComponent(
+		const AnchorGroups& groups,
+		std::vector<int>&   members
+	)
+	{
+		std::vector<cv::Point> pts;
+		cv::Vec4f line;
+
+		for (int pass = 0; pass != 2; ++pass)
+		{
+			pts.clear();
+			for (int groupInd : members)
+			{
+				for (int i = 0; i != 3; ++i)
+					pts.emplace_back(groups.point(groupInd, i));
+			}
+			cv::fitLine(pts, line, cv::DIST_L2, 0, 0.01, 0.01);
+
+			// centers off the fitted line, e.g. a branch joined at a corner
+			size_t numKept = 0;
+			for (int groupInd : members)
+			{
+				Pixel center = groups.center(groupInd);
+				float dist = std::abs((center.x - line[2]) * line[1] - (center.y - line[3]) * line[0]);
+				if (dist <= DIST_TOLERANCE)
+					members[numKept++] = groupInd;
+			}
+
+			if (numKept == members.size() || numKept < 2)
+				break;
+			members.resize(numKept);
+		}
+
+		// extent of the anchor pixels along the line
+		float tMin = FLT_MAX, tMax = -FLT_MAX;
+		for (const auto& pt : pts)
+		{
+			float t = (pt.x - line[2]) * line[0] + (pt.y - line[3]) * line[1];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+
+		return LineSegment(
+			Pixel(line[2] + tMin * line[0], line[3] + tMin * line[1]),
+			Pixel(line[2] + tMax * line[0], line[3] + tMax * line[1]));
+	}
+
+
+	/* @brief Link aligned-anchor groups by connected components of a compatibility graph. */
+	void linkGraph(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	)
+	{
+		const AnchorGroups& groups = ws.groups;
+		const int numGroups = int(groups.size());
+		if (numGroups == 0)
+			return;
+
+		const cv::Mat& ori = pGradInfo->ori;
+		const float maxDist = float(params.remainSteps + 3);
+
+		// unit anchor-line and angle of each group
+		std::vector<float> dirX(numGroups), dirY(numGroups), angles(numGroups);
+		for (int groupInd = 0; groupInd != numGroups; ++groupInd)
+		{
+			cv::Vec4f line = groups.line(groupInd);
+			float norm = std::sqrt(line[0] * line[0] + line[1] * line[1]);
+			dirX[groupInd] = norm > 0.0f ? line[0] / norm : 0.0f;
+			dirY[groupInd] = norm > 0.0f ? line[1] / norm : 0.0f;
+			angles[groupInd] = lineAngle(line, true);
+		}
+
+		// uniform grid of group centers, one cell is the max edge length
+		const int gridCols = ws.labels.cols / int(maxDist) + 1;
+		const int gridRows = ws.labels.rows / int(maxDist) + 1;
+		std::vector<int> cellOf(numGroups), cellStart(gridCols * gridRows + 1, 0), cellItems(numGroups);
+		for (int groupInd = 0; groupInd != numGroups; ++groupInd)
+		{
+			Pixel center = groups.center(groupInd);
+			cellOf[groupInd] = int(center.y / maxDist) * gridCols + int(center.x / maxDist);
+			++cellStart[cellOf[groupInd] + 1];
+		}
+		std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+		{
+			std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+			for (int groupInd = 0; groupInd != numGroups; ++groupInd)
+				cellItems[cursor[cellOf[groupInd]]++] = groupInd;
+		}
+
+		std::vector<std::atomic<int>> parent(numGroups);
+		for (int groupInd = 0; groupInd != numGroups; ++groupInd)
+			parent[groupInd].store(groupInd);
+
+		// edges to greater neighbors only, each pair is tested once
+		cv::parallel_for_(cv::Range(0, numGroups), [&](const cv::Range& range) {
+			for (int groupInd = range.start; groupInd != range.end; ++groupInd)
+			{
+				if (dirX[groupInd] == 0.0f && dirY[groupInd] == 0.0f)
+					continue;
+
+				Pixel center = groups.center(groupInd);
+				int cellX = cellOf[groupInd] % gridCols, cellY = cellOf[groupInd] / gridCols;
+
+				for (int y = std::max(cellY - 1, 0); y <= std::min(cellY + 1, gridRows - 1); ++y)
+				{
+					for (int x = std::max(cellX - 1, 0); x <= std::min(cellX + 1, gridCols - 1); ++x)
+					{
+						int cell = y * gridCols + x;
+						for (int k = cellStart[cell]; k != cellStart[cell + 1]; ++k)
+						{
+							int other = cellItems[k];
+							if (other <= groupInd || (dirX[other] == 0.0f && dirY[other] == 0.0f) ||
+								angleDiff(angles[groupInd], angles[other]) > ANG_TOLERANCE)
+								continue;
+
+							Pixel otherCenter = groups.center(other);
+							float dx = otherCenter.x - center.x, dy = otherCenter.y - center.y;
+							if (dx * dx + dy * dy > maxDist * maxDist)
+								continue;
+
+							// each center near the other's anchor-line
+							if (std::abs(dx * dirY[groupInd] - dy * dirX[groupInd]) > DIST_TOLERANCE ||
+								std::abs(dx * dirY[other] - dy * dirX[other]) > DIST_TOLERANCE)
+								continue;
+
+							unite(parent, groupInd, other);
+						}
+					}
+				}
+			}
+		});
+
+		// components as lists of members, ordered by their smallest group
+		std::vector<int> roots(numGroups), compOf(numGroups, -1);
+		int numComps = 0;
+		for (int groupInd = 0; groupInd != numGroups; ++groupInd)
+		{
+			roots[groupInd] = findRoot(parent, groupInd);
+			if (roots[groupInd] == groupInd)
+				compOf[groupInd] = numComps++;
+		}
+
+		std::vector<std::vector<int>> members(numComps);
+		for (int groupInd = 0; groupInd != numGroups; ++groupInd)
+			members[compOf[roots[groupInd]]].push_back(groupInd);
+
+		// 0: dropped, 1: line segment, 2: candidate
+		std::vector<LineSegment> segs(numComps);
+		std::vector<uchar> status(numComps, 0);
+
+		cv::parallel_for_(cv::Range(0, numComps), [&](const cv::Range& range) {
+			for (int comp = range.start; comp != range.end; ++comp)
+			{
+				// a single group is never linked
+				if (members[comp].size() < 2)
+					continue;
+
+				LineSegment seg = fitComponent(groups, members[comp]);
+				int alignedCnt = int(members[comp].size()) - 1;
+
+				// filter non-aligned or short segment, before density validation
+				if (alignedCnt < 1 ||
+					seg.length() < params.minLength ||
+					!anchorDensityValidate(ws.labels, seg, params.anchorDensity))
+					continue;
+
+				segs[comp] = seg;
+				status[comp] = alignedCnt < 3 ||
+					!alignedDensityValidate(ori, seg, params.alignedDensity) ? 2 : 1;
+			}
+		});
+
+		for (int comp = 0; comp != numComps; ++comp)
+		{
+			if (status[comp] == 1)
+			{
+				lineSegments.emplace_back(segs[comp]);
+				for (int groupInd : members[comp])
+					ws.groups.isLink[groupInd] = true;
+			}
+			else if (status[comp] == 2)
+			{
+				candidateSegments.emplace_back(segs[comp]);
+			}
+		}
+
+		return;
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef __GRAPH_LINK_HPP__
+#define __GRAPH_LINK_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+#include "segments.hpp"
+#include "alignED.hpp"
+
+
+namespace AED
+{
+	/* @brief Link aligned-anchor groups by connected components of a compatibility graph.
+	Two groups are connected if their centers are within remainSteps + 3 pixels, their
+	anchor-lines differ by at most ANG_TOLERANCE and each center is within DIST_TOLERANCE of
+	the other's line. Edges are found through a uniform grid of group centers and merged by a
+	lock-free union-find in parallel, then each component is fitted once, in parallel.
+	The result does not depend on seed order. ED anchors are not used, only aligned groups.
+	Validation and candidates follow linkAlignedAnchorGroup. */
+	extern
+	void linkGraph(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params = LinkParams()
+	);
+}
+
+
+#endif // !__GRAPH_LINK_HPP__
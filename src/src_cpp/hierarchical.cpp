@@ -0,0 +1,118 @@
+#include "hierarchical.hpp"
+#include "alignED.hpp"
+
+
+namespace AED
+{
+	/* @brief Counting sort of magnitudes into flat buckets, the same binning as pseudoSort. */
+	void bucketSort(
+		const cv::Mat& mag,
+		PixelBuckets&  buckets,
+		int            bins,
+		double         magRange
+	)
+	{
+		buckets.bins = bins;
+		buckets.magRange = magRange;
+		buckets.pixels.clear();
+		buckets.offsets.assign(bins + 1, 0);
+
+		if (mag.empty() || mag.channels() > 1 || bins <= 0)
+			return;
+
+		double binStep = magRange / bins;
+
+		// bucket of each pixel is computed once, then counted
+		const ImageView<const float> magView(mag);
+		std::vector<int> binInds(mag.total());
+		int* binPtr = binInds.data();
+		for (int row = 0; row != magView.height; ++row)
+		{
+			const float* magPtr = magView.row(row);
+			for (int col = 0; col != magView.width; ++col, ++binPtr)
+			{
+				int binInd = magPtr[col] / binStep;
+				binInd = binInd >= bins ? bins - 1 : binInd;	// avoid out of range
+
+				*binPtr = binInd;
+				++buckets.offsets[binInd + 1];
+			}
+		}
+
+		for (int bin = 0; bin != bins; ++bin)
+			buckets.offsets[bin + 1] += buckets.offsets[bin];
+
+		// stable scatter, raster order inside a bucket
+		std::vector<int> cursor(buckets.offsets.begin(), buckets.offsets.end() - 1);
+		buckets.pixels.resize(mag.total());
+		binPtr = binInds.data();
+		for (int row = 0; row != magView.height; ++row)
+		{
+			const float* magPtr = magView.row(row);
+			for (int col = 0; col != magView.width; ++col, ++binPtr)
+			{
+				Pixel& px = buckets.pixels[cursor[*binPtr]++];
+				px.x = col, px.y = row, px.val = magPtr[col];
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief Extract aligned anchors from flat buckets, appending to the output. */
+	void extractAlignedAnchors(
+		const GradientInfo* pGradInfo,
+		const PixelBuckets& buckets,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               anchorThresh,
+		float               angleTolerance
+	)
+	{
+		const GradientView view(pGradInfo);
+		const int cols = view.gradx.width;
+
+		for (int bin = buckets.bins - 1; bin >= 0; --bin)
+		{
+			const Pixel* it = buckets.begin(bin);
+			const Pixel* end = buckets.end(bin);
+			if (it == end || it->val < MIN_GRAD_THRESH)
+				continue;
+
+			for (; it != end; ++it)
+			{
+				if (used[int(it->x) + int(it->y) * cols])
+					continue;
+
+				if (it->val < MIN_GRAD_THRESH)
+					break;
+
+				appendAlignedAnchor(view, *it, used, alignedAnchors, anchorThresh, angleTolerance);
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief Detect aligned anchors. */
+	void HierarchicalAnchorDetector::detect(
+		int    bins,
+		double magRange,
+		float  anchorThresh,
+		float  angleTolerance
+	)
+	{
+		anchors.clear();
+		if (pGradInfo == nullptr || pGradInfo->mag.empty())
+			return;
+
+		bucketSort(pGradInfo->mag, pxBuckets, bins, magRange);
+
+		used.assign(pGradInfo->mag.total(), false);
+		extractAlignedAnchors(pGradInfo, pxBuckets, used, anchors, anchorThresh, angleTolerance);
+
+		return;
+	}
+}
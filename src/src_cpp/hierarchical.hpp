@@ -0,0 +1,89 @@
+#ifndef __HIERARCHICAL_HPP__
+#define __HIERARCHICAL_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+#include "segments.hpp"
+
+
+namespace AED
+{
+	/* @brief Pixels bucketed by magnitude in one flat array.
+	Bucket b is pixels[offsets[b], offsets[b + 1]), in raster order as pseudoSort's lists. */
+	struct PixelBuckets
+	{
+		std::vector<Pixel> pixels;
+		std::vector<int>   offsets;	// bins + 1 entries
+		int                bins = 0;
+		double             magRange = 0.0;
+
+		const Pixel* begin(int bin) const { return pixels.data() + offsets[bin]; }
+
+		const Pixel* end(int bin) const { return pixels.data() + offsets[bin + 1]; }
+	};
+
+
+	/* @brief Counting sort of magnitudes into flat buckets, the same binning as pseudoSort.
+	* @param magRange: magnitudes at or above it fall into the last bucket. */
+	extern
+	void bucketSort(
+		const cv::Mat& mag,
+		PixelBuckets&  buckets,
+		int            bins = 1024,
+		double         magRange = 512.0
+	);
+
+
+	/* @brief Extract aligned anchors from flat buckets, appending to the output.
+	Visits the same pixels in the same order as extractAlignedAnchors on pseudoSort's lists. */
+	extern
+	void extractAlignedAnchors(
+		const GradientInfo* pGradInfo,
+		const PixelBuckets& buckets,
+		std::vector<bool>&  used,
+		PixelList&          alignedAnchors,
+		float               anchorThresh = 3.0f,
+		float               angleTolerance = 22.5f
+	);
+
+
+	/* @brief Hierarchical anchor detector, the native counterpart of the Python
+	HierachicalAnchorDetector. Buckets are visited from the strongest magnitude down,
+	pixels taken by stronger anchors are never shared by weaker ones.
+	Buffers are kept across calls of detect. */
+	class HierarchicalAnchorDetector
+	{
+	public:
+		explicit HierarchicalAnchorDetector(const GradientInfo* _pGradInfo = nullptr) :
+			pGradInfo(_pGradInfo) { }
+
+		/* @brief Set gradient information of the next image. */
+		void setGradInfo(const GradientInfo* _pGradInfo) { pGradInfo = _pGradInfo; }
+
+		/* @brief Detect aligned anchors.
+		* @param magRange: 255 matches pseudoSort's default binning. */
+		void detect(
+			int    bins = 1024,
+			double magRange = 512.0,
+			float  anchorThresh = 3.0f,
+			float  angleTolerance = 22.5f
+		);
+
+		/* @brief Triplets of (neighbor, anchor, neighbor), 3 pixels per anchor. */
+		const PixelList& alignedAnchors() const { return anchors; }
+
+		size_t numAnchors() const { return anchors.size() / 3; }
+
+		const PixelBuckets& buckets() const { return pxBuckets; }
+
+	private:
+		const GradientInfo* pGradInfo;
+		PixelBuckets        pxBuckets;
+		std::vector<bool>   used;
+		PixelList           anchors;
+	};
+}
+
+
+#endif // !__HIERARCHICAL_HPP__
@@ -0,0 +1,114 @@
+#ifndef __IMAGE_VIEW_HPP__
+#define __IMAGE_VIEW_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <type_traits>
+
+
+// Pixel format of a raw 8-bit image buffer.
+enum PixelFormat
+{
+	PIX_GRAY8 = 0,
+	PIX_BGR8,
+	PIX_RGB8,
+	PIX_BGRA8,
+	PIX_RGBA8
+};
+
+
+/* @brief Non-owning view of a caller's 8-bit image buffer, e.g. a frame in shared memory.
+The pipeline only reads through the view, the buffer is never modified. */
+struct RawImageView
+{
+	const uint8_t* data = nullptr;
+	int            width = 0;
+	int            height = 0;
+	size_t         stride = 0;	// bytes per row, may be greater than width * channels
+	PixelFormat    format = PIX_GRAY8;
+
+	RawImageView() = default;
+	RawImageView(const uint8_t* _data, int _width, int _height, size_t _stride, PixelFormat _format = PIX_GRAY8) :
+		data(_data), width(_width), height(_height), stride(_stride), format(_format) { }
+
+	/* @brief Number of channels of the pixel format. */
+	int channels() const
+	{
+		switch (format)
+		{
+		case PIX_GRAY8:
+			return 1;
+		case PIX_BGR8:
+		case PIX_RGB8:
+			return 3;
+		default:
+			return 4;
+		}
+	}
+
+	/* @brief Check the view if is valid. */
+	bool isValid() const
+	{
+		return data != nullptr && width > 0 && height > 0 &&
+			stride >= size_t(width) * channels();
+	}
+};
+
+
+/* @brief View of an 8-bit cv::Mat, gray or BGR(A). */
+inline
+RawImageView makeImageView(const cv::Mat& src)
+{
+	PixelFormat format = src.channels() == 1 ? PIX_GRAY8 :
+		src.channels() == 3 ? PIX_BGR8 : PIX_BGRA8;
+
+	return RawImageView(src.ptr<uint8_t>(), src.cols, src.rows, src.step[0], format);
+}
+
+
+/* @brief Wrap the view as a cv::Mat header without copying.
+The header is only handed to OpenCV as an input array, never written. */
+inline
+const cv::Mat wrapImageView(const RawImageView& view)
+{
+	return cv::Mat(view.height, view.width, CV_MAKETYPE(CV_8U, view.channels()),
+		const_cast<uint8_t*>(view.data), view.stride);
+}
+
+
+/* @brief Non-owning typed view of a single-channel image for inner loops.
+Trivially copyable with int-indexed accessors and no checks, so row pointers can be
+hoisted and loops vectorized. OpenCV still owns the memory, the Mat must outlive the view. */
+template <typename T>
+struct ImageView
+{
+	T*     data = nullptr;
+	int    width = 0;
+	int    height = 0;
+	size_t stride = 0;	// elements per row
+
+	ImageView() = default;
+	ImageView(T* _data, int _width, int _height, size_t _stride) :
+		data(_data), width(_width), height(_height), stride(_stride) { }
+
+	/* @brief View of a Mat whose element type is T. */
+	explicit ImageView(const cv::Mat& src) :
+		data((T*)src.data), width(src.cols), height(src.rows), stride(src.step[0] / sizeof(T)) { }
+
+	bool empty() const { return data == nullptr; }
+
+	/* @brief Check index if is valid. */
+	bool contains(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+
+	T* row(int y) const { return data + size_t(y) * stride; }
+
+	T& operator()(int x, int y) const { return data[size_t(y) * stride + x]; }
+
+	T& operator()(const cv::Point& pt) const { return data[size_t(pt.y) * stride + pt.x]; }
+};
+
+static_assert(std::is_trivially_copyable<ImageView<const float>>::value, "ImageView is passed by value");
+
+
+#endif // !__IMAGE_VIEW_HPP__
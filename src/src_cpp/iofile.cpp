@@ -1,4 +1,19 @@
 #include "iofile.hpp"
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+// Windows
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+// Linux
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 
 void listDirRecursively(
@@ -78,18 +93,32 @@ void readFileNames(
 	std::vector<std::string>& filenames
 )
 {
-	std::fstream fs(filepath, std::ios::in);
-	if (!fs.is_open())
+	filenames.clear();
+
+	MappedFile file;
+	if (!file.open(filepath))
 	{
+		std::error_code ec;
+		if (fs::is_regular_file(filepath, ec))
+			return;		// empty list
+
 		std::cerr << "No file was found." << std::endl;
 		return;
 	}
 
-	filenames.clear();
-	std::string filename;
-	while (std::getline(fs, filename))
+	const char* ptr = file.data();
+	const char* end = ptr + file.size();
+	while (ptr != end)
 	{
-		filenames.emplace_back(filename);
+		const char* eol = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+		if (eol == nullptr)
+			eol = end;
+
+		// CRLF list written on Windows
+		const char* last = (eol != ptr && eol[-1] == '\r') ? eol - 1 : eol;
+		filenames.emplace_back(ptr, last);
+
+		ptr = eol == end ? end : eol + 1;
 	}
 
 	return;
@@ -103,10 +132,11 @@ void write2txt(
 	const std::string& suffix
 )
 {
-	if (_access(dir.c_str(), 0) == -1)
+	if (!fs::exists(dir))
 	{
-		int flag = _mkdir(dir.c_str());
-		if (flag == -1)
+		std::error_code ec;
+		fs::create_directories(dir, ec);
+		if (ec)
 		{
 			std::cerr << "Creating directory failed." << std::endl;
 			return;
@@ -124,4 +154,743 @@ void write2txt(
 			<< seg.endPx.x << "," << seg.endPx.y << '\n';
 	}
 	fs.close();
-}
\ No newline at end of file
+}
+
+
+/*---------------------- Memory-mapped file ----------------------*/
+
+/* @brief Map the whole file, return false if failed or file is empty. */
+bool MappedFile::open(const std::string& filepath)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (addr == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	hFile = file;
+	hMapping = mapping;
+	ptr = static_cast<const char*>(addr);
+	length = size_t(fileSize.QuadPart);
+#else
+	int fd = ::open(filepath.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);	// mapping keeps the file referenced
+
+	if (addr == MAP_FAILED)
+		return false;
+
+	ptr = static_cast<const char*>(addr);
+	length = size_t(st.st_size);
+#endif
+
+	return true;
+}
+
+
+/* @brief Unmap the file. */
+void MappedFile::close()
+{
+	if (ptr == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(ptr);
+	CloseHandle(hMapping);
+	CloseHandle(hFile);
+	hMapping = hFile = nullptr;
+#else
+	munmap(const_cast<char*>(ptr), length);
+#endif
+
+	ptr = nullptr;
+	length = 0;
+}
+
+
+/*---------------------- Segment text files ----------------------*/
+
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+
+/* @brief Parse a decimal float like strtof, ptr is moved past the number.
+Mantissas up to 2^53 with exponents up to 22 are converted in one correctly rounded double
+operation, other inputs and doubles next to a float rounding midpoint go to strtof,
+so the result equals strtof's. */
+static bool parseFloat(
+	const char*& ptr,
+	const char*  end,
+	float&       val
+)
+{
+	// exact powers of 10 in double
+	static const double POW10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char* p = ptr;
+
+	bool isNeg = false;
+	if (p != end && (*p == '+' || *p == '-'))
+		isNeg = *p++ == '-';
+
+	uint64_t mantissa = 0;
+	int digits = 0, exp10 = 0;
+	bool hasDigit = false;
+	bool isTruncated = false;	// a non-zero digit is dropped
+
+	for (; p != end && isDigit(*p); ++p)
+	{
+		hasDigit = true;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else
+		{
+			isTruncated |= *p != '0';
+			++exp10;
+		}
+	}
+
+	if (p != end && *p == '.')
+	{
+		for (++p; p != end && isDigit(*p); ++p)
+		{
+			hasDigit = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				--exp10;
+			}
+			else
+			{
+				isTruncated |= *p != '0';
+			}
+		}
+	}
+
+	if (!hasDigit)
+		return false;
+
+	// exponent, ignored if no digit follows 'e', as strtof does
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+		bool isExpNeg = false;
+		if (q != end && (*q == '+' || *q == '-'))
+			isExpNeg = *q++ == '-';
+
+		if (q != end && isDigit(*q))
+		{
+			int e = 0;
+			for (; q != end && isDigit(*q); ++q)
+				e = MIN(e * 10 + (*q - '0'), 1000);
+
+			exp10 += isExpNeg ? -e : e;
+			p = q;
+		}
+	}
+
+	// mantissa and power are exact in double, one operation rounds correctly
+	bool isFast = !isTruncated && mantissa <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22;
+
+	double d = 0.0;
+	if (isFast && mantissa != 0)
+	{
+		d = exp10 >= 0 ? double(mantissa) * POW10[exp10] : double(mantissa) / POW10[-exp10];
+
+		// the exact value is within half a double ulp of d, rounding d to float gives the same float
+		// unless a float midpoint is within one double ulp of d, 29 = 52 - 23 dropped bits
+		uint64_t bits;
+		std::memcpy(&bits, &d, sizeof(bits));
+		uint64_t low = bits & ((uint64_t(1) << 29) - 1);
+		const uint64_t half = uint64_t(1) << 28;
+
+		isFast = (low + 1 < half || low > half + 1) && d >= FLT_MIN && d <= FLT_MAX;
+	}
+
+	if (isFast)
+	{
+		val = float(isNeg ? -d : d);
+	}
+	else
+	{
+		// slow path on a terminated copy of the number
+		std::string text(ptr, p);
+		val = std::strtof(text.c_str(), nullptr);
+	}
+	ptr = p;
+
+	return true;
+}
+
+
+/* @brief Parse segment text of 'x0 y0 x1 y1' lines. */
+bool parseSegmentText(
+	const char*  data,
+	size_t       size,
+	LineSegList& segments,
+	const char   splitText
+)
+{
+	const char* ptr = data;
+	const char* end = data + size;
+
+	while (ptr != end)
+	{
+		const char* eol = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+		if (eol == nullptr)
+			eol = end;
+
+		// skip empty line and line starting with whitespace
+		if (ptr != eol && !std::isspace(uchar(*ptr)))
+		{
+			int cnt = 0;
+			float val[4];
+
+			for (const char* p = ptr; p != eol; )
+			{
+				if (*p == splitText || *p == ' ' || *p == '\t' || *p == ',' || *p == '\r')
+				{
+					++p;
+					continue;
+				}
+
+				float v;
+				if (!parseFloat(p, eol, v))
+					return false;
+
+				if (cnt < 4)
+					val[cnt] = v;
+				++cnt;
+			}
+
+			if (cnt >= 4)
+				segments.emplace_back(val[0], val[1], val[2], val[3]);
+		}
+
+		ptr = eol == end ? end : eol + 1;
+	}
+
+	return true;
+}
+
+
+/* @brief Map a segment text file and parse it, segments are appended. */
+bool readSegmentText(
+	const std::string& filepath,
+	LineSegList&       segments,
+	const char         splitText
+)
+{
+	MappedFile file;
+	if (!file.open(filepath))
+	{
+		std::error_code ec;
+		return fs::is_regular_file(filepath, ec);	// empty file has no segment
+	}
+
+	return parseSegmentText(file.data(), file.size(), segments, splitText);
+}
+
+
+/* @brief Read all segment text files with the suffix in a directory in parallel. */
+bool loadSegmentDir(
+	const std::string&        dir,
+	const std::string&        suffix,
+	std::vector<std::string>& filenames,
+	std::vector<LineSegList>& segmentLists,
+	const char                splitText
+)
+{
+	filenames.clear();
+	listDir(filenames, dir, suffix);
+	std::sort(filenames.begin(), filenames.end());
+
+	segmentLists.assign(filenames.size(), LineSegList());
+	std::vector<uchar> isRead(filenames.size(), 0);
+
+	cv::parallel_for_(cv::Range(0, int(filenames.size())), [&](const cv::Range& range) {
+		for (int i = range.start; i != range.end; ++i)
+			isRead[i] = readSegmentText(filenames[i], segmentLists[i], splitText);
+	});
+
+	bool isOK = true;
+	for (size_t i = 0; i != filenames.size(); ++i)
+	{
+		if (!isRead[i])
+		{
+			std::cerr << "Parsing " << filenames[i] << " failed." << std::endl;
+			isOK = false;
+		}
+	}
+
+	return isOK;
+}
+
+
+/*---------------------- Binary segment file ----------------------*/
+
+constexpr uint32_t fourcc(char c0, char c1, char c2, char c3)
+{
+	return uint32_t(uint8_t(c0)) | uint32_t(uint8_t(c1)) << 8 |
+		uint32_t(uint8_t(c2)) << 16 | uint32_t(uint8_t(c3)) << 24;
+}
+
+constexpr uint32_t SEGFILE_TAG_HEADER = fourcc('A', 'A', 'G', 'S');
+constexpr uint32_t SEGFILE_TAG_RECORD = fourcc('S', 'R', 'E', 'C');
+constexpr uint32_t SEGFILE_TAG_INDEX = fourcc('S', 'I', 'D', 'X');
+constexpr uint32_t SEGFILE_TAG_FOOTER = fourcc('S', 'E', 'N', 'D');
+
+struct SegFileHeader
+{
+	uint32_t tag = SEGFILE_TAG_HEADER;
+	uint32_t version = SEGFILE_VERSION;
+	uint32_t flags = 0;
+	uint32_t reserved = 0;
+};
+
+struct SegRecordHeader
+{
+	uint32_t tag = SEGFILE_TAG_RECORD;
+	uint32_t nameLen = 0;
+	uint32_t count = 0;
+	uint32_t reserved = 0;
+};
+
+struct SegFileFooter
+{
+	uint64_t indexOffset = 0;
+	uint32_t numImages = 0;
+	uint32_t tag = SEGFILE_TAG_FOOTER;
+};
+
+
+/* @brief Round up to multiple of 4 bytes, keeps float data aligned. */
+static inline size_t pad4(size_t len)
+{
+	return (len + 3) & ~size_t(3);
+}
+
+
+/* @brief Read a value at offset, the caller checks the range. */
+template <typename T>
+static inline T readAt(const char* data, size_t offset)
+{
+	T val;
+	std::memcpy(&val, data + offset, sizeof(T));
+	return val;
+}
+
+
+/* @brief Scan records from the beginning.
+* @param endOffset: end of the last complete record. */
+static void scanSegmentRecords(
+	const char*                data,
+	size_t                     size,
+	int                        stride,
+	std::vector<SegFileEntry>& entries,
+	size_t&                    endOffset
+)
+{
+	entries.clear();
+
+	size_t offset = sizeof(SegFileHeader);
+	while (offset + sizeof(SegRecordHeader) <= size)
+	{
+		auto rec = readAt<SegRecordHeader>(data, offset);
+		if (rec.tag != SEGFILE_TAG_RECORD)
+			break;
+
+		size_t recSize = sizeof(SegRecordHeader) + pad4(rec.nameLen) +
+			size_t(rec.count) * stride * sizeof(float);
+		if (offset + recSize > size)
+			break;	// truncated record
+
+		SegFileEntry entry;
+		entry.name.assign(data + offset + sizeof(SegRecordHeader), rec.nameLen);
+		entry.offset = offset;
+		entry.count = rec.count;
+		entries.emplace_back(entry);
+
+		offset += recSize;
+	}
+
+	endOffset = offset;
+	return;
+}
+
+
+/* @brief Check an index entry against the record header at its offset,
+the whole record must lie before the index. */
+static bool isValidRecord(
+	const char*         data,
+	size_t              recordEnd,
+	int                 stride,
+	const SegFileEntry& entry
+)
+{
+	if (entry.offset < sizeof(SegFileHeader) || recordEnd < sizeof(SegRecordHeader) ||
+		entry.offset > recordEnd - sizeof(SegRecordHeader))
+		return false;
+
+	auto rec = readAt<SegRecordHeader>(data, entry.offset);
+	if (rec.tag != SEGFILE_TAG_RECORD || rec.count != entry.count || rec.nameLen != entry.name.size())
+		return false;
+
+	size_t recSize = sizeof(SegRecordHeader) + pad4(rec.nameLen) +
+		size_t(rec.count) * stride * sizeof(float);
+	if (recSize > recordEnd - entry.offset)
+		return false;
+
+	return std::memcmp(data + entry.offset + sizeof(SegRecordHeader), entry.name.data(), rec.nameLen) == 0;
+}
+
+
+/* @brief Parse header, then load index or scan records if index is missing or corrupt.
+* @param endOffset: end of the last complete record, where new records go. */
+static bool parseSegmentFile(
+	const char*                data,
+	size_t                     size,
+	int&                       stride,
+	std::vector<SegFileEntry>& entries,
+	size_t&                    endOffset
+)
+{
+	if (size < sizeof(SegFileHeader))
+		return false;
+
+	auto header = readAt<SegFileHeader>(data, 0);
+	if (header.tag != SEGFILE_TAG_HEADER || header.version != SEGFILE_VERSION)
+		return false;
+
+	stride = header.flags & SEGFILE_HAS_SCORE ? 5 : 4;
+
+	// try index
+	if (size >= sizeof(SegFileHeader) + sizeof(SegFileFooter))
+	{
+		auto footer = readAt<SegFileFooter>(data, size - sizeof(SegFileFooter));
+		size_t offset = footer.indexOffset;
+
+		if (footer.tag == SEGFILE_TAG_FOOTER && offset >= sizeof(SegFileHeader) &&
+			offset + 8 <= size - sizeof(SegFileFooter) &&
+			readAt<uint32_t>(data, offset) == SEGFILE_TAG_INDEX &&
+			readAt<uint32_t>(data, offset + 4) == footer.numImages)
+		{
+			entries.clear();
+			entries.reserve(footer.numImages);
+			offset += 8;
+
+			// index entries lie between the index head and the footer
+			size_t indexEnd = size - sizeof(SegFileFooter);
+
+			bool isValid = true;
+			for (uint32_t i = 0; i != footer.numImages && isValid; ++i)
+			{
+				if (offset + 16 > indexEnd)
+				{
+					isValid = false;
+					break;
+				}
+
+				SegFileEntry entry;
+				entry.offset = readAt<uint64_t>(data, offset);
+				entry.count = readAt<uint32_t>(data, offset + 8);
+				uint32_t nameLen = readAt<uint32_t>(data, offset + 12);
+
+				isValid = nameLen <= indexEnd - offset - 16;
+				if (isValid)
+				{
+					entry.name.assign(data + offset + 16, nameLen);
+					isValid = isValidRecord(data, footer.indexOffset, stride, entry);
+				}
+
+				if (isValid)
+				{
+					entries.emplace_back(entry);
+					offset += 16 + pad4(nameLen);
+				}
+			}
+
+			if (isValid)
+			{
+				endOffset = footer.indexOffset;
+				return true;
+			}
+		}
+	}
+
+	// no index, e.g. writer was interrupted, or a corrupt one
+	scanSegmentRecords(data, size, stride, entries, endOffset);
+
+	return true;
+}
+
+
+/* @brief Open file for writing. */
+bool SegmentFileWriter::open(
+	const std::string& filepath,
+	bool               hasScore,
+	bool               append
+)
+{
+	close();
+
+	this->hasScore = hasScore;
+	entries.clear();
+
+	if (append && fs::exists(filepath))
+	{
+		size_t endOffset = 0;
+		{
+			MappedFile file;
+			int stride = 4;
+			if (!file.open(filepath) ||
+				!parseSegmentFile(file.data(), file.size(), stride, entries, endOffset))
+			{
+				std::cerr << "Not a segment file: " << filepath << std::endl;
+				return false;
+			}
+			this->hasScore = stride > 4;
+		}
+
+		// drop old index and footer, new records follow the last complete one
+		std::error_code ec;
+		fs::resize_file(filepath, endOffset, ec);
+		if (ec)
+		{
+			std::cerr << ec.message() << std::endl;
+			return false;
+		}
+
+		ofs.open(filepath, std::ios::binary | std::ios::in | std::ios::out);
+		ofs.seekp(0, std::ios::end);
+	}
+	else
+	{
+		ofs.open(filepath, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (ofs.is_open())
+		{
+			SegFileHeader header;
+			header.flags = this->hasScore ? SEGFILE_HAS_SCORE : 0;
+			ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		}
+	}
+
+	if (!ofs.is_open())
+	{
+		std::cerr << "Opening segment file failed: " << filepath << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+/* @brief Append segments of an image. */
+bool SegmentFileWriter::append(
+	const std::string&        name,
+	const LineSegList&        segments,
+	const std::vector<float>& scores
+)
+{
+	if (!ofs.is_open())
+		return false;
+
+	int stride = hasScore ? 5 : 4;
+
+	SegRecordHeader rec;
+	rec.nameLen = name.size();
+	rec.count = segments.size();
+
+	// whole record in one write
+	size_t nameSize = pad4(name.size());
+	std::vector<char> buffer(sizeof(rec) + nameSize + segments.size() * stride * sizeof(float), 0);
+
+	std::memcpy(buffer.data(), &rec, sizeof(rec));
+	std::memcpy(buffer.data() + sizeof(rec), name.data(), name.size());
+
+	float* ptr = reinterpret_cast<float*>(buffer.data() + sizeof(rec) + nameSize);
+	for (size_t i = 0; i != segments.size(); ++i, ptr += stride)
+	{
+		const auto& seg = segments[i];
+		ptr[0] = seg.begPx.x, ptr[1] = seg.begPx.y;
+		ptr[2] = seg.endPx.x, ptr[3] = seg.endPx.y;
+
+		if (hasScore)
+			ptr[4] = i < scores.size() ? scores[i] : 0.0f;
+	}
+
+	SegFileEntry entry;
+	entry.name = name;
+	entry.offset = uint64_t(ofs.tellp());
+	entry.count = rec.count;
+
+	ofs.write(buffer.data(), buffer.size());
+	if (!ofs.good())
+		return false;
+
+	entries.emplace_back(entry);
+
+	return true;
+}
+
+
+/* @brief Write index and footer, then close. */
+void SegmentFileWriter::close()
+{
+	if (!ofs.is_open())
+		return;
+
+	SegFileFooter footer;
+	footer.indexOffset = uint64_t(ofs.tellp());
+	footer.numImages = entries.size();
+
+	uint32_t indexHead[2] = { SEGFILE_TAG_INDEX, footer.numImages };
+	ofs.write(reinterpret_cast<const char*>(indexHead), sizeof(indexHead));
+
+	const char padding[4] = { 0, 0, 0, 0 };
+	for (const auto& entry : entries)
+	{
+		uint32_t fields[2] = { entry.count, uint32_t(entry.name.size()) };
+		ofs.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
+		ofs.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+		ofs.write(entry.name.data(), entry.name.size());
+		ofs.write(padding, pad4(entry.name.size()) - entry.name.size());
+	}
+
+	ofs.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+	ofs.close();
+
+	entries.clear();
+}
+
+
+/* @brief Map file and load index, rebuild index by scanning if it's missing or corrupt. */
+bool SegmentFileReader::open(const std::string& filepath)
+{
+	close();
+
+	size_t endOffset = 0;
+	if (!file.open(filepath) ||
+		!parseSegmentFile(file.data(), file.size(), stride, entries, endOffset))
+	{
+		close();
+		return false;
+	}
+
+	for (size_t i = 0; i != entries.size(); ++i)
+		lookup[entries[i].name] = i;
+
+	return true;
+}
+
+
+void SegmentFileReader::close()
+{
+	file.close();
+	entries.clear();
+	lookup.clear();
+	stride = 4;
+}
+
+
+/* @brief Segments of i-th image, valid until the reader is closed. */
+SegmentView SegmentFileReader::view(size_t i) const
+{
+	const auto& entry = entries[i];
+
+	SegmentView segView;
+	segView.data = reinterpret_cast<const float*>(file.data() + entry.offset +
+		sizeof(SegRecordHeader) + pad4(entry.name.size()));
+	segView.count = entry.count;
+	segView.stride = stride;
+
+	return segView;
+}
+
+
+/* @brief Find segments by image name. */
+bool SegmentFileReader::find(
+	const std::string& name,
+	SegmentView&       segView
+) const
+{
+	auto it = lookup.find(name);
+	if (it == lookup.end())
+		return false;
+
+	segView = view(it->second);
+	return true;
+}
+
+
+/* @brief Export every image in segment file to CSV files by write2txt. */
+bool exportSegmentFileCSV(
+	const std::string& filepath,
+	const std::string& dir,
+	const std::string& suffix
+)
+{
+	SegmentFileReader reader;
+	if (!reader.open(filepath))
+	{
+		std::cerr << "Not a segment file: " << filepath << std::endl;
+		return false;
+	}
+
+	LineSegList segments;
+	for (size_t i = 0; i != reader.size(); ++i)
+	{
+		// keep sub-directories of image name, e.g. "i_castle/1.ppm"
+		const std::string& name = reader.name(i);
+		size_t ind = name.find_last_of('/');
+		std::string dstDir = ind == std::string::npos ? dir : dir + "/" + name.substr(0, ind);
+
+		reader.view(i).toList(segments);
+		write2txt(segments, dstDir, name, suffix);
+	}
+
+	return true;
+}
@@ -1,19 +1,10 @@
 #ifndef __IO_FILE_HPP__
 #define __IO_FILE_HPP__
 
-// Windows
-#include <direct.h>
-#include <io.h>
-
-// Linux
-//#include <sys/io.h>	
-//#include <unistd.h>
-//#include <sys/stat.h>
-//#include <sys/types.h>
-//#include <dirent.h>
-
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <unordered_map>
 #include "utilities.hpp"
 #include "lsd.hpp" 
 
@@ -48,5 +39,206 @@ void write2txt(
 );
 
 
+/*---------------------- Segment text files ----------------------*/
+
+/* @brief Parse segment text of 'x0 y0 x1 y1' lines, e.g. YorkUrban labels and CSV results.
+Values are split by tab, space, comma or splitText, and parsed in place without copying.
+Lines which are empty or start with whitespace are skipped, as are lines with less than 4 values.
+* @return false if an invalid character is met, segments parsed before it are kept. */
+bool parseSegmentText(
+	const char*  data,
+	size_t       size,
+	LineSegList& segments,
+	const char   splitText = '\t'
+);
+
+
+/* @brief Map a segment text file and parse it, segments are appended. */
+bool readSegmentText(
+	const std::string& filepath,
+	LineSegList&       segments,
+	const char         splitText = '\t'
+);
+
+
+/* @brief Read all segment text files with the suffix in a directory in parallel.
+* @param filenames: sorted file paths, segmentLists[i] are segments of filenames[i]. */
+bool loadSegmentDir(
+	const std::string&        dir,
+	const std::string&        suffix,
+	std::vector<std::string>& filenames,
+	std::vector<LineSegList>& segmentLists,
+	const char                splitText = '\t'
+);
+
+
+/*---------------------- Memory-mapped file ----------------------*/
+
+/* @brief Read-only memory-mapped file. */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { close(); }
+
+	/* @brief Map the whole file, return false if failed or file is empty. */
+	bool open(const std::string& filepath);
+
+	/* @brief Unmap the file. */
+	void close();
+
+	bool isOpen() const { return ptr != nullptr; }
+
+	const char* data() const { return ptr; }
+
+	size_t size() const { return length; }
+
+private:
+	const char* ptr = nullptr;
+	size_t      length = 0;
+
+#ifdef _WIN32
+	void* hFile = nullptr;
+	void* hMapping = nullptr;
+#endif
+};
+
+
+/*---------------------- Binary segment file ----------------------*/
+
+/* Binary container of detected segments, all values are little-endian.
+*   header : 'AAGS', version, flags(bit0: has score), reserved
+*   records: 'SREC', name length, count, reserved, name (padded to 4 bytes),
+*            count * float32 (x0, y0, x1, y1[, score])
+*   index  : 'SIDX', number of images, then per image
+*            record offset(uint64), count, name length, name (padded to 4 bytes)
+*   footer : index offset(uint64), number of images, 'SEND'
+* Records are appended one image at a time, index and footer are written on close.
+* A file without index (e.g. interrupted run) is still readable by scanning records, so is one
+* whose index does not match its record headers. */
+
+constexpr uint32_t SEGFILE_VERSION = 1;
+constexpr uint32_t SEGFILE_HAS_SCORE = 1;
+
+
+/* @brief Segments of one image, viewed from a mapped segment file. */
+struct SegmentView
+{
+	const float* data = nullptr;
+	size_t       count = 0;
+	int          stride = 4;	// 4 floats, or 5 with score
+
+	/* @brief Return i-th segment. */
+	LineSegment operator[](size_t i) const
+	{
+		const float* ptr = data + i * stride;
+		return LineSegment(ptr[0], ptr[1], ptr[2], ptr[3]);
+	}
+
+	/* @brief Return i-th segment's score, 0 if file has no score. */
+	float score(size_t i) const
+	{
+		return stride > 4 ? data[i * stride + 4] : 0.0f;
+	}
+
+	/* @brief Copy to a segment list. */
+	void toList(LineSegList& segments) const
+	{
+		segments.clear();
+		segments.reserve(count);
+		for (size_t i = 0; i != count; ++i)
+			segments.emplace_back((*this)[i]);
+	}
+};
+
+
+/* @brief Entry of an image in segment file. */
+struct SegFileEntry
+{
+	std::string name;
+	uint64_t    offset = 0;	// offset of record header
+	uint32_t    count = 0;
+};
+
+
+/* @brief Append-only writer of binary segment file. */
+class SegmentFileWriter
+{
+public:
+	SegmentFileWriter() = default;
+	SegmentFileWriter(const SegmentFileWriter&) = delete;
+	SegmentFileWriter& operator=(const SegmentFileWriter&) = delete;
+	~SegmentFileWriter() { close(); }
+
+	/* @brief Open file for writing.
+	* @param append: keep records of an existing file, and continue after them. */
+	bool open(
+		const std::string& filepath,
+		bool               hasScore = false,
+		bool               append = false
+	);
+
+	/* @brief Append segments of an image, scores are written only if file has score. */
+	bool append(
+		const std::string&        name,
+		const LineSegList&        segments,
+		const std::vector<float>& scores = std::vector<float>()
+	);
+
+	/* @brief Write index and footer, then close. */
+	void close();
+
+	bool isOpen() const { return ofs.is_open(); }
+
+private:
+	std::fstream              ofs;
+	bool                      hasScore = false;
+	std::vector<SegFileEntry> entries;
+};
+
+
+/* @brief Reader of binary segment file, segments are viewed from the mapped file. */
+class SegmentFileReader
+{
+public:
+	/* @brief Map file and load index, rebuild index by scanning if it's missing or corrupt. */
+	bool open(const std::string& filepath);
+
+	void close();
+
+	/* @brief Number of images. */
+	size_t size() const { return entries.size(); }
+
+	const std::string& name(size_t i) const { return entries[i].name; }
+
+	bool hasScore() const { return stride > 4; }
+
+	/* @brief Segments of i-th image, valid until the reader is closed. */
+	SegmentView view(size_t i) const;
+
+	/* @brief Find segments by image name. */
+	bool find(
+		const std::string& name,
+		SegmentView&       segView
+	) const;
+
+private:
+	MappedFile                              file;
+	int                                     stride = 4;
+	std::vector<SegFileEntry>               entries;
+	std::unordered_map<std::string, size_t> lookup;
+};
+
+
+/* @brief Export every image in segment file to CSV files by write2txt. */
+bool exportSegmentFileCSV(
+	const std::string& filepath,
+	const std::string& dir,
+	const std::string& suffix = ".csv"
+);
+
+
 #endif // !__IO_FILE_HPP__
 
@@ -1,6 +1,7 @@
 #include "lsd.hpp"
 #include "drawutils.hpp"
 #include "segments.hpp"
+#include "alignED.hpp"
 
 /* @brief Pixel test for Edge Drawing. */
 bool isAnchorED(
@@ -267,455 +268,19 @@ void extractAlignedAnchors(
 
 
 
-Pixel walkToNextPixel(
-	const GradientInfo* pGradInfo,
-	const cv::Vec4f&    line,
-	const Pixel&        currPx,
-	float               prevAng,
-	bool                posDir
-)
-{
-	auto& gradx = pGradInfo->gradx;
-	auto& grady = pGradInfo->grady;
-	auto& mag = pGradInfo->mag;
-	auto& ori = pGradInfo->ori;
-
-	// line angle guided
-	double lineAng = std::atan(line[1] / line[0]) * 180.0 / CV_PI;	// [-90.0, 90.0]
-
-	std::vector<int> dx(3), dy(3);
-	if (prevAng >= -90.0 && prevAng < -67.5 && lineAng >= -67.5 && lineAng < -22.5)
-	{
-		dx = { -1, -1, 0 };
-		dy = { 0, 1, 1 };
-
-		if (!posDir)
-		{
-			dx = { 1, 1, 0 };
-			dy = { 0, -1, -1 };
-		}
-	}
-	else if (lineAng >= -67.5 && lineAng < -22.5)	// -45-diagonal
-	{
-		// Test line is horizontal or vertical in previous step
-		dx = { 1, 1, 0 };
-		dy = { 0, -1, -1 };
-
-		if (!posDir)
-		{
-			dx = { -1, -1, 0 };
-			dy = { 0, 1, 1 };
-		}
-	}
-	else if (lineAng >= -22.5 && lineAng < 22.5)	// horizontal
-	{
-		dx = { 1, 1, 1 };
-		dy = { -1, 0, 1 };
-		if (!posDir)
-		{
-			dx = { -1, -1, -1 };
-			dy = { -1, 0, 1 };
-		}
-	}
-	else if (lineAng >= 22.5 && lineAng < 67.5)	// 45-diagonal
-	{
-		dx = { 0, 1, 1 };
-		dy = { 1, 1, 0 };
-		if (!posDir)
-		{
-			dx = { 0, -1, -1 };
-			dy = { -1, -1, 0 };
-		}
-	}
-	else // vertical
-	{
-		dx = { -1, 0, 1 };
-		dy = { 1, 1, 1 };
-		if (!posDir)
-		{
-			dx = { -1, 0, 1 };
-			dy = { -1, -1, -1 };
-		}
-	}
-
-	Pixel nextPx;
-	// Select the max one as next
-	for (int i = 0; i != dx.size(); ++i)
-	{
-		Pixel temp(currPx.x + dx[i], currPx.y + dy[i]);
-		if (!temp.isInMatrix(gradx)) 
-			continue;
-
-		temp.val = atPixel<float>(mag, temp);
-
-		if (temp.val > nextPx.val) 
-			nextPx = temp;
-	}
-
-	if (nextPx.val == FLT_MIN) 
-		return Pixel();
-
-	return nextPx;
-}
-
-
-
-Pixel jump(
-	const cv::Mat&          ori,
-	const cv::Mat&          labels,
-	const PixelList&        alignedAnchors,
-	const Pixel&            begPx,
-	std::vector<cv::Point>& points,
-	cv::Vec4f&              line,
-	std::vector<bool>&      used,
-	int                     jumpStep,
-	bool                    posDir
-)
-{
-	Pixel retPx;
-	if (!begPx.isInMatrix(labels))
-		return retPx;
-
-	// should use Bresenham, update later
-	bool isHorizontal = std::abs(line[1] / line[0]) <= 1.0;
-	bool findAligned = false;
-	int dx = 0, dy = 0;
-
-	if (isHorizontal) 
-		dx = 1;
-	else 
-		dy = 1;
-
-	if (!posDir) dx *= -1, dy *= -1;
-
-	for (int i = 1; i <= jumpStep && findAligned == false; ++i)
-	{
-		Pixel temp;
-
-		if (isHorizontal)
-		{
-			temp.x = begPx.x + dx * i;
-			temp.y = retY(temp.x, line);
-		}
-		else
-		{
-			temp.y = begPx.y + dy * i;
-			temp.x = retX(temp.y, line);
-		}
-
-		temp = temp.round();
-		if (!temp.isInMatrix(labels))
-			continue;
-
-		int label = atPixel<int>(labels, temp); 
-		
-		float cosTheta = 0.0f, sinTheta = 0.0f;
-		if (label != -1 && !used[label])	// detect aligned anchor
-		{
-			// initialize points set
-			for (int i = 0; i != 3; ++i)
-			{
-				const auto& ang = atPixel<float>(ori, alignedAnchors[3 * label + i]) - 90.0;
-				cosTheta += std::cos(ang * CV_PI / 180.0);
-				sinTheta += std::sin(ang * CV_PI / 180.0);
-			}
-
-			float anchorAng = std::atan(sinTheta / cosTheta) * 180.0 / CV_PI;
-			float lineAng = std::atan(line[1] / line[0]) * 180.0 / CV_PI;
-
-			if (angleDiff(anchorAng, lineAng) <= /*aligned-diff*/ANG_TOLERANCE)
-			{
-				used[label] = true;
-
-				// select farest pixel as next one
-				float dist2begPx = FLT_MIN;
-				for (int i = 0; i != 3; ++i)
-				{
-					const auto& tempPx = alignedAnchors[label * 3 + i];
-
-					points.emplace_back(tempPx.point());
-
-					if ((tempPx - begPx) * (tempPx - begPx) > dist2begPx)
-					{
-						dist2begPx = (tempPx - begPx) * (tempPx - begPx);
-						retPx = tempPx;
-					}
-				}
-
-				cv::fitLine(points, line, cv::DIST_L2, 0.0, 0.01, 0.01);
-
-				findAligned = true;
-			}
-		}
-	}
-	
-	return retPx;
-}
-
-/* @brief Extend line. */
-LineSegment extend(
-	const GradientInfo* pGradInfo,
-	const PixelList&    alignedAnchors,
-	cv::Mat&            labels,
-	std::vector<bool>&  used,
-	int                 groupInd
-)
-{
-	if (used[groupInd])
-		return LineSegment();
-
-	auto& gradx = pGradInfo->gradx;
-	auto& grady = pGradInfo->grady;
-	auto& mag = pGradInfo->mag;
-	auto& ori = pGradInfo->ori;
-
-	std::vector<bool> visited(gradx.rows * gradx.cols, false);
-
-	// initialize points set
-	cv::Vec4f lineRes;	// [cos_theta, sin_theta, x0, y0]
-	std::vector<cv::Point> pts;
-	for (int i = 0; i != 3; ++i)
-	{
-		const auto& ang = atPixel<float>(ori, alignedAnchors[3 * groupInd + i]) - 90.0;
-
-		lineRes[0] += std::cos(ang * CV_PI / 180.0);
-		lineRes[1] += std::sin(ang * CV_PI / 180.0);
-
-		pts.emplace_back(alignedAnchors[3 * groupInd + i].point());
-	}
-	lineRes[2] = pts[1].x, lineRes[3] = pts[1].y;	// middle one as init point
-	visited[pts[1].x + pts[1].y * gradx.cols] = true;
-
-	used[groupInd] = true;
-
-	// Previous line angle, for walk to next pixel
-	float prevAng = FLT_MIN;
-
-	// 2 end-points of a line segment
-	Pixel endPx1(walkToNextPixel(pGradInfo, lineRes, alignedAnchors[3 * groupInd + 1], prevAng, true));
-	Pixel endPx2(walkToNextPixel(pGradInfo, lineRes, alignedAnchors[3 * groupInd + 1], prevAng, false));
-	
-	int numAddPx = 0;
-	LineSegment segRes;	// output
-
-	/* Start to extend, go positive direction firstly. */
-	Pixel currPx(endPx1);
-	currPx.val = atPixel<float>(mag, endPx1);
-
-	while (currPx.val != FLT_MIN && currPx.isInMatrix(gradx))
-	{
-		visited[int(currPx.y * gradx.cols + currPx.x)] = true;
-		Pixel nextPx(walkToNextPixel(pGradInfo, lineRes, currPx, prevAng, true));
-
-		if (!nextPx.isInMatrix(gradx) || 
-			visited[int(nextPx.y * gradx.cols + nextPx.x)] ||
-			nextPx.val == FLT_MIN ||
-			nextPx.val < MIN_GRAD_THRESH)
-			break; // out of matrix's range, break
-		
-		// angle range is [-90.0, 90.0]
-		float nextAng = atPixel<float>(ori, nextPx) - 90.0;
-		float lineAng = std::atan(lineRes[1] / lineRes[0]) * 180.0 / CV_PI;
-
-		if (angleDiff(nextAng, lineAng) > ANG_TOLERANCE )	// Detect direction change, or weak pixel
-		{
-			currPx = jump(ori, labels, alignedAnchors, 
-				nextPx, pts, lineRes,  used, 9, true);
-			if (currPx == Pixel()) break;
-
-			numAddPx += 3;
-			continue;
-		}
-
-		// Calculate distance point to line
-		LineSegment tempSeg;
-		if (std::abs(lineRes[1] / lineRes[0]) > 1.0) // vertical line
-		{
-			tempSeg.begPx = Pixel(retX(endPx2.y, lineRes), endPx2.y);
-			tempSeg.endPx = Pixel(retX(currPx.y, lineRes), currPx.y);
-		}
-		else // horizontal line
-		{
-			tempSeg.begPx = Pixel(endPx2.x, retY(endPx2.x, lineRes));
-			tempSeg.endPx = Pixel(currPx.x, retY(currPx.x, lineRes));
-		}
-
-		if (tempSeg.point2lineDist(nextPx) > DIST_TOLERANCE)
-			break;
-		
-		int label = atPixel<int>(labels, nextPx);
-		// add aligned anchors to this group
-		if (label != -1)	
-		{
-			if (used[label] == false)// first detect aligned-anchors group
-			{
-				used[label] = true;
-
-				// select farest pixel as next one
-				float dist2endPx = FLT_MIN;
-				for (int i = 0; i != 3; ++i)
-				{
-					const auto& tempPx = alignedAnchors[label * 3 + i];
-					pts.emplace_back(tempPx.point());
-
-					if ((tempPx - endPx2) * (tempPx - endPx2) > dist2endPx)
-					{
-						dist2endPx = (tempPx - endPx2) * (tempPx - endPx2);
-						nextPx = tempPx;
-					}
-				}
-
-				numAddPx += 3;
-			}
-		}
-		else
-		{
-			pts.emplace_back(nextPx.x, nextPx.y);
-			numAddPx += 1;
-		}
-
-		// update current pixel
-		currPx = nextPx;	
-		endPx1 = currPx;
-
-
-		prevAng = lineRes[1] / lineRes[0] * 180.0 / CV_PI;
-		cv::fitLine(pts, lineRes, cv::DIST_L2, 0, 0.01, 0.01);
-	}
-
-	/* Then, extend towards negative direction. */
-	currPx = endPx2;
-	currPx.val = atPixel<float>(mag, currPx);
-
-	while (currPx.val != FLT_MIN && currPx.isInMatrix(gradx))
-	{
-		visited[int(currPx.y * gradx.cols + currPx.x)] = true;
-		Pixel nextPx(walkToNextPixel(pGradInfo, lineRes, currPx, prevAng, false));
-
-		if (!nextPx.isInMatrix(gradx) || 
-			visited[int(nextPx.y * gradx.cols + nextPx.x)] ||
-			nextPx.val == FLT_MIN ||
-			nextPx.val < MIN_GRAD_THRESH)
-			break; // out of matrix's range, break
-
-		// angle range is [-90.0, 90.0]
-		float nextAng = atPixel<float>(ori, nextPx) - 90.0;
-		float lineAng = std::atan(lineRes[1] / lineRes[0]) * 180.0 / CV_PI;
-
-		if (angleDiff(nextAng, lineAng) > ANG_TOLERANCE)	// Detect direction change
-		{
-			currPx = jump(ori, labels, alignedAnchors,
-				nextPx, pts, lineRes, used, 9, false);
-			if (currPx == Pixel()) break;
-
-			numAddPx += 3;
-			continue;
-		}
-
-		// Calculate distance point to line
-		LineSegment tempSeg;
-		if (std::abs(lineRes[1] / lineRes[0]) > 1.0) // vertical line
-		{
-			tempSeg.begPx = Pixel(retX(endPx1.y, lineRes), endPx1.y);
-			tempSeg.endPx = Pixel(retX(currPx.y, lineRes), currPx.y);
-		}
-		else // horizontal line
-		{
-			tempSeg.begPx = Pixel(endPx1.x, retY(endPx1.x, lineRes));
-			tempSeg.endPx = Pixel(currPx.x, retY(currPx.x, lineRes));
-		}
-
-		if (tempSeg.point2lineDist(nextPx) > DIST_TOLERANCE)
-			break;
-
-		int label = atPixel<int>(labels, nextPx);
-		// add aligned anchors to this group
-		if (label != -1)
-		{
-			if (used[label] == false)// first detect aligned-anchors group
-			{
-				used[label] = true;
-
-				// select farest pixel as next one
-				float dist2endPx = FLT_MIN;
-				for (int i = 0; i != 3; ++i)
-				{
-					const auto& tempPx = alignedAnchors[label * 3 + i];
-					pts.emplace_back(tempPx.point());
-
-					if ((tempPx - endPx1) * (tempPx - endPx1) > dist2endPx)
-					{
-						dist2endPx = (tempPx - endPx1) * (tempPx - endPx1);
-						nextPx = tempPx;
-					}
-				}
-				numAddPx += 3;
-			}
-		}
-		else
-		{
-			pts.emplace_back(nextPx.x, nextPx.y);
-			numAddPx += 1;
-		}
-
-		// update current pixel
-		currPx = nextPx;
-		endPx2 = currPx;
-
-		prevAng = lineRes[1] / lineRes[0] * 180.0 / CV_PI;
-		cv::fitLine(pts, lineRes, cv::DIST_L2, 0, 0.01, 0.01);
-	}
-
-	if (numAddPx < 6) return LineSegment();
-
-	if (std::abs(lineRes[1] / lineRes[0]) > 1.0)
-	{
-		segRes.begPx = Pixel(retX(endPx1.y, lineRes), endPx1.y);
-		segRes.endPx = Pixel(retX(endPx2.y, lineRes), endPx2.y);
-	}
-	else
-	{
-		segRes.begPx = Pixel(endPx1.x, retY(endPx1.x, lineRes));
-		segRes.endPx = Pixel(endPx2.x, retY(endPx2.x, lineRes));
-	}
-
-	return segRes;
-}
-
-
-/* @brief My routing method. */
+/* @brief My routing method, the routing engine of AED::detect without ED anchors.
+Weak segments are dropped, as candidates they are kept by AED::detect only. */
 void routing(
 	const GradientInfo* pGradInfo,
 	const PixelList&    alignedAnchors,
 	LineSegList&        lineSegments
 )
 {
-	auto& gradx = pGradInfo->gradx;
-	auto& grady = pGradInfo->grady;
-	auto& mag = pGradInfo->mag;
-	auto& ori = pGradInfo->ori;
-
-	// init label map
-	cv::Mat_<int> labels(gradx.rows, gradx.cols, -1);
-	for (size_t ind = 0; ind != alignedAnchors.size(); ++ind)
-	{
-		const auto& px = alignedAnchors[ind];
-		labels.ptr<int>(px.y)[int(px.x)] = ind / 3;
-	}
+	AED::LinkParams params;
+	params.engine = AED::LINK_ROUTING;
 
-	// init 
-	std::vector<bool> used(alignedAnchors.size() / 3, false);
-
-	// 从中心幅值最大处的aligned anchor开始，根据其拟合出初始直线 line->(dir, center).
-	for (int groupInd = 0; groupInd != used.size(); ++groupInd)
-	{
-		if (used[groupInd]) continue;
-		LineSegment seg = extend(pGradInfo, alignedAnchors, labels, used, groupInd);
-
-		if (seg == LineSegment()) continue;
-
-		lineSegments.emplace_back(seg);
-	}
+	LineSegList candidateSegments;
+	AED::detect(pGradInfo, alignedAnchors, PixelList(), lineSegments, candidateSegments, params);
 
 	return;
 }
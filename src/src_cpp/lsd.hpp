@@ -83,40 +83,7 @@ extern void extractAlignedAnchors(
 );
 
 
-/* @brief Walk to next pixel. */
-extern Pixel walkToNextPixel(
-	const GradientInfo* pGradInfo, 
-	const cv::Vec4f&    line,
-	const Pixel&        currPx, 
-	float               prevAng,
-	bool                posDir
-);
-
-
-extern Pixel jump(
-	const cv::Mat&          ori,
-	const cv::Mat&          labels,
-	const PixelList&        alignedAnchors,
-	const Pixel&            begPx,
-	std::vector<cv::Point>& points,
-	cv::Vec4f&              line,
-	std::vector<bool>&      used,
-	int                     jumpStep = 3,
-	bool                    posDir = true
-);
-
-
-/* @brief Extend line from aligned anchors. */
-extern LineSegment extend(
-	const GradientInfo* pGradInfo,
-	const PixelList&    alignedAnchors,
-	cv::Mat&            labels,
-	std::vector<bool>&  used,
-	int                 groupInd
-);
-
-
-/* @brief My routing method. */
+/* @brief My routing method, runs the routing engine of AED::detect. */
 extern void routing(
 	const GradientInfo* pGradInfo,
 	const PixelList&    alignedAnchors,
@@ -5,11 +5,25 @@
 #include "iofile.hpp"
 #include "drawutils.hpp"
 #include "alignED.hpp"
+#include "successor.hpp"
 
 
 // if define, we evaluate on the YorkUrban dataset
 #define YORK_URBAN_EVALUATE
 
+// if define, HPatches results are written to one binary segment file,
+// CSV files can be exported by exportSegmentFileCSV. Otherwise, one CSV per image.
+//#define SEGMENT_BINARY_OUTPUT
+
+// if define with SEGMENT_BINARY_OUTPUT, records of an existing file are kept and a run resumes after them
+//#define SEGMENT_BINARY_RESUME
+
+// if define, near collinear segments are merged after linking
+//#define MERGE_COLLINEAR_SEGMENTS
+
+// if define, a successor map is built after the gradient and walks read it, see successor.hpp
+//#define PRECOMPUTE_SUCCESSORS
+
 
 int main(void)
  {
@@ -37,12 +51,14 @@ int main(void)
 
 		cv::Mat testImg = cv::imread(imgPath, 0);	// grayscale
 		cv::Mat canvas = cv::imread(imgPath, cv::IMREAD_COLOR);	// color
-		cv::Mat tempImg = testImg.clone();
 		GradientInfoPtr pGradInfo = std::make_shared<GradientInfo>();
 
-		cv::GaussianBlur(testImg, testImg, cv::Size(5, 5), 1.0);
+		// blurred inside, testImg is only read
+		calcGradInfo(makeImageView(testImg), pGradInfo.get());
 
-		calcGradInfo(testImg, pGradInfo.get());
+#ifdef PRECOMPUTE_SUCCESSORS
+		AED::calcSuccessorMap(pGradInfo.get());
+#endif
 
 		std::vector<PixelLinkList> pxLists;
 		AED::pseudoSort<float>(pGradInfo->mag, pxLists);
@@ -52,13 +68,22 @@ int main(void)
 		AED::extractAlignedAnchors(pGradInfo.get(), pxLists, anchors);
 		//AED::extractAnchorED(pGradInfo.get(), pxLists, anchorsED);
 		NMS(pGradInfo.get(), anchorsED);
-		drawPixelList(testImg, anchors, 3, true);
-		drawPixelList(tempImg, anchorsED, 1, true);
+
+		// draw anchors
+		//drawPixelList(canvas, anchors, 3, true);
+		//drawPixelList(canvas, anchorsED, 1, true);
 		
 		LineSegList lineSegments;
 		LineSegList candidateSegments;
 		AED::detect(pGradInfo.get(), anchors, anchorsED, lineSegments, candidateSegments);
 
+#ifdef MERGE_COLLINEAR_SEGMENTS
+		AED::MergeStats mergeStats;
+		AED::mergeCollinearSegments(pGradInfo.get(), lineSegments, AED::MergeParams(), &mergeStats);
+		std::cout << "  merged " << mergeStats.numInput << " -> " << mergeStats.numOutput
+			<< " segments in " << mergeStats.ms << " ms";
+#endif
+
 		AED::validateCandidateSegments(pGradInfo.get(), candidateSegments);
 
 		cv::Mat res = drawLineSegments(lineSegments, testImg.size());
@@ -89,6 +114,21 @@ int main(void)
 
 	readFileNames(imgList, imgNames);
 
+#ifdef SEGMENT_BINARY_OUTPUT
+#ifdef SEGMENT_BINARY_RESUME
+	const bool isResume = true;
+#else
+	const bool isResume = false;
+#endif
+
+	// e.g. segWriter.open("data/results/hpatches-aag.segbin", false, isResume);
+	SegmentFileWriter segWriter;
+	if (!segWriter.open("your output path/results.segbin", false, isResume))
+	{
+		std::cerr << "Opening segment file failed." << std::endl;
+		return -1;
+	}
+#endif
 
 	for (int i = 0; i != imgNames.size(); ++i)
 	{
@@ -97,11 +137,14 @@ int main(void)
 
 		cv::Mat testImg = cv::imread(imgPath, 0);	// grayscale
 		cv::Mat canvas = cv::imread(imgPath, cv::IMREAD_COLOR);	// color
-		cv::Mat tempImg = testImg.clone();
 
+		// blurred inside, testImg is only read
 		GradientInfoPtr pGradInfo = std::make_shared<GradientInfo>();
-		cv::GaussianBlur(testImg, testImg, cv::Size(5, 5), 1.0);
-		calcGradInfo(testImg, pGradInfo.get());
+		calcGradInfo(makeImageView(testImg), pGradInfo.get());
+
+#ifdef PRECOMPUTE_SUCCESSORS
+		AED::calcSuccessorMap(pGradInfo.get());
+#endif
 
 		std::vector<PixelLinkList> pxLists;
 		AED::pseudoSort<float>(pGradInfo->mag, pxLists);
@@ -113,13 +156,20 @@ int main(void)
 		NMS(pGradInfo.get(), anchorsED);
 
 		// draw anchors
-		//drawPixelList(testImg, anchors, 3, true);
-		//drawPixelList(tempImg, anchorsED, 1, true);
+		//drawPixelList(canvas, anchors, 3, true);
+		//drawPixelList(canvas, anchorsED, 1, true);
 
 		LineSegList lineSegments;
 		LineSegList candidateSegments;
 		AED::detect(pGradInfo.get(), anchors, anchorsED, lineSegments, candidateSegments);
 
+#ifdef MERGE_COLLINEAR_SEGMENTS
+		AED::MergeStats mergeStats;
+		AED::mergeCollinearSegments(pGradInfo.get(), lineSegments, AED::MergeParams(), &mergeStats);
+		std::cout << "merged " << mergeStats.numInput << " -> " << mergeStats.numOutput
+			<< " segments in " << mergeStats.ms << " ms  ";
+#endif
+
 		//AED::validateCandidateSegments(pGradInfo.get(), candidateSegments);
 		//for (const auto& seg : candidateSegments)
 		//	lineSegments.emplace_back(seg);
@@ -135,7 +185,15 @@ int main(void)
 		dstDir = dstDir + "/" + imgNames[i].substr(0, ind);
 		std::string imgname = imgNames[i].substr(ind + 1);
 
+#ifdef SEGMENT_BINARY_OUTPUT
+		if (!segWriter.append(imgNames[i], lineSegments))
+		{
+			std::cerr << "\nWriting segments of " << imgNames[i] << " failed." << std::endl;
+			return -1;
+		}
+#else
 		write2txt(lineSegments, dstDir, imgname);
+#endif
 		cv::imwrite(dstDir + "/" + imgname.substr(0, imgname.find_last_of('.')) + ".jpg", canvas);
 
 	}
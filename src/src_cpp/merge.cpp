@@ -0,0 +1,225 @@
+#include "alignED.hpp"
+#include <unordered_map>
+#include <numeric>
+
+
+namespace AED
+{
+	/* @brief Key of a hash-grid bucket, cell coordinates and angle bin. */
+	static inline uint64_t bucketKey(int cellX, int cellY, int angBin)
+	{
+		return uint64_t(uint16_t(cellX)) << 32 | uint64_t(uint16_t(cellY)) << 16 | uint16_t(angBin);
+	}
+
+
+	/* @brief Gap between two segments along the longer one, 0 if they overlap.
+	False if they are not collinear within the tolerances. */
+	static bool collinearGap(
+		const LineSegment& lhs,
+		const LineSegment& rhs,
+		const MergeParams& params,
+		float&             gap
+	)
+	{
+		LineSegment longSeg(lhs), shortSeg(rhs);
+		if (longSeg.length() < shortSeg.length())
+			std::swap(longSeg, shortSeg);
+
+		float length = longSeg.length();
+		if (shortSeg.length() <= 0.0f ||
+			angleDiff(longSeg.angleDeg(), shortSeg.angleDeg()) > params.angleTolerance)
+			return false;
+
+		if (longSeg.point2lineDist(shortSeg.begPx) > params.distTolerance ||
+			longSeg.point2lineDist(shortSeg.endPx) > params.distTolerance)
+			return false;
+
+		// interval of the shorter segment along the longer one, which spans [0, length]
+		Pixel dir = (longSeg.endPx - longSeg.begPx) * (1.0f / length);
+		float t0 = (shortSeg.begPx - longSeg.begPx) * dir;
+		float t1 = (shortSeg.endPx - longSeg.begPx) * dir;
+
+		gap = std::max(0.0f, std::max(std::min(t0, t1) - length, -std::max(t0, t1)));
+
+		return true;
+	}
+
+
+	/* @brief Segment spanning both, on the length-weighted line of the two. */
+	static LineSegment mergeSegments(
+		LineSegment lhs,
+		LineSegment rhs
+	)
+	{
+		float lenL = lhs.length(), lenR = rhs.length();
+
+		Pixel dirL = (lhs.endPx - lhs.begPx) * (1.0f / lenL);
+		Pixel dirR = (rhs.endPx - rhs.begPx) * (1.0f / lenR);
+		if (dirL * dirR < 0.0f)
+			dirR = dirR * -1.0f;
+
+		Pixel dir = dirL * lenL + dirR * lenR;
+		dir = dir * (1.0f / std::sqrt(dir * dir));
+
+		Pixel center = ((lhs.begPx + lhs.endPx) * (0.5f * lenL) + (rhs.begPx + rhs.endPx) * (0.5f * lenR)) *
+			(1.0f / (lenL + lenR));
+
+		float ts[4] = {
+			(lhs.begPx - center) * dir, (lhs.endPx - center) * dir,
+			(rhs.begPx - center) * dir, (rhs.endPx - center) * dir };
+
+		float tMin = *std::min_element(ts, ts + 4);
+		float tMax = *std::max_element(ts, ts + 4);
+
+		return LineSegment(center + dir * tMin, center + dir * tMax);
+	}
+
+
+	/* @brief Merge near line segment. */
+	void mergeCollinearSegments(
+		const GradientInfo* pGradInfo,
+		LineSegList&        lineSegments,
+		const MergeParams&  params,
+		MergeStats*         stats
+	)
+	{
+		int64 t0 = cv::getTickCount();
+
+		const cv::Mat& ori = pGradInfo->ori;
+		const int numSegs = int(lineSegments.size());
+
+		// a cell holds any partner within the gap of an end-point, in the 3x3 neighborhood
+		const float cellSize = std::max(params.maxGap + params.distTolerance, 4.0f);
+
+		// angle bins are no narrower than the tolerance, partners are in neighbor bins
+		const int numAngBins = std::max(3, int(180.0f / std::max(params.angleTolerance, 1.0f)));
+		const float angBinSize = 180.0f / numAngBins;
+
+		auto angleBin = [&](LineSegment& seg)->int {
+			int bin = int((seg.angleDeg() + 90.0) / angBinSize);
+			return std::min(std::max(bin, 0), numAngBins - 1);
+		};
+
+		// every cell crossed by a segment, sampled at half a cell
+		std::unordered_map<uint64_t, std::vector<int>> grid;
+		grid.reserve(4 * numSegs);
+		for (int ind = 0; ind != numSegs; ++ind)
+		{
+			LineSegment& seg = lineSegments[ind];
+			float length = seg.length();
+			if (length <= 0.0f)
+				continue;
+
+			int angBin = angleBin(seg);
+			int numSteps = int(std::ceil(length / (0.5f * cellSize)));
+			uint64_t prevKey = ~uint64_t(0);
+			for (int step = 0; step <= numSteps; ++step)
+			{
+				Pixel px = seg.begPx + (seg.endPx - seg.begPx) * (float(step) / numSteps);
+				uint64_t key = bucketKey(int(std::floor(px.x / cellSize)), int(std::floor(px.y / cellSize)), angBin);
+				if (key == prevKey)
+					continue;
+
+				auto& bucket = grid[key];
+				if (bucket.empty() || bucket.back() != ind)
+					bucket.push_back(ind);
+				prevKey = key;
+			}
+		}
+
+		// union-find over segments, the root keeps the merged segment of its component
+		std::vector<int> parent(numSegs);
+		std::iota(parent.begin(), parent.end(), 0);
+		LineSegList merged(lineSegments);
+
+		auto findRoot = [&](int ind)->int {
+			while (parent[ind] != ind)
+				ind = parent[ind] = parent[parent[ind]];
+			return ind;
+		};
+
+		// longer segments absorb shorter ones first
+		std::vector<int> order(numSegs);
+		std::iota(order.begin(), order.end(), 0);
+		std::vector<float> lengths(numSegs);
+		for (int ind = 0; ind != numSegs; ++ind)
+			lengths[ind] = lineSegments[ind].length();
+		std::stable_sort(order.begin(), order.end(), [&](int lhs, int rhs)->bool {
+			return lengths[lhs] > lengths[rhs]; });
+
+		MergeStats localStats;
+		std::vector<int> candidates;
+
+		for (int ind : order)
+		{
+			LineSegment& seg = lineSegments[ind];
+			if (lengths[ind] <= 0.0f)
+				continue;
+
+			// partners near the two end-points, in this and neighbor angle bins
+			candidates.clear();
+			int angBin = angleBin(seg);
+			for (const Pixel& px : { seg.begPx, seg.endPx })
+			{
+				int cellX = int(std::floor(px.x / cellSize)), cellY = int(std::floor(px.y / cellSize));
+				for (int db = -1; db <= 1; ++db)
+				{
+					int bin = (angBin + db + numAngBins) % numAngBins;
+					for (int dy = -1; dy <= 1; ++dy)
+					{
+						for (int dx = -1; dx <= 1; ++dx)
+						{
+							auto it = grid.find(bucketKey(cellX + dx, cellY + dy, bin));
+							if (it != grid.end())
+								candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+						}
+					}
+				}
+			}
+
+			std::sort(candidates.begin(), candidates.end());
+			candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+			for (int other : candidates)
+			{
+				int root = findRoot(ind), otherRoot = findRoot(other);
+				if (root == otherRoot)
+					continue;
+
+				float gap = 0.0f;
+				if (!collinearGap(merged[root], merged[otherRoot], params, gap) || gap > params.maxGap)
+					continue;
+
+				LineSegment mergedSeg = mergeSegments(merged[root], merged[otherRoot]);
+				if (!alignedDensityValidate(ori, mergedSeg, params.alignedDensity))
+				{
+					++localStats.numRejected;
+					continue;
+				}
+
+				parent[otherRoot] = root;
+				merged[root] = mergedSeg;
+				++localStats.numMerged;
+			}
+		}
+
+		// one segment per component, in order of the root segments
+		LineSegList remains;
+		remains.reserve(numSegs - localStats.numMerged);
+		for (int ind = 0; ind != numSegs; ++ind)
+		{
+			if (findRoot(ind) == ind)
+				remains.emplace_back(merged[ind]);
+		}
+
+		localStats.numInput = numSegs;
+		localStats.numOutput = remains.size();
+		lineSegments.swap(remains);
+
+		localStats.ms = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+		if (stats != nullptr)
+			*stats = localStats;
+
+		return;
+	}
+}
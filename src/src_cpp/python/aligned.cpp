@@ -0,0 +1,239 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include "utilities.hpp"
+#include "alignED.hpp"
+#include "hierarchical.hpp"
+#include "successor.hpp"
+#include "imageview.hpp"
+
+
+namespace py = pybind11;
+
+
+/* @brief View of a uint8 NumPy array without copying, HxW or HxWxC with C in {1, 3, 4}.
+Rows may be strided, pixels must be contiguous. */
+static RawImageView arrayView(const py::array& image, bool isRGB)
+{
+	if (image.dtype().kind() != 'u' || image.dtype().itemsize() != 1)
+		throw py::type_error("image must be a uint8 array");
+
+	if (image.ndim() != 2 && image.ndim() != 3)
+		throw py::value_error("image must be HxW or HxWxC");
+
+	int channels = image.ndim() == 2 ? 1 : int(image.shape(2));
+	if (channels != 1 && channels != 3 && channels != 4)
+		throw py::value_error("image must have 1, 3 or 4 channels");
+
+	if (image.strides(0) <= 0 || image.strides(1) != channels ||
+		(image.ndim() == 3 && image.strides(2) != 1))
+		throw py::value_error("pixels of a row must be contiguous, use numpy.ascontiguousarray");
+
+	PixelFormat format = channels == 1 ? PIX_GRAY8 :
+		channels == 3 ? (isRGB ? PIX_RGB8 : PIX_BGR8) : (isRGB ? PIX_RGBA8 : PIX_BGRA8);
+
+	RawImageView view(static_cast<const uint8_t*>(image.data()), int(image.shape(1)), int(image.shape(0)),
+		size_t(image.strides(0)), format);
+	if (!view.isValid())
+		throw py::value_error("image is empty");
+
+	return view;
+}
+
+
+/* @brief Float32 array sharing a plane of the gradient, which is kept alive by the capsule. */
+static py::array planeArray(const cv::Mat& plane, const py::capsule& owner)
+{
+	return py::array_t<float>({ plane.rows, plane.cols },
+		{ py::ssize_t(plane.step[0]), py::ssize_t(sizeof(float)) }, plane.ptr<float>(), owner);
+}
+
+
+/* @brief Blurred gradient of the image as a dict of float32 arrays: mag, ori, gx, gy. */
+static py::dict gradInfo(
+	const py::array& image,
+	bool             isRGB,
+	int              kernelType,
+	int              blurSize,
+	double           blurSigma
+)
+{
+	RawImageView view = arrayView(image, isRGB);
+
+	GradientInfo* pGradInfo = new GradientInfo();
+	py::capsule owner(pGradInfo, [](void* ptr) { delete static_cast<GradientInfo*>(ptr); });
+
+	bool isOK;
+	{
+		py::gil_scoped_release release;
+		isOK = calcGradInfo(view, pGradInfo, kernelType, blurSize, blurSigma);
+	}
+	if (!isOK)
+		throw std::runtime_error("calculating gradient failed");
+
+	py::dict result;
+	result["mag"] = planeArray(pGradInfo->mag, owner);
+	result["ori"] = planeArray(pGradInfo->ori, owner);
+	result["gx"] = planeArray(pGradInfo->gradx, owner);
+	result["gy"] = planeArray(pGradInfo->grady, owner);
+
+	return result;
+}
+
+
+/* @brief Detect line segments, returned as an (N, 4) float32 array of x0, y0, x1, y1. */
+static py::array detect(
+	const py::array& image,
+	bool             isRGB,
+	float            anchorThresh,
+	float            angleTolerance,
+	int              bins,
+	double           magRange,
+	int              remainSteps,
+	float            anchorDensity,
+	float            alignedDensity,
+	float            minLength,
+	bool             useSuccessors
+)
+{
+	RawImageView view = arrayView(image, isRGB);
+
+	AED::LinkParams params;
+	params.remainSteps = remainSteps;
+	params.anchorDensity = anchorDensity;
+	params.alignedDensity = alignedDensity;
+	params.minLength = minLength;
+	params.useSuccessors = useSuccessors;
+
+	std::vector<float>* coords = new std::vector<float>();
+	py::capsule owner(coords, [](void* ptr) { delete static_cast<std::vector<float>*>(ptr); });
+
+	bool isOK;
+	{
+		// the array is referenced by the caller, its buffer stays valid without the GIL
+		py::gil_scoped_release release;
+
+		GradientInfo gradInfo;
+		isOK = calcGradInfo(view, &gradInfo);
+		if (isOK)
+		{
+			if (params.useSuccessors)
+				AED::calcSuccessorMap(&gradInfo);
+
+			std::vector<PixelLinkList> pxLists;
+			AED::pseudoSort<float>(gradInfo.mag, pxLists, bins, magRange);
+
+			PixelList alignedAnchors, anchorsED;
+			AED::extractAlignedAnchors(&gradInfo, pxLists, alignedAnchors, anchorThresh, angleTolerance);
+			NMS(&gradInfo, anchorsED);
+
+			LineSegList lineSegments, candidateSegments;
+			AED::detect(&gradInfo, alignedAnchors, anchorsED, lineSegments, candidateSegments, params);
+
+			coords->reserve(4 * lineSegments.size());
+			for (const auto& seg : lineSegments)
+			{
+				coords->push_back(seg.begPx.x);
+				coords->push_back(seg.begPx.y);
+				coords->push_back(seg.endPx.x);
+				coords->push_back(seg.endPx.y);
+			}
+		}
+	}
+	if (!isOK)
+		throw std::runtime_error("calculating gradient failed");
+
+	return py::array_t<float>({ py::ssize_t(coords->size() / 4), py::ssize_t(4) },
+		{ py::ssize_t(4 * sizeof(float)), py::ssize_t(sizeof(float)) }, coords->data(), owner);
+}
+
+
+/* @brief Aligned anchors, an (N, 3, 3) float32 array, each anchor is (neighbor, anchor, neighbor)
+of (x, y, magnitude). Extracted from pseudoSort's lists as detect does, or by the hierarchical
+detector; both bin the magnitude the same way. */
+static py::array alignedAnchors(
+	const py::array& image,
+	bool             isRGB,
+	bool             isHierarchical,
+	int              bins,
+	double           magRange,
+	float            anchorThresh,
+	float            angleTolerance,
+	int              kernelType,
+	int              blurSize,
+	double           blurSigma
+)
+{
+	RawImageView view = arrayView(image, isRGB);
+
+	std::vector<float>* values = new std::vector<float>();
+	py::capsule owner(values, [](void* ptr) { delete static_cast<std::vector<float>*>(ptr); });
+
+	bool isOK;
+	{
+		py::gil_scoped_release release;
+
+		GradientInfo gradInfo;
+		isOK = calcGradInfo(view, &gradInfo, kernelType, blurSize, blurSigma);
+		if (isOK)
+		{
+			PixelList anchors;
+			if (isHierarchical)
+			{
+				AED::HierarchicalAnchorDetector detector(&gradInfo);
+				detector.detect(bins, magRange, anchorThresh, angleTolerance);
+				anchors = detector.alignedAnchors();
+			}
+			else
+			{
+				std::vector<PixelLinkList> pxLists;
+				AED::pseudoSort<float>(gradInfo.mag, pxLists, bins, magRange);
+				AED::extractAlignedAnchors(&gradInfo, pxLists, anchors, anchorThresh, angleTolerance);
+			}
+
+			values->reserve(3 * anchors.size());
+			for (const auto& px : anchors)
+			{
+				values->push_back(px.x);
+				values->push_back(px.y);
+				values->push_back(px.val);
+			}
+		}
+	}
+	if (!isOK)
+		throw std::runtime_error("calculating gradient failed");
+
+	return py::array_t<float>({ py::ssize_t(values->size() / 9), py::ssize_t(3), py::ssize_t(3) },
+		{ py::ssize_t(9 * sizeof(float)), py::ssize_t(3 * sizeof(float)), py::ssize_t(sizeof(float)) },
+		values->data(), owner);
+}
+
+
+PYBIND11_MODULE(aligned, m)
+{
+	m.doc() = "AAGLSD line segment detector, NumPy arrays in and out without copying";
+
+	m.def("grad_info", &gradInfo,
+		"Blurred gradient of a uint8 image, dict of float32 arrays 'mag', 'ori', 'gx', 'gy'.",
+		py::arg("image"), py::kw_only(), py::arg("rgb") = false, py::arg("kernel_type") = 0,
+		py::arg("blur_size") = 5, py::arg("blur_sigma") = 1.0);
+
+	m.def("detect", &detect,
+		"Detect line segments in a uint8 image (HxW, HxWx3 or HxWx4, BGR unless rgb=True).\n"
+		"Returns an (N, 4) float32 array of x0, y0, x1, y1. The GIL is released while detecting.\n"
+		"successors=True walks on a successor map built after the gradient, the same selection precomputed.",
+		py::arg("image"), py::kw_only(), py::arg("rgb") = false,
+		py::arg("anchor_thresh") = 3.0f, py::arg("angle_tolerance") = 22.5f, py::arg("bins") = 1024,
+		py::arg("mag_range") = 255.0, py::arg("remain_steps") = 7, py::arg("anchor_density") = 0.5f,
+		py::arg("aligned_density") = 0.9f, py::arg("min_length") = 5.0f, py::arg("successors") = false);
+
+	m.def("aligned_anchors", &alignedAnchors,
+		"Aligned anchors of a uint8 image, the ones detect links with the same bins and mag_range.\n"
+		"hierarchical=True uses the bucketed detector, as HierachicalAnchorDetector.detect(bins, mag_range).\n"
+		"Returns an (N, 3, 3) float32 array, each anchor is (neighbor, anchor, neighbor) of (x, y, val).",
+		py::arg("image"), py::kw_only(), py::arg("rgb") = false, py::arg("hierarchical") = false,
+		py::arg("bins") = 1024, py::arg("mag_range") = 255.0, py::arg("anchor_thresh") = 3.0f,
+		py::arg("angle_tolerance") = 22.5f, py::arg("kernel_type") = 0,
+		py::arg("blur_size") = 5, py::arg("blur_sigma") = 1.0);
+}
@@ -0,0 +1,357 @@
+#include "routinglink.hpp"
+
+
+namespace AED
+{
+	// pixels a jump looks ahead for an aligned group
+	constexpr int ROUTE_JUMP_STEPS = 9;
+
+	/* 3 pixels ahead of a pixel by line direction, [direction][posDir ? 0 : 1]:
+	-45-diagonal after a near-vertical step, -45-diagonal, horizontal, 45-diagonal, vertical. */
+	static const int ROUTE_DX[5][2][3] = {
+		{ { -1, -1, 0 }, { 1, 1, 0 } },
+		{ { 1, 1, 0 }, { -1, -1, 0 } },
+		{ { 1, 1, 1 }, { -1, -1, -1 } },
+		{ { 0, 1, 1 }, { 0, -1, -1 } },
+		{ { -1, 0, 1 }, { -1, 0, 1 } }
+	};
+
+	static const int ROUTE_DY[5][2][3] = {
+		{ { 0, 1, 1 }, { 0, -1, -1 } },
+		{ { 0, -1, -1 }, { 0, 1, 1 } },
+		{ { -1, 0, 1 }, { -1, 0, 1 } },
+		{ { 1, 1, 0 }, { -1, -1, 0 } },
+		{ { 1, 1, 1 }, { -1, -1, -1 } }
+	};
+
+
+	/* @brief Fit a line to the points in place, without copying them. */
+	static void fitRoute(
+		ArenaVector<cv::Point>& points,
+		cv::Vec4f&              line
+	)
+	{
+		cv::Mat pointMat(int(points.size()), 1, CV_32SC2, points.data());
+		cv::fitLine(pointMat, line, cv::DIST_L2, 0, 0.01, 0.01);
+
+		return;
+	}
+
+
+	/* @brief The strongest of the 3 pixels ahead by line direction.
+	* @param prevAng: line angle of the previous step in degree, FLT_MIN at the start. */
+	static Pixel routeToNextPixel(
+		const GradientView& view,
+		const cv::Vec4f&    line,
+		const Pixel&        currPx,
+		float               prevAng,
+		bool                posDir
+	)
+	{
+		float lineAng = lineAngle(line);	// [-90.0, 90.0]
+
+		int dir = 4;	// vertical
+		if (prevAng >= -90.0 && prevAng < -67.5 && lineAng >= -67.5 && lineAng < -22.5)
+			dir = 0;
+		else if (lineAng >= -67.5 && lineAng < -22.5)
+			dir = 1;
+		else if (lineAng >= -22.5 && lineAng < 22.5)
+			dir = 2;
+		else if (lineAng >= 22.5 && lineAng < 67.5)
+			dir = 3;
+
+		const int* dx = ROUTE_DX[dir][posDir ? 0 : 1];
+		const int* dy = ROUTE_DY[dir][posDir ? 0 : 1];
+
+		Pixel nextPx;
+		for (int i = 0; i != 3; ++i)
+		{
+			Pixel temp(currPx.x + dx[i], currPx.y + dy[i]);
+			if (!temp.isInMatrix(view.mag))
+				continue;
+
+			temp.val = atPixel<float>(view.mag, temp);
+
+			if (temp.val > nextPx.val)
+				nextPx = temp;
+		}
+
+		if (nextPx.val == FLT_MIN)
+			return Pixel();
+
+		return nextPx;
+	}
+
+
+	/* @brief Link an unlinked group and add its anchors to the points.
+	* @return the anchor farthest from fromPx, with its magnitude. */
+	static Pixel joinGroup(
+		LinkWorkspace&          ws,
+		int                     groupInd,
+		const Pixel&            fromPx,
+		ArenaVector<cv::Point>& points,
+		ArenaVector<int>&       linkIndices
+	)
+	{
+		ws.groups.isLink[groupInd] = true;
+		linkIndices.push_back(groupInd);
+
+		Pixel farPx;
+		float dist2fromPx = FLT_MIN;
+		for (int i = 0; i != 3; ++i)
+		{
+			Pixel tempPx(ws.groups.point(groupInd, i));
+			points.emplace_back(tempPx.point());
+
+			if ((tempPx - fromPx) * (tempPx - fromPx) > dist2fromPx)
+			{
+				dist2fromPx = (tempPx - fromPx) * (tempPx - fromPx);
+				farPx = tempPx;
+			}
+		}
+		farPx.val = atPixel<float>(ws.view.mag, farPx);
+
+		return farPx;
+	}
+
+
+	/* @brief Look ahead along the line for an unlinked group aligned with it,
+	join it and refit the line.
+	* @return the joined group's farthest anchor, or an invalid pixel if none. */
+	static Pixel routeJump(
+		LinkWorkspace&          ws,
+		const Pixel&            begPx,
+		ArenaVector<cv::Point>& points,
+		ArenaVector<int>&       linkIndices,
+		cv::Vec4f&              line,
+		bool                    posDir
+	)
+	{
+		const ImageView<const int> labels(ws.labels);
+
+		bool isHorizontal = std::abs(line[1] / line[0]) <= 1.0;
+		int step = posDir ? 1 : -1;
+		float lineAng = lineAngle(line);
+
+		for (int i = 1; i <= ROUTE_JUMP_STEPS; ++i)
+		{
+			Pixel temp;
+			if (isHorizontal)
+			{
+				temp.x = begPx.x + step * i;
+				temp.y = retY(temp.x, line);
+			}
+			else
+			{
+				temp.y = begPx.y + step * i;
+				temp.x = retX(temp.y, line);
+			}
+
+			temp = temp.round();
+			if (!temp.isInMatrix(labels))
+				continue;
+
+			// ED anchors are labeled -2, only aligned groups are joined
+			int label = atPixel<int>(labels, temp);
+			if (label < 0 || ws.groups.isLink[label])
+				continue;
+
+			if (angleDiff(lineAngle(ws.groups.line(label)), lineAng) > ANG_TOLERANCE)
+				continue;
+
+			Pixel retPx = joinGroup(ws, label, begPx, points, linkIndices);
+			fitRoute(points, line);
+
+			return retPx;
+		}
+
+		return Pixel();
+	}
+
+
+	/* @brief Extend the line towards one direction from its end-point.
+	* @param endPx: the moving end-point, updated.
+	* @param otherEndPx: the fixed end-point of the other direction. */
+	static void routeDirection(
+		LinkWorkspace&          ws,
+		ArenaVector<cv::Point>& points,
+		ArenaVector<int>&       linkIndices,
+		cv::Vec4f&              lineRes,
+		float&                  prevAng,
+		Pixel&                  endPx,
+		const Pixel&            otherEndPx,
+		bool                    posDir,
+		int&                    numAddPx
+	)
+	{
+		const GradientView& view = ws.view;
+		const ImageView<const int> labels(ws.labels);
+
+		Pixel currPx(endPx);
+		while (currPx.val != FLT_MIN && currPx.isInMatrix(view.mag))
+		{
+			ws.visited.set(currPx);
+			Pixel nextPx(routeToNextPixel(view, lineRes, currPx, prevAng, posDir));
+
+			if (nextPx.val == FLT_MIN ||
+				ws.visited.test(nextPx) ||
+				nextPx.val < MIN_GRAD_THRESH)
+				break;
+
+			// angle range is [-90.0, 90.0]
+			float nextAng = atPixel<float>(view.ori, nextPx) - 90.0;
+
+			if (angleDiff(nextAng, lineAngle(lineRes)) > ANG_TOLERANCE)	// direction change, or weak pixel
+			{
+				currPx = routeJump(ws, nextPx, points, linkIndices, lineRes, posDir);
+				if (currPx.val == FLT_MIN)
+					break;
+
+				endPx = currPx;
+				numAddPx += 3;
+				continue;
+			}
+
+			// distance from the line between the end-points
+			LineSegment tempSeg;
+			if (std::abs(lineRes[1] / lineRes[0]) > 1.0)	// vertical line
+			{
+				tempSeg.begPx = Pixel(retX(otherEndPx.y, lineRes), otherEndPx.y);
+				tempSeg.endPx = Pixel(retX(currPx.y, lineRes), currPx.y);
+			}
+			else	// horizontal line
+			{
+				tempSeg.begPx = Pixel(otherEndPx.x, retY(otherEndPx.x, lineRes));
+				tempSeg.endPx = Pixel(currPx.x, retY(currPx.x, lineRes));
+			}
+
+			if (tempSeg.point2lineDist(nextPx) > DIST_TOLERANCE)
+				break;
+
+			int label = atPixel<int>(labels, nextPx);
+			if (label >= 0)
+			{
+				// first meet of an aligned group, go on from its farthest anchor
+				if (!ws.groups.isLink[label])
+				{
+					nextPx = joinGroup(ws, label, otherEndPx, points, linkIndices);
+					numAddPx += 3;
+				}
+			}
+			else
+			{
+				points.emplace_back(int(nextPx.x), int(nextPx.y));
+				numAddPx += 1;
+			}
+
+			currPx = nextPx;
+			endPx = currPx;
+
+			prevAng = lineAngle(lineRes);
+			fitRoute(points, lineRes);
+		}
+
+		return;
+	}
+
+
+	/* @brief Route from a seed group. */
+	static LineSegment routeGroup(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        candidateSegments,
+		int                 groupInd,
+		const LinkParams&   params
+	)
+	{
+		ws.visited.next();
+
+		ArenaVector<cv::Point> points(&ws.arena);
+		ArenaVector<int> linkIndices(&ws.arena);
+
+		// initial line is the anchor-line, through the middle anchor
+		cv::Vec4f lineRes = ws.groups.line(groupInd);
+		for (int i = 0; i != 3; ++i)
+			points.emplace_back(ws.groups.point(groupInd, i));
+
+		Pixel centerPx(ws.groups.center(groupInd));
+		ws.visited.set(centerPx);
+
+		ws.groups.isLink[groupInd] = true;
+		linkIndices.push_back(groupInd);
+
+		// previous line angle, for walk to next pixel
+		float prevAng = FLT_MIN;
+
+		// 2 end-points, a side without a next pixel stays at the center
+		Pixel endPx1(routeToNextPixel(ws.view, lineRes, centerPx, prevAng, true));
+		Pixel endPx2(routeToNextPixel(ws.view, lineRes, centerPx, prevAng, false));
+		if (endPx1.val == FLT_MIN)
+			endPx1 = centerPx;
+		if (endPx2.val == FLT_MIN)
+			endPx2 = centerPx;
+
+		int numAddPx = 0;
+		routeDirection(ws, points, linkIndices, lineRes, prevAng, endPx1, endPx2, true, numAddPx);
+		routeDirection(ws, points, linkIndices, lineRes, prevAng, endPx2, endPx1, false, numAddPx);
+
+		if (numAddPx < 6)
+			return LineSegment();
+
+		LineSegment segRes;
+		if (std::abs(lineRes[1] / lineRes[0]) > 1.0)
+		{
+			segRes.begPx = Pixel(retX(endPx1.y, lineRes), endPx1.y);
+			segRes.endPx = Pixel(retX(endPx2.y, lineRes), endPx2.y);
+		}
+		else
+		{
+			segRes.begPx = Pixel(endPx1.x, retY(endPx1.x, lineRes));
+			segRes.endPx = Pixel(endPx2.x, retY(endPx2.x, lineRes));
+		}
+
+		// filter short segment, before density validation
+		if (segRes.length() < params.minLength ||
+			!anchorDensityValidate(ws.labels, segRes, params.anchorDensity, &ws.arena))
+			return LineSegment();
+
+		// for short or weak segment, the groups are released
+		int alignedCnt = int(linkIndices.size()) - 1;
+		if (alignedCnt < 3 ||
+			!alignedDensityValidate(pGradInfo->ori, segRes, params.alignedDensity, &ws.arena))
+		{
+			for (int linkInd : linkIndices)
+				ws.groups.isLink[linkInd] = false;
+
+			candidateSegments.emplace_back(segRes);
+
+			return LineSegment();
+		}
+
+		return segRes;
+	}
+
+
+	/* @brief Link aligned-anchor groups by routing. */
+	void linkRouting(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	)
+	{
+		for (int groupInd = 0; groupInd != int(ws.groups.size()); ++groupInd)
+		{
+			if (ws.groups.isLink[groupInd])
+				continue;
+
+			LineSegment seg = routeGroup(pGradInfo, ws, candidateSegments, groupInd, params);
+
+			if (seg != LineSegment())
+				lineSegments.emplace_back(seg);
+		}
+
+		return;
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef __ROUTING_LINK_HPP__
+#define __ROUTING_LINK_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+#include "segments.hpp"
+#include "alignED.hpp"
+
+
+namespace AED
+{
+	/* @brief Link aligned-anchor groups by routing, the extend-and-jump linker of lsd.cpp.
+	Each unlinked group seeds a line from its anchor-line, which is extended both ways pixel by
+	pixel to the strongest neighbor ahead and refitted; where the orientation turns away, up to
+	9 pixels ahead along the line are searched for an aligned group to jump to. Visited pixels,
+	labels and link status live in the workspace. Validation and candidates follow
+	linkAlignedAnchorGroup, so engines differ in linking only. */
+	extern
+	void linkRouting(
+		const GradientInfo* pGradInfo,
+		LinkWorkspace&      ws,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params = LinkParams()
+	);
+}
+
+
+#endif // !__ROUTING_LINK_HPP__
@@ -0,0 +1,339 @@
+#include "seeding.hpp"
+#include <queue>
+
+
+namespace AED
+{
+	/* @brief Estimate how far a group extends by probing pixels along its anchor-line.
+	A probe stops at the first gap of 2 pixels which are weak or not aligned. */
+	int estimateExtension(
+		const LinkWorkspace& ws,
+		int                  groupInd,
+		int                  maxSteps
+	)
+	{
+		auto& mag = ws.view.mag;
+		auto& ori = ws.view.ori;
+
+		const cv::Vec4f line = ws.groups.line(groupInd);
+		float norm = std::sqrt(line[0] * line[0] + line[1] * line[1]);
+		if (norm <= 0.0f)
+			return 0;
+
+		Pixel dir(line[0] / norm, line[1] / norm);
+		Pixel center(line[2], line[3]);
+		float lineAng = lineAngle(line, true);
+
+		int length = 0;
+		for (int sign = -1; sign <= 1; sign += 2)
+		{
+			int gap = 0;
+			for (int step = 1; step <= maxSteps && gap < 2; ++step)
+			{
+				Pixel px = (center + dir * float(sign * step)).round();
+				if (!px.isInMatrix(mag))
+					break;
+
+				if (atPixel<float>(mag, px) >= MIN_GRAD_THRESH &&
+					angleDiff(atPixel<float>(ori, px) - 90.0f, lineAng) <= ANG_TOLERANCE)
+				{
+					length = length + 1 + gap;
+					gap = 0;
+				}
+				else
+				{
+					++gap;
+				}
+			}
+		}
+
+		return length;
+	}
+
+
+	/* @brief Return all groups in the given order. */
+	void orderSeeds(
+		const PixelList&     alignedAnchors,
+		const LinkWorkspace& ws,
+		SeedOrder            order,
+		std::vector<int>&    seeds
+	)
+	{
+		seeds.resize(ws.groups.size());
+		for (int groupInd = 0; groupInd != seeds.size(); ++groupInd)
+			seeds[groupInd] = groupInd;
+
+		if (order == SEED_BY_EXTRACTION)
+			return;
+
+		std::vector<float> keys(seeds.size(), 0.0f);
+		for (int groupInd = 0; groupInd != seeds.size(); ++groupInd)
+		{
+			if (order == SEED_BY_STRENGTH)
+			{
+				for (int i = 0; i != 3; ++i)
+					keys[groupInd] += alignedAnchors[3 * groupInd + i].val;
+			}
+			else
+			{
+				keys[groupInd] = estimateExtension(ws, groupInd);
+			}
+		}
+
+		// stable, ties keep anchor-extraction order
+		std::stable_sort(seeds.begin(), seeds.end(), [&](int lhs, int rhs)->bool {
+			return keys[lhs] > keys[rhs]; });
+
+		return;
+	}
+
+
+	/* @brief Anytime detection, the budget is checked between seeds. */
+	void detectAnytime(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		const DetectBudget& budget,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		bool&               truncated,
+		const LinkParams&   params
+	)
+	{
+		LinkWorkspace ws;
+		detectAnytime(pGradInfo, alignedAnchors, edAnchors, ws, budget,
+			lineSegments, candidateSegments, truncated, params);
+
+		return;
+	}
+
+
+	/* @brief Anytime detection on a kept workspace. */
+	void detectAnytime(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		LinkWorkspace&      ws,
+		const DetectBudget& budget,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		bool&               truncated,
+		const LinkParams&   params
+	)
+	{
+		truncated = false;
+
+		initLinkWorkspace(pGradInfo, alignedAnchors, edAnchors, ws);
+
+		std::vector<int> seeds;
+		orderSeeds(alignedAnchors, ws, budget.order, seeds);
+
+		size_t numBefore = lineSegments.size();
+
+		for (size_t ind = 0; ind != seeds.size(); ++ind)
+		{
+			int groupInd = seeds[ind];
+			if (ws.groups.isLink[groupInd])
+				continue;
+
+			if (std::chrono::steady_clock::now() >= budget.deadline ||
+				(budget.maxSegments > 0 && lineSegments.size() - numBefore >= size_t(budget.maxSegments)))
+			{
+				truncated = true;
+				break;
+			}
+
+			LineSegment seg = linkAlignedAnchorGroup(
+				pGradInfo, ws, candidateSegments, groupInd, params);
+
+			if (seg != LineSegment())
+				lineSegments.emplace_back(seg);
+		}
+
+		return;
+	}
+
+
+	/* @brief Estimated extension length of groups, from a coarse anchor-occupancy grid. */
+	void estimateExtensions(
+		const LinkWorkspace& ws,
+		std::vector<float>&  estimates,
+		const LinkParams&    params,
+		int                  cellSize
+	)
+	{
+		const auto& labels = ws.labels;
+
+		// max length of a run of pixels without anchors which a walk can cross,
+		// remain steps of both the walker and direction-changed extension
+		const int maxLinkGap = 2 * params.remainSteps + 2;
+
+		int gridCols = (labels.cols + cellSize - 1) / cellSize;
+		int gridRows = (labels.rows + cellSize - 1) / cellSize;
+
+		// coarse pass, a cell is occupied if it has any anchor
+		cv::Mat_<uchar> occupied(gridRows, gridCols, uchar(0));
+		for (int row = 0; row != labels.rows; ++row)
+		{
+			const int* ptr = labels.ptr<int>(row);
+			uchar* cellPtr = occupied.ptr<uchar>(row / cellSize);
+
+			for (int col = 0; col != labels.cols; ++col)
+			{
+				if (ptr[col] != -1)
+					cellPtr[col / cellSize] = 1;
+			}
+		}
+
+		// dilate by one cell, tolerates walks drifting from the seed's anchor-line
+		cv::Mat_<uchar> grid(gridRows, gridCols, uchar(0));
+		for (int row = 0; row != gridRows; ++row)
+		{
+			for (int col = 0; col != gridCols; ++col)
+			{
+				if (!occupied.ptr<uchar>(row)[col])
+					continue;
+
+				for (int dy = -1; dy <= 1; ++dy)
+				{
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						int y = row + dy, x = col + dx;
+						if (x >= 0 && y >= 0 && x < gridCols && y < gridRows)
+							grid.ptr<uchar>(y)[x] = 1;
+					}
+				}
+			}
+		}
+
+		// march along each anchor-line by half a cell,
+		// stop after an empty run longer than a walk can cross
+		float stepLen = 0.5f * cellSize;
+		int maxEmpty = int(std::ceil((maxLinkGap + cellSize) / stepLen));
+
+		estimates.assign(ws.groups.size(), 0.0f);
+		for (size_t groupInd = 0; groupInd != estimates.size(); ++groupInd)
+		{
+			const cv::Vec4f line = ws.groups.line(groupInd);
+			float norm = std::sqrt(line[0] * line[0] + line[1] * line[1]);
+			if (norm <= 0.0f)
+				continue;
+
+			float dirX = line[0] / norm, dirY = line[1] / norm;
+
+			for (int sign = -1; sign <= 1; sign += 2)
+			{
+				float reach = 0.0f;
+				int empty = 0;
+
+				for (int step = 1; empty <= maxEmpty; ++step)
+				{
+					float x = line[2] + sign * step * stepLen * dirX;
+					float y = line[3] + sign * step * stepLen * dirY;
+					if (x < 0 || y < 0 || x >= labels.cols || y >= labels.rows)
+						break;
+
+					if (grid.ptr<uchar>(int(y) / cellSize)[int(x) / cellSize])
+					{
+						reach = step * stepLen;
+						empty = 0;
+					}
+					else
+					{
+						++empty;
+					}
+				}
+
+				estimates[groupInd] += reach + cellSize;
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief Detect the K longest line segments, no shorter than minLength, approximate. */
+	void detectTopK(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		int                 K,
+		float               minLength,
+		LineSegList&        lineSegments,
+		const LinkParams&   params
+	)
+	{
+		LinkWorkspace ws;
+		detectTopK(pGradInfo, alignedAnchors, edAnchors, ws, K, minLength, lineSegments, params);
+
+		return;
+	}
+
+
+	/* @brief Top-K detection on a kept workspace. */
+	void detectTopK(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		LinkWorkspace&      ws,
+		int                 K,
+		float               minLength,
+		LineSegList&        lineSegments,
+		const LinkParams&   params
+	)
+	{
+		lineSegments.clear();
+		if (K <= 0)
+			return;
+
+		initLinkWorkspace(pGradInfo, alignedAnchors, edAnchors, ws);
+
+		std::vector<float> estimates;
+		estimateExtensions(ws, estimates, params);
+
+		std::vector<int> seeds;
+		orderSeeds(alignedAnchors, ws, SEED_BY_EXTRACTION, seeds);
+		std::stable_sort(seeds.begin(), seeds.end(), [&](int lhs, int rhs)->bool {
+			return estimates[lhs] > estimates[rhs]; });
+
+		// min-heap of lengths of the current K longest segments
+		std::priority_queue<float, std::vector<float>, std::greater<float>> topLengths;
+
+		// short or weak segments are not needed
+		LineSegList candidateSegments;
+
+		for (int groupInd : seeds)
+		{
+			float kthLength = topLengths.size() == K ? topLengths.top() : 0.0f;
+			float thresh = MAX(minLength, kthLength);
+
+			// estimates are descending, no remaining seed is expected to make the list
+			if (estimates[groupInd] < thresh)
+				break;
+
+			if (ws.groups.isLink[groupInd])
+				continue;
+
+			// linked as detect does, so groups are consumed or released the same way;
+			// a valid segment too short for the list keeps its groups, as in detect
+			LineSegment seg = linkAlignedAnchorGroup(
+				pGradInfo, ws, candidateSegments, groupInd, params);
+
+			if (seg == LineSegment() || seg.length() < thresh)
+				continue;
+
+			lineSegments.emplace_back(seg);
+			topLengths.push(seg.length());
+			if (topLengths.size() > K)
+				topLengths.pop();
+		}
+
+		std::stable_sort(lineSegments.begin(), lineSegments.end(),
+			[](LineSegment lhs, LineSegment rhs)->bool { return lhs.length() > rhs.length(); });
+
+		if (lineSegments.size() > K)
+			lineSegments.resize(K);
+
+		return;
+	}
+}
@@ -0,0 +1,129 @@
+#ifndef __SEEDING_HPP__
+#define __SEEDING_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include "utilities.hpp"
+#include "segments.hpp"
+#include "alignED.hpp"
+
+
+namespace AED
+{
+	// Order of seed groups for linking.
+	enum SeedOrder
+	{
+		SEED_BY_EXTRACTION = 0,	// anchor-extraction order
+		SEED_BY_STRENGTH,		// sum of the group's gradient magnitude, descending
+		SEED_BY_LENGTH			// estimated extension length, descending
+	};
+
+
+	/* @brief Budget of anytime detection. */
+	struct DetectBudget
+	{
+		// no seed is linked after the deadline.
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+		// stop after producing this number of segments, <= 0 means no limit.
+		int maxSegments = 0;
+
+		SeedOrder order = SEED_BY_STRENGTH;
+	};
+
+
+	/* @brief Estimate how far a group extends by probing pixels along its anchor-line.
+	* @param maxSteps: probing steps in each direction. */
+	extern
+	int estimateExtension(
+		const LinkWorkspace& ws,
+		int                  groupInd,
+		int                  maxSteps = 64
+	);
+
+
+	/* @brief Return all groups in the given order. */
+	extern
+	void orderSeeds(
+		const PixelList&     alignedAnchors,
+		const LinkWorkspace& ws,
+		SeedOrder            order,
+		std::vector<int>&    seeds
+	);
+
+
+	/* @brief Anytime detection, the budget is checked between seeds.
+	* @param truncated: true if some seeds are not linked because of the budget. */
+	extern
+	void detectAnytime(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		const DetectBudget& budget,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		bool&               truncated,
+		const LinkParams&   params = LinkParams()
+	);
+
+
+	/* @brief Anytime detection on a kept workspace, reused across frames of the same size. */
+	extern
+	void detectAnytime(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		LinkWorkspace&      ws,
+		const DetectBudget& budget,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		bool&               truncated,
+		const LinkParams&   params = LinkParams()
+	);
+
+
+	/* @brief Estimated extension length of groups, from a coarse anchor-occupancy grid.
+	A heuristic, not an upper bound: it marches along the seed's anchor-line, while the walker
+	refits the line and may turn away from it. The crossable gap follows params.remainSteps. */
+	extern
+	void estimateExtensions(
+		const LinkWorkspace& ws,
+		std::vector<float>&  estimates,
+		const LinkParams&    params = LinkParams(),
+		int                  cellSize = 8
+	);
+
+
+	/* @brief Detect the K longest line segments, no shorter than minLength.
+	Seeds are linked in descending order of their estimated length, and linking stops once
+	no remaining estimate beats the current K-th length. The estimate is a heuristic, so the
+	result is approximate: a segment of the exact top K may be missed if its seed underestimates it. */
+	extern
+	void detectTopK(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		int                 K,
+		float               minLength,
+		LineSegList&        lineSegments,
+		const LinkParams&   params = LinkParams()
+	);
+
+
+	/* @brief Top-K detection on a kept workspace, reused across frames of the same size. */
+	extern
+	void detectTopK(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		LinkWorkspace&      ws,
+		int                 K,
+		float               minLength,
+		LineSegList&        lineSegments,
+		const LinkParams&   params = LinkParams()
+	);
+}
+
+
+#endif // !__SEEDING_HPP__
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <opencv2/opencv.hpp>
+#include "imageview.hpp"
 
 
 // Image Pixel
@@ -46,6 +47,12 @@ public:
 			int(x) < src.cols && int(y) < src.rows;
 	}
 
+	template <typename T>
+	bool isInMatrix(const ImageView<T>& view) const
+	{
+		return view.contains(int(x), int(y));
+	}
+
 	/* @brief Convert to cv::Point. */
 	inline
 	cv::Point point() const
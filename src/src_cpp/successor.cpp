@@ -0,0 +1,128 @@
+#include "successor.hpp"
+
+
+namespace AED
+{
+	const int SECTOR_DX[NUM_SECTORS][3] = {
+		{ 1, 1, 1 }, { 0, 1, 1 }, { -1, 0, 1 }, { -1, -1, 0 },
+		{ -1, -1, -1 }, { 0, -1, -1 }, { -1, 0, 1 }, { 1, 1, 0 }
+	};
+
+	const int SECTOR_DY[NUM_SECTORS][3] = {
+		{ -1, 0, 1 }, { 1, 1, 0 }, { 1, 1, 1 }, { 0, 1, 1 },
+		{ -1, 0, 1 }, { -1, -1, 0 }, { -1, -1, -1 }, { 0, -1, -1 }
+	};
+
+
+	/* @brief Bin of lineAngle(line, true) without atan:
+	0: [-90.0, -67.5), 1: [-67.5, -22.5), 2: [-22.5, 22.5), 3: [22.5, 67.5), 4: others. */
+	static int orientationBin(const cv::Vec4f& line)
+	{
+		const float TAN_22_5 = 0.41421356f;
+		const float TAN_67_5 = 2.41421356f;
+
+		float slope = line[1] / line[0];
+		if (slope < -TAN_67_5)
+			return 0;
+		if (slope < -TAN_22_5)
+			return 1;
+		if (slope < TAN_22_5)
+			return 2;
+		if (slope < TAN_67_5)
+			return 3;
+
+		return 4;	// vertical, also for NaN
+	}
+
+
+	/* @brief Sector of the next step along the line, updates reverseFlag like walkToNextPixel. */
+	int walkSector(
+		const cv::Vec4f& prevLine,
+		const cv::Vec4f& line,
+		bool             posDir,
+		bool&            reverseFlag
+	)
+	{
+		int prevBin = orientationBin(prevLine);
+		int lineBin = orientationBin(line);
+
+		if ((prevBin == 0 && lineBin == 1) || (prevBin == 1 && lineBin == 0))
+			reverseFlag = true;
+
+		switch (lineBin)
+		{
+		case 1:	// -45-diagonal
+			return posDir != reverseFlag ? SECTOR_NE : SECTOR_SW;
+		case 2:	// horizontal
+			return posDir ? SECTOR_E : SECTOR_W;
+		case 3:	// 45-diagonal
+			return posDir ? SECTOR_SE : SECTOR_NW;
+		default: // vertical
+			return posDir != reverseFlag ? SECTOR_S : SECTOR_N;
+		}
+	}
+
+
+	/* @brief Precompute the strongest successor of every pixel in all 8 sectors. */
+	void calcSuccessorMap(
+		GradientInfo*   pGradInfo,
+		const cv::Rect& roi
+	)
+	{
+		const cv::Mat& mag = pGradInfo->mag;
+		cv::Mat& successors = pGradInfo->successors;
+
+		cv::Rect imageRect(0, 0, mag.cols, mag.rows);
+		cv::Rect region(imageRect);
+		if (roi.area() > 0 && successors.size() == mag.size() && successors.type() == CV_16UC1)
+			region = cv::Rect(roi.x - 1, roi.y - 1, roi.width + 2, roi.height + 2) & imageRect;
+		else
+			successors.create(mag.size(), CV_16UC1);
+
+		if (region.area() == 0)
+			return;
+
+		// magnitudes of the region and its 1-pixel ring, zero outside the image is never selected
+		cv::Rect outer = cv::Rect(region.x - 1, region.y - 1, region.width + 2, region.height + 2) & imageRect;
+		cv::Mat padded(region.height + 2, region.width + 2, CV_32FC1, cv::Scalar(0));
+		cv::Mat dst = padded(cv::Rect(outer.x - region.x + 1, outer.y - region.y + 1, outer.width, outer.height));
+		mag(outer).copyTo(dst);
+
+		cv::parallel_for_(cv::Range(0, region.height), [&](const cv::Range& range) {
+			for (int y = range.start; y != range.end; ++y)
+			{
+				// rows above, at and below the pixel, column 0 is the left border
+				const float* rows[3] = { padded.ptr<float>(y), padded.ptr<float>(y + 1), padded.ptr<float>(y + 2) };
+				uint16_t* codes = successors.ptr<uint16_t>(region.y + y) + region.x;
+
+				for (int x = 0; x != region.width; ++x)
+					codes[x] = 0;
+
+				// same selection as walkToNextPixel, branch-free so the loop vectorizes
+				for (int sector = 0; sector != NUM_SECTORS; ++sector)
+				{
+					const float* cand0 = rows[SECTOR_DY[sector][0] + 1] + 1 + SECTOR_DX[sector][0];
+					const float* cand1 = rows[SECTOR_DY[sector][1] + 1] + 1 + SECTOR_DX[sector][1];
+					const float* cand2 = rows[SECTOR_DY[sector][2] + 1] + 1 + SECTOR_DX[sector][2];
+					const int shift = 2 * sector;
+
+					for (int x = 0; x != region.width; ++x)
+					{
+						bool isGreater = cand0[x] > FLT_MIN;
+						float best = isGreater ? cand0[x] : FLT_MIN;
+						int code = isGreater ? 0 : SUCCESSOR_NONE;
+
+						isGreater = cand1[x] > best;
+						best = isGreater ? cand1[x] : best;
+						code = isGreater ? 1 : code;
+
+						code = cand2[x] > best ? 2 : code;
+						codes[x] |= uint16_t(code << shift);
+					}
+				}
+			}
+		});
+
+		return;
+	}
+}
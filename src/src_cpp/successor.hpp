@@ -0,0 +1,72 @@
+#ifndef __SUCCESSOR_HPP__
+#define __SUCCESSOR_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+#include "segments.hpp"
+
+
+namespace AED
+{
+	/* Walking sectors, by direction of the middle candidate in image coordinates (y down).
+	Each sector has 3 candidate neighbours, the strongest one is the successor. */
+	enum WalkSector
+	{
+		SECTOR_E = 0,
+		SECTOR_SE,
+		SECTOR_S,
+		SECTOR_SW,
+		SECTOR_W,
+		SECTOR_NW,
+		SECTOR_N,
+		SECTOR_NE,
+		NUM_SECTORS
+	};
+
+	// candidate offsets of each sector, in selection order (the first wins ties)
+	extern const int SECTOR_DX[NUM_SECTORS][3];
+	extern const int SECTOR_DY[NUM_SECTORS][3];
+
+	// code of a sector in the successor map: 0..2 candidate index, no successor otherwise
+	constexpr int SUCCESSOR_NONE = 3;
+
+
+	/* @brief Sector of the next step along the line, updates reverseFlag like walkToNextPixel. */
+	extern
+	int walkSector(
+		const cv::Vec4f& prevLine,
+		const cv::Vec4f& line,
+		bool             posDir,
+		bool&            reverseFlag
+	);
+
+
+	/* @brief Successor code of a pixel in a sector. */
+	inline
+	int successorCode(const cv::Mat& successors, int x, int y, int sector)
+	{
+		return successors.ptr<uint16_t>(y)[x] >> (2 * sector) & 3;
+	}
+
+	inline
+	int successorCode(const ImageView<const uint16_t>& successors, int x, int y, int sector)
+	{
+		return successors(x, y) >> (2 * sector) & 3;
+	}
+
+
+	/* @brief Precompute the strongest successor of every pixel in all 8 sectors.
+	pGradInfo->successors becomes CV_16UC1 of 2-bit codes, sector s in bits 2s and 2s+1.
+	Walking then reads one code instead of comparing 3 magnitudes. Only pixels whose
+	neighbourhood intersects roi are recomputed if roi is given and the map exists,
+	call it after updating magnitudes in place. */
+	extern
+	void calcSuccessorMap(
+		GradientInfo*   pGradInfo,
+		const cv::Rect& roi = cv::Rect()
+	);
+}
+
+
+#endif // !__SUCCESSOR_HPP__
@@ -0,0 +1,197 @@
+#include "sweep.hpp"
+#include <fstream>
+
+
+namespace AED
+{
+	/* @brief Expand the grid to settings, anchor-level parameters vary slowest. */
+	void expandSweepGrid(
+		const SweepGrid&           grid,
+		std::vector<SweepSetting>& settings
+	)
+	{
+		settings.clear();
+
+		SweepSetting setting;
+		for (int bins : grid.bins)
+		{
+			setting.bins = bins;
+			for (float anchorThresh : grid.anchorThresh)
+			{
+				setting.anchorThresh = anchorThresh;
+				for (float angleTolerance : grid.angleTolerance)
+				{
+					setting.angleTolerance = angleTolerance;
+					for (LinkEngineType engine : grid.engine)
+					{
+						setting.link.engine = engine;
+						for (bool useSuccessors : grid.useSuccessors)
+						{
+							setting.link.useSuccessors = useSuccessors;
+							for (int remainSteps : grid.remainSteps)
+							{
+								setting.link.remainSteps = remainSteps;
+								for (float anchorDensity : grid.anchorDensity)
+								{
+									setting.link.anchorDensity = anchorDensity;
+									for (float alignedDensity : grid.alignedDensity)
+									{
+										setting.link.alignedDensity = alignedDensity;
+										settings.push_back(setting);
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief Run every setting on an image whose gradient is computed once. */
+	void sweepImage(
+		const GradientInfo*              pGradInfo,
+		const std::vector<SweepSetting>& settings,
+		const LineSegList*               gtSegments,
+		const AccuracyParams&            accParams,
+		std::vector<SweepRow>&           rows,
+		SweepStats&                      stats
+	)
+	{
+		if (rows.size() != settings.size())
+		{
+			rows.assign(settings.size(), SweepRow());
+			for (size_t i = 0; i != settings.size(); ++i)
+				rows[i].setting = settings[i];
+		}
+
+		// ED anchors do not depend on any swept parameter
+		PixelList edAnchors;
+		NMS(pGradInfo, edAnchors);
+
+		// cached stages, valid for the parameters of previous setting
+		std::vector<PixelLinkList> pxLists;
+		PixelList alignedAnchors;
+		LinkWorkspace ws;
+		std::vector<uint8_t> initIsLink;
+		const SweepSetting* prev = nullptr;
+
+		LineSegList lineSegments, candidateSegments;
+
+		for (size_t i = 0; i != settings.size(); ++i)
+		{
+			const auto& setting = settings[i];
+
+			bool isSortStale = prev == nullptr || prev->bins != setting.bins;
+			bool isAnchorStale = isSortStale ||
+				prev->anchorThresh != setting.anchorThresh ||
+				prev->angleTolerance != setting.angleTolerance;
+
+			int64 t0 = cv::getTickCount();
+			if (isSortStale)
+			{
+				AED::pseudoSort<float>(pGradInfo->mag, pxLists, setting.bins);
+				++stats.numSorts;
+			}
+
+			int64 t1 = cv::getTickCount();
+			if (isAnchorStale)
+			{
+				alignedAnchors.clear();
+				AED::extractAlignedAnchors(pGradInfo, pxLists, alignedAnchors,
+					setting.anchorThresh, setting.angleTolerance);
+				initLinkWorkspace(pGradInfo, alignedAnchors, edAnchors, ws);
+				initIsLink = ws.groups.isLink;
+				++stats.numAnchors;
+			}
+
+			// linking changes link status only, labels and anchor-lines are reused
+			int64 t2 = cv::getTickCount();
+			ws.groups.isLink = initIsLink;
+			ws.arena.reset();
+			ws.view.successors = setting.link.useSuccessors ?
+				ImageView<const uint16_t>(pGradInfo->successors) : ImageView<const uint16_t>();
+
+			lineSegments.clear();
+			candidateSegments.clear();
+			linkGroups(pGradInfo, ws, lineSegments, candidateSegments, setting.link);
+			++stats.numLinks;
+
+			int64 t3 = cv::getTickCount();
+			double freq = cv::getTickFrequency() / 1000.0;
+			stats.sortMs += (t1 - t0) / freq;
+			stats.anchorMs += (t2 - t1) / freq;
+			stats.linkMs += (t3 - t2) / freq;
+
+			auto& row = rows[i];
+			++row.numImages;
+			row.numSegments += lineSegments.size();
+			row.linkMs += (t3 - t2) / freq;
+			for (auto& seg : lineSegments)
+				row.totalLength += seg.length();
+
+			if (gtSegments != nullptr)
+				accumulateAccuracy(*gtSegments, lineSegments, std::vector<float>(), accParams, row.counts);
+
+			prev = &setting;
+		}
+
+		return;
+	}
+
+
+	/* @brief Write one CSV line per setting. */
+	bool writeSweepTable(
+		const std::string&           filepath,
+		const std::vector<SweepRow>& rows,
+		const AccuracyParams&        accParams
+	)
+	{
+		std::ofstream ofs(filepath, std::ios::out | std::ios::trunc);
+		if (!ofs.is_open())
+		{
+			std::cerr << "Opening " << filepath << " failed." << std::endl;
+			return false;
+		}
+
+		bool hasAccuracy = !rows.empty() && !rows[0].counts.tpPred.empty();
+
+		ofs << "bins,anchor_thresh,angle_tolerance,engine,successors,remain_steps,anchor_density,aligned_density,"
+			<< "images,segments,mean_length,link_ms";
+		if (hasAccuracy)
+		{
+			for (float t : accParams.pixelThresh)
+				ofs << ",P" << t << ",R" << t << ",F" << t;
+			for (float t : accParams.sapThresh)
+				ofs << ",sAP" << t;
+		}
+		ofs << '\n';
+
+		for (const auto& row : rows)
+		{
+			const auto& setting = row.setting;
+			ofs << setting.bins << ',' << setting.anchorThresh << ',' << setting.angleTolerance << ','
+				<< linkEngineName(setting.link.engine) << ',' << setting.link.useSuccessors << ','
+				<< setting.link.remainSteps << ',' << setting.link.anchorDensity << ','
+				<< setting.link.alignedDensity << ',' << row.numImages << ',' << row.numSegments << ','
+				<< (row.numSegments ? row.totalLength / row.numSegments : 0.0) << ',' << row.linkMs;
+
+			if (hasAccuracy)
+			{
+				AccuracyResult result;
+				computeAccuracy(row.counts, result);
+
+				for (size_t k = 0; k != result.precision.size(); ++k)
+					ofs << ',' << result.precision[k] << ',' << result.recall[k] << ',' << result.fscore[k];
+				for (double ap : result.sAP)
+					ofs << ',' << ap;
+			}
+			ofs << '\n';
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,97 @@
+#ifndef __SWEEP_HPP__
+#define __SWEEP_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+#include "segments.hpp"
+#include "alignED.hpp"
+#include "evaluate.hpp"
+
+
+namespace AED
+{
+	/* @brief Values of each parameter, every combination is a setting. */
+	struct SweepGrid
+	{
+		// anchor-level
+		std::vector<int>            bins = { 1024 };
+		std::vector<float>          anchorThresh = { 3.0f };
+		std::vector<float>          angleTolerance = { 22.5f };
+
+		// link-level
+		std::vector<LinkEngineType> engine = { LINK_WALK };
+		std::vector<bool>           useSuccessors = { false };
+		std::vector<int>            remainSteps = { 7 };
+		std::vector<float>          anchorDensity = { 0.5f };
+		std::vector<float>          alignedDensity = { 0.9f };
+	};
+
+
+	/* @brief A combination of parameters. */
+	struct SweepSetting
+	{
+		int        bins = 1024;
+		float      anchorThresh = 3.0f;
+		float      angleTolerance = 22.5f;
+		LinkParams link;
+	};
+
+
+	/* @brief Results of a setting, summed over images. */
+	struct SweepRow
+	{
+		SweepSetting   setting;
+		int            numImages = 0;
+		size_t         numSegments = 0;
+		double         totalLength = 0.0;
+		double         linkMs = 0.0;
+		AccuracyCounts counts;	// empty without ground truth
+	};
+
+
+	/* @brief Time of each stage, and how many times it runs. */
+	struct SweepStats
+	{
+		double sortMs = 0.0, anchorMs = 0.0, linkMs = 0.0;
+		int    numSorts = 0, numAnchors = 0, numLinks = 0;
+	};
+
+
+	/* @brief Expand the grid to settings, anchor-level parameters vary slowest,
+	so consecutive settings share pseudo-sort and anchors as long as possible. */
+	extern
+	void expandSweepGrid(
+		const SweepGrid&           grid,
+		std::vector<SweepSetting>& settings
+	);
+
+
+	/* @brief Run every setting on an image whose gradient is computed once.
+	Pseudo-sort is rerun only when bins change, anchors only when anchor-level parameters change,
+	otherwise only linking and validation are rerun. Settings with useSuccessors walk on the
+	successor map of pGradInfo, built by the caller, the other ones select on the fly.
+	* @param gtSegments: ground truth for accuracy, or nullptr.
+	* @param rows: one per setting, accumulated. */
+	extern
+	void sweepImage(
+		const GradientInfo*              pGradInfo,
+		const std::vector<SweepSetting>& settings,
+		const LineSegList*               gtSegments,
+		const AccuracyParams&            accParams,
+		std::vector<SweepRow>&           rows,
+		SweepStats&                      stats
+	);
+
+
+	/* @brief Write one CSV line per setting, with accuracy columns if rows have ground truth. */
+	extern
+	bool writeSweepTable(
+		const std::string&           filepath,
+		const std::vector<SweepRow>& rows,
+		const AccuracyParams&        accParams
+	);
+}
+
+
+#endif // !__SWEEP_HPP__
@@ -0,0 +1,474 @@
+#include "temporal.hpp"
+#include "successor.hpp"
+
+
+namespace AED
+{
+	/* @brief Return the tile's rectangle, clipped by the frame. */
+	static cv::Rect tileRect(
+		const TemporalState& state,
+		int                  tileInd
+	)
+	{
+		int tx = tileInd % state.tilesX;
+		int ty = tileInd / state.tilesX;
+
+		int x = tx * state.tileSize;
+		int y = ty * state.tileSize;
+
+		return cv::Rect(x, y,
+			MIN(state.tileSize, state.prevFrame.cols - x),
+			MIN(state.tileSize, state.prevFrame.rows - y));
+	}
+
+
+	/* @brief Return the index of tile which the pixel belongs to. */
+	static inline int tileIndex(
+		const TemporalState& state,
+		const Pixel&         px
+	)
+	{
+		return int(px.y) / state.tileSize * state.tilesX + int(px.x) / state.tileSize;
+	}
+
+
+	/* @brief Test if any pixel in the region differs more than threshold. */
+	static bool isRegionChanged(
+		const cv::Mat&  curr,
+		const cv::Mat&  prev,
+		const cv::Rect& rect,
+		int             diffThresh
+	)
+	{
+		for (int row = rect.y; row < rect.y + rect.height; ++row)
+		{
+			const uchar* ptr0 = curr.ptr<uchar>(row) + rect.x;
+			const uchar* ptr1 = prev.ptr<uchar>(row) + rect.x;
+
+			for (int col = 0; col != rect.width; ++col)
+			{
+				if (std::abs(int(ptr0[col]) - int(ptr1[col])) > diffThresh)
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+
+	/* @brief Merge dirty tiles in each tile-row to horizontal runs. */
+	static void dirtyRuns(
+		const TemporalState&     state,
+		const std::vector<bool>& dirty,
+		std::vector<cv::Rect>&   rects
+	)
+	{
+		rects.clear();
+
+		for (int ty = 0; ty != state.tilesY; ++ty)
+		{
+			int tx = 0;
+			while (tx < state.tilesX)
+			{
+				if (!dirty[ty * state.tilesX + tx])
+				{
+					++tx;
+					continue;
+				}
+
+				int begX = tx;
+				while (tx < state.tilesX && dirty[ty * state.tilesX + tx])
+					++tx;
+
+				cv::Rect beg = tileRect(state, ty * state.tilesX + begX);
+				cv::Rect end = tileRect(state, ty * state.tilesX + tx - 1);
+
+				rects.emplace_back(beg.x, beg.y, end.x + end.width - beg.x, beg.height);
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief Pseudo-sort the pixels inside the regions, same binning as pseudoSort. */
+	static void pseudoSortRegions(
+		const cv::Mat&               mag,
+		const std::vector<cv::Rect>& rects,
+		std::vector<PixelLinkList>&  pxLists,
+		int                          bins
+	)
+	{
+		pxLists.clear();
+		pxLists.resize(bins);
+
+		// max gradient magnitude is set to 255.
+		double binStep = 255.0 / bins;
+
+		const ImageView<const float> magView(mag);
+
+		for (const auto& rect : rects)
+		{
+			for (int row = rect.y; row < rect.y + rect.height; ++row)
+			{
+				const float* ptr = magView.row(row);
+
+				for (int col = rect.x; col < rect.x + rect.width; ++col)
+				{
+					const auto& val = ptr[col];
+
+					int binInd = val / binStep;
+					binInd = binInd >= bins ? bins - 1 : binInd;	// avoid out of range
+
+					pxLists[binInd].emplace_back(col, row, val);
+				}
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief Test if the segment only crosses clean tiles, mark crossed tiles to reseed if not. */
+	static bool isSegmentClean(
+		const TemporalState&     state,
+		const std::vector<bool>& dirty,
+		std::vector<bool>&       reseed,
+		const LineSegment&       seg
+	)
+	{
+		PixelList pixels;
+		bresenham(seg.begPx, seg.endPx, pixels);
+
+		bool isClean = true;
+		for (const auto& px : pixels)
+		{
+			if (px.isInMatrix(state.prevFrame) && dirty[tileIndex(state, px)])
+			{
+				isClean = false;
+				break;
+			}
+		}
+
+		if (!isClean)
+		{
+			for (const auto& px : pixels)
+			{
+				if (px.isInMatrix(state.prevFrame))
+					reseed[tileIndex(state, px)] = true;
+			}
+		}
+
+		return isClean;
+	}
+
+
+	/* @brief Set the groups lying on a kept segment to linked. */
+	static void claimGroups(
+		const LineSegment& seg,
+		LinkWorkspace&     ws
+	)
+	{
+		PixelList pixels;
+		bresenham(seg.begPx, seg.endPx, pixels);
+
+		for (const auto& px : pixels)
+		{
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					Pixel temp(px.x + dx, px.y + dy);
+					if (!temp.isInMatrix(ws.labels))
+						continue;
+
+					int groupInd = atPixel<int>(ws.labels, temp);
+					if (groupInd >= 0)
+						ws.groups.isLink[groupInd] = true;
+				}
+			}
+		}
+
+		return;
+	}
+
+
+	/* @brief Reset cached state, next frame will be fully detected. */
+	void resetTemporalState(
+		TemporalState& state
+	)
+	{
+		state.prevFrame.release();
+		state.blurred.release();
+		state.gradInfo = GradientInfo();
+
+		state.tileAligned.clear();
+		state.tileED.clear();
+		state.lineSegments.clear();
+		state.candidateSegments.clear();
+
+		state.tilesX = state.tilesY = 0;
+		state.numChanged = state.numDirty = state.numSeeds = 0;
+
+		return;
+	}
+
+
+	/* @brief Detect the whole frame, and fill the caches of all tiles. */
+	static bool detectFullFrame(
+		const cv::Mat&    frame,
+		TemporalState&    state,
+		const LinkParams& params
+	)
+	{
+		state.prevFrame = frame.clone();
+		state.tilesX = (frame.cols + state.tileSize - 1) / state.tileSize;
+		state.tilesY = (frame.rows + state.tileSize - 1) / state.tileSize;
+
+		cv::GaussianBlur(frame, state.blurred, cv::Size(5, 5), 1.0);
+
+		if (!calcGradInfo(state.blurred, &state.gradInfo))
+			return false;
+
+		std::vector<PixelLinkList> pxLists;
+		pseudoSort<float>(state.gradInfo.mag, pxLists, state.bins);
+
+		PixelList alignedAnchors, edAnchors;
+		extractAlignedAnchors(&state.gradInfo, pxLists, alignedAnchors,
+			state.anchorThresh, state.angleTolerance);
+		NMS(&state.gradInfo, edAnchors);
+
+		int numTiles = state.tilesX * state.tilesY;
+		state.tileAligned.assign(numTiles, PixelList());
+		state.tileED.assign(numTiles, PixelList());
+
+		for (size_t ind = 0; ind < alignedAnchors.size(); ind += 3)
+		{
+			auto& tile = state.tileAligned[tileIndex(state, alignedAnchors[ind + 1])];
+			tile.insert(tile.end(), alignedAnchors.begin() + ind, alignedAnchors.begin() + ind + 3);
+		}
+
+		for (const auto& px : edAnchors)
+			state.tileED[tileIndex(state, px)].emplace_back(px);
+
+		state.lineSegments.clear();
+		state.candidateSegments.clear();
+		detect(&state.gradInfo, alignedAnchors, edAnchors,
+			state.lineSegments, state.candidateSegments, params);
+
+		state.numChanged = state.numDirty = numTiles;
+		state.numSeeds = alignedAnchors.size() / 3;
+
+		return true;
+	}
+
+
+	/* @brief Detect line segments from a grayscale video frame,
+	reusing results of unchanged tiles in previous frame.
+	Pixel changes below the threshold are ignored, so static regions keep the
+	results of the frame where they were last recomputed. */
+	bool detectTemporal(
+		const cv::Mat&    frame,
+		TemporalState&    state,
+		LineSegList&      lineSegments,
+		LineSegList&      candidateSegments,
+		const LinkParams& params
+	)
+	{
+		if (frame.empty() || frame.type() != CV_8UC1 || state.tileSize < 8)
+			return false;
+
+		// first frame, or the frame size changed
+		if (state.prevFrame.empty() || state.prevFrame.size() != frame.size())
+		{
+			if (!detectFullFrame(frame, state, params))
+				return false;
+
+			lineSegments = state.lineSegments;
+			candidateSegments = state.candidateSegments;
+			return true;
+		}
+
+		int numTiles = state.tilesX * state.tilesY;
+
+		// 1. Find the changed tiles
+		std::vector<bool> changed(numTiles, false);
+		state.numChanged = 0;
+		for (int tileInd = 0; tileInd != numTiles; ++tileInd)
+		{
+			changed[tileInd] = isRegionChanged(frame, state.prevFrame,
+				tileRect(state, tileInd), state.diffThresh);
+			state.numChanged += changed[tileInd];
+		}
+
+		if (state.numChanged == 0)
+		{
+			state.numDirty = state.numSeeds = 0;
+
+			lineSegments = state.lineSegments;
+			candidateSegments = state.candidateSegments;
+			return true;
+		}
+
+		// 2. Dilate changed tiles by one tile, blur, gradient and anchors of
+		// tiles out of the dirty region are not affected by the changes.
+		std::vector<bool> dirty(numTiles, false);
+		state.numDirty = 0;
+		for (int tileInd = 0; tileInd != numTiles; ++tileInd)
+		{
+			int tx = tileInd % state.tilesX;
+			int ty = tileInd / state.tilesX;
+
+			for (int dy = -1; dy <= 1 && !dirty[tileInd]; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					int nx = tx + dx, ny = ty + dy;
+					if (nx >= 0 && ny >= 0 && nx < state.tilesX && ny < state.tilesY &&
+						changed[ny * state.tilesX + nx])
+					{
+						dirty[tileInd] = true;
+						break;
+					}
+				}
+			}
+			state.numDirty += dirty[tileInd];
+		}
+
+		std::vector<cv::Rect> rects;
+		dirtyRuns(state, dirty, rects);
+
+		// 3. Recompute blur of dirty tiles, filters on ROI read the real neighbors.
+		for (const auto& rect : rects)
+		{
+			cv::Mat roi = state.blurred(rect);
+			cv::GaussianBlur(frame(rect), roi, cv::Size(5, 5), 1.0);
+		}
+
+		// 4. Recompute gradient of dirty tiles.
+		for (const auto& rect : rects)
+		{
+			GradientInfo tileGrad;
+			if (!calcGradInfo(state.blurred(rect), &tileGrad))
+				return false;
+
+			cv::Mat roi = state.gradInfo.gradx(rect);
+			tileGrad.gradx.copyTo(roi);
+			roi = state.gradInfo.grady(rect);
+			tileGrad.grady.copyTo(roi);
+			roi = state.gradInfo.mag(rect);
+			tileGrad.mag.copyTo(roi);
+			roi = state.gradInfo.ori(rect);
+			tileGrad.ori.copyTo(roi);
+
+			// successors around the tile read the new magnitudes
+			if (!state.gradInfo.successors.empty())
+				calcSuccessorMap(&state.gradInfo, rect);
+		}
+
+		// 5. Re-extract anchors of dirty tiles, pixels of clean anchors stay used.
+		std::vector<bool> used(frame.rows * frame.cols, false);
+		for (int tileInd = 0; tileInd != numTiles; ++tileInd)
+		{
+			if (dirty[tileInd])
+			{
+				state.tileAligned[tileInd].clear();
+				state.tileED[tileInd].clear();
+				continue;
+			}
+
+			for (const auto& px : state.tileAligned[tileInd])
+				used[int(px.x) + int(px.y) * frame.cols] = true;
+		}
+
+		std::vector<PixelLinkList> pxLists;
+		pseudoSortRegions(state.gradInfo.mag, rects, pxLists, state.bins);
+
+		PixelList dirtyAligned, dirtyED;
+		extractAlignedAnchors(&state.gradInfo, pxLists, used, dirtyAligned,
+			state.anchorThresh, state.angleTolerance);
+
+		for (size_t ind = 0; ind < dirtyAligned.size(); ind += 3)
+		{
+			auto& tile = state.tileAligned[tileIndex(state, dirtyAligned[ind + 1])];
+			tile.insert(tile.end(), dirtyAligned.begin() + ind, dirtyAligned.begin() + ind + 3);
+		}
+
+		for (const auto& rect : rects)
+			NMS(&state.gradInfo, rect, dirtyED);
+
+		for (const auto& px : dirtyED)
+			state.tileED[tileIndex(state, px)].emplace_back(px);
+
+		PixelList alignedAnchors, edAnchors;
+		std::vector<int> groupTiles;
+		for (int tileInd = 0; tileInd != numTiles; ++tileInd)
+		{
+			const auto& tile = state.tileAligned[tileInd];
+			alignedAnchors.insert(alignedAnchors.end(), tile.begin(), tile.end());
+			groupTiles.insert(groupTiles.end(), tile.size() / 3, tileInd);
+
+			edAnchors.insert(edAnchors.end(), state.tileED[tileInd].begin(), state.tileED[tileInd].end());
+		}
+
+		// 6. Keep segments only crossing clean tiles, other ones are re-linked.
+		std::vector<bool> reseed(dirty);
+		LineSegList keptSegments, keptCandidates;
+
+		for (const auto& seg : state.lineSegments)
+		{
+			if (isSegmentClean(state, dirty, reseed, seg))
+				keptSegments.emplace_back(seg);
+		}
+
+		for (const auto& seg : state.candidateSegments)
+		{
+			if (isSegmentClean(state, dirty, reseed, seg))
+				keptCandidates.emplace_back(seg);
+		}
+
+		LinkWorkspace& ws = state.ws;
+		initLinkWorkspace(&state.gradInfo, alignedAnchors, edAnchors, ws);
+
+		for (const auto& seg : keptSegments)
+			claimGroups(seg, ws);
+
+		for (const auto& seg : keptCandidates)
+			claimGroups(seg, ws);
+
+		// seeds in dirty or re-seeding tiles, the strongest first like full detection
+		std::vector<int> seeds;
+		for (int groupInd = 0; groupInd != groupTiles.size(); ++groupInd)
+		{
+			if (reseed[groupTiles[groupInd]] && !ws.groups.isLink[groupInd])
+				seeds.push_back(groupInd);
+		}
+
+		std::stable_sort(seeds.begin(), seeds.end(), [&](int lhs, int rhs)->bool {
+			return ws.groups.strength[lhs] > ws.groups.strength[rhs]; });
+
+		state.numSeeds = seeds.size();
+
+		linkSeeds(&state.gradInfo, ws, seeds, keptSegments, keptCandidates, params);
+
+		state.lineSegments.swap(keptSegments);
+		state.candidateSegments.swap(keptCandidates);
+
+		// 7. Update reference frame only on changed tiles, so slow drifts accumulate
+		// until they exceed the threshold.
+		for (int tileInd = 0; tileInd != numTiles; ++tileInd)
+		{
+			if (!changed[tileInd])
+				continue;
+
+			cv::Rect rect = tileRect(state, tileInd);
+			cv::Mat roi = state.prevFrame(rect);
+			frame(rect).copyTo(roi);
+		}
+
+		lineSegments = state.lineSegments;
+		candidateSegments = state.candidateSegments;
+
+		return true;
+	}
+}
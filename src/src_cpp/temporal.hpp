@@ -0,0 +1,76 @@
+#ifndef __TEMPORAL_HPP__
+#define __TEMPORAL_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+#include "segments.hpp"
+#include "alignED.hpp"
+
+
+namespace AED
+{
+	/* @brief Cached state of fixed-camera video detection.
+	Frames are split to tiles, only the tiles changed since previous frame
+	(and their neighbors) recompute blur, gradient and anchors. */
+	struct TemporalState
+	{
+		// tile side length in pixel, should be much greater than the filter's radius.
+		int tileSize = 64;
+
+		// a tile is changed if any pixel differs more than this threshold.
+		int diffThresh = 8;
+
+		// parameters of the pipeline
+		int   bins = 1024;
+		float anchorThresh = 3.0f;
+		float angleTolerance = 22.5f;
+
+		// tiles layout
+		int tilesX = 0;
+		int tilesY = 0;
+
+		// cached data of previous frame
+		cv::Mat      prevFrame;
+		cv::Mat      blurred;
+		GradientInfo gradInfo;
+
+		// aligned anchors and ED anchors owned by each tile (by the middle pixel)
+		std::vector<PixelList> tileAligned;
+		std::vector<PixelList> tileED;
+
+		// detection results of previous frame
+		LineSegList lineSegments;
+		LineSegList candidateSegments;
+
+		// linking buffers, reused across frames
+		LinkWorkspace ws;
+
+		// statistics of the last frame
+		int numChanged = 0;	// tiles whose pixels changed
+		int numDirty = 0;	// tiles recomputed, i.e. changed tiles and their neighbors
+		int numSeeds = 0;	// groups re-linked
+	};
+
+
+	/* @brief Reset cached state, next frame will be fully detected. */
+	extern
+	void resetTemporalState(
+		TemporalState& state
+	);
+
+
+	/* @brief Detect line segments from a grayscale video frame,
+	reusing results of unchanged tiles in previous frame. */
+	extern
+	bool detectTemporal(
+		const cv::Mat&    frame,
+		TemporalState&    state,
+		LineSegList&      lineSegments,
+		LineSegList&      candidateSegments,
+		const LinkParams& params = LinkParams()
+	);
+}
+
+
+#endif // !__TEMPORAL_HPP__
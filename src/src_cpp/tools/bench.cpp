@@ -0,0 +1,914 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "utilities.hpp"
+#include "alignED.hpp"
+#include "temporal.hpp"
+#include "tracking.hpp"
+#include "seeding.hpp"
+#include "hierarchical.hpp"
+#include "successor.hpp"
+#include "anchormask.hpp"
+#include "arena.hpp"
+#include "gradpolicy.hpp"
+
+
+// Heap allocations through operator new, counted for the arena case.
+// OpenCV buffers use their own allocator and are not counted.
+static std::atomic<size_t> g_numNew(0);
+
+void* operator new(size_t size)
+{
+	++g_numNew;
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+
+/* @brief Draw a synthetic scene of random lines and rectangles. */
+static cv::Mat syntheticScene(
+	const cv::Size& size,
+	int             numShapes,
+	uint64          seed
+)
+{
+	cv::RNG rng(seed);
+	cv::Mat scene(size, CV_8UC1, cv::Scalar(128));
+
+	for (int i = 0; i != numShapes; ++i)
+	{
+		cv::Point pt0(rng.uniform(0, size.width), rng.uniform(0, size.height));
+		cv::Point pt1(rng.uniform(0, size.width), rng.uniform(0, size.height));
+		cv::Scalar color(rng.uniform(0, 256));
+
+		if (i % 3 == 0)
+			cv::rectangle(scene, cv::Rect(pt0, pt1), color, 2);
+		else
+			cv::line(scene, pt0, pt1, color, 2);
+	}
+
+	return scene;
+}
+
+
+/* @brief Run the full pipeline on a grayscale frame. */
+static void detectFrame(
+	const cv::Mat& gray,
+	LineSegList&   lineSegments,
+	LineSegList&   candidateSegments
+)
+{
+	cv::Mat blurred;
+	cv::GaussianBlur(gray, blurred, cv::Size(5, 5), 1.0);
+
+	GradientInfo gradInfo;
+	calcGradInfo(blurred, &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+	PixelList anchors, anchorsED;
+	AED::extractAlignedAnchors(&gradInfo, pxLists, anchors);
+	NMS(&gradInfo, anchorsED);
+
+	lineSegments.clear();
+	candidateSegments.clear();
+	AED::detect(&gradInfo, anchors, anchorsED, lineSegments, candidateSegments);
+
+	return;
+}
+
+
+/* @brief Fixed-camera video: static scene with a moving textured object.
+Usage: video [width] [height] [frames] [moving-area-ratio] */
+static int benchVideo(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1280;
+	int height = argc > 1 ? std::stoi(argv[1]) : 720;
+	int frames = argc > 2 ? std::stoi(argv[2]) : 60;
+	double movingRatio = argc > 3 ? std::stod(argv[3]) : 0.05;
+
+	cv::Mat background = syntheticScene(cv::Size(width, height), 200, 7);
+	cv::Mat object = syntheticScene(cv::Size(
+		int(width * std::sqrt(movingRatio)), int(height * std::sqrt(movingRatio))), 10, 11);
+
+	// render all frames in advance
+	std::vector<cv::Mat> video(frames);
+	for (int i = 0; i != frames; ++i)
+	{
+		video[i] = background.clone();
+		int x = (3 * i) % (width - object.cols);
+		int y = (height - object.rows) / 2;
+		cv::Mat roi = video[i](cv::Rect(x, y, object.cols, object.rows));
+		object.copyTo(roi);
+	}
+
+	LineSegList lineSegments, candidateSegments;
+	size_t numFull = 0, numTemporal = 0;
+
+	cv::TickMeter tmFull;
+	tmFull.start();
+	for (const auto& frame : video)
+	{
+		detectFrame(frame, lineSegments, candidateSegments);
+		numFull += lineSegments.size();
+	}
+	tmFull.stop();
+
+	AED::TemporalState state;
+	double dirtyRatio = 0.0;
+
+	cv::TickMeter tmTemporal;
+	tmTemporal.start();
+	for (const auto& frame : video)
+	{
+		AED::detectTemporal(frame, state, lineSegments, candidateSegments);
+		numTemporal += lineSegments.size();
+		dirtyRatio += 1.0 * state.numDirty / (state.tilesX * state.tilesY);
+	}
+	tmTemporal.stop();
+
+	std::cout << "video " << width << "x" << height << ", " << frames
+		<< " frames, moving area " << movingRatio * 100 << "%\n"
+		<< "  full     : " << frames / tmFull.getTimeSec() << " fps, "
+		<< 1.0 * numFull / frames << " segments/frame\n"
+		<< "  temporal : " << frames / tmTemporal.getTimeSec() << " fps, "
+		<< 1.0 * numTemporal / frames << " segments/frame, "
+		<< 100.0 * dirtyRatio / frames << "% tiles recomputed\n";
+
+	return 0;
+}
+
+
+/* @brief Moving-camera video: a panning window over a large synthetic scene.
+Usage: tracking [width] [height] [frames] [pixels-per-frame] */
+static int benchTracking(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1280;
+	int height = argc > 1 ? std::stoi(argv[1]) : 720;
+	int frames = argc > 2 ? std::stoi(argv[2]) : 60;
+	int speed = argc > 3 ? std::stoi(argv[3]) : 2;
+
+	cv::Mat scene = syntheticScene(cv::Size(width + speed * frames, height), 250, 13);
+
+	LineSegList lineSegments, candidateSegments;
+	size_t numFull = 0, numTracked = 0, numNewSeeds = 0, numGroups = 0;
+	double secFull = 0.0, secTracked = 0.0;
+
+	AED::TrackingState state;
+
+	// camera pans to the right, so the content moves to the left
+	cv::Mat H = (cv::Mat_<double>(3, 3) << 1, 0, -speed, 0, 1, 0, 0, 0, 1);
+
+	for (int i = 0; i != frames; ++i)
+	{
+		cv::Mat frame = scene(cv::Rect(speed * i, 0, width, height));
+
+		// shared stages
+		cv::Mat blurred;
+		cv::GaussianBlur(frame, blurred, cv::Size(5, 5), 1.0);
+
+		GradientInfo gradInfo;
+		calcGradInfo(blurred, &gradInfo);
+
+		std::vector<PixelLinkList> pxLists;
+		AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+		PixelList anchors, anchorsED;
+		AED::extractAlignedAnchors(&gradInfo, pxLists, anchors);
+		NMS(&gradInfo, anchorsED);
+		numGroups += anchors.size() / 3;
+
+		// linking only
+		cv::TickMeter tm;
+		tm.start();
+		lineSegments.clear(), candidateSegments.clear();
+		AED::detect(&gradInfo, anchors, anchorsED, lineSegments, candidateSegments);
+		tm.stop();
+		secFull += tm.getTimeSec();
+		numFull += lineSegments.size();
+
+		tm.reset();
+		tm.start();
+		lineSegments.clear(), candidateSegments.clear();
+		AED::detectTracked(&gradInfo, anchors, anchorsED, state, 
+			i == 0 ? cv::Mat() : H, lineSegments, candidateSegments);
+		tm.stop();
+		secTracked += tm.getTimeSec();
+		numTracked += lineSegments.size();
+		numNewSeeds += state.numNewSeeds;
+	}
+
+	std::cout << "tracking " << width << "x" << height << ", " << frames
+		<< " frames, " << speed << " px/frame, " << 1.0 * numGroups / frames << " groups/frame\n"
+		<< "  full    : " << 1000.0 * secFull / frames << " ms/frame linking, "
+		<< 1.0 * numFull / frames << " segments/frame\n"
+		<< "  tracked : " << 1000.0 * secTracked / frames << " ms/frame linking, "
+		<< 1.0 * numTracked / frames << " segments/frame, "
+		<< 1.0 * numNewSeeds / frames << " new seeds/frame\n";
+
+	return 0;
+}
+
+
+/* @brief Sum of segments' length. */
+static double totalLength(const LineSegList& segments)
+{
+	double length = 0.0;
+	for (auto seg : segments)
+		length += seg.length();
+
+	return length;
+}
+
+
+/* @brief Anytime detection under shrinking deadlines, compared with full linking.
+Usage: anytime [width] [height] */
+static int benchAnytime(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), 400, 17);
+
+	cv::Mat blurred;
+	cv::GaussianBlur(frame, blurred, cv::Size(5, 5), 1.0);
+
+	GradientInfo gradInfo;
+	calcGradInfo(blurred, &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+	PixelList anchors, anchorsED;
+	AED::extractAlignedAnchors(&gradInfo, pxLists, anchors);
+	NMS(&gradInfo, anchorsED);
+
+	LineSegList lineSegments, candidateSegments;
+
+	cv::TickMeter tm;
+	tm.start();
+	AED::detect(&gradInfo, anchors, anchorsED, lineSegments, candidateSegments);
+	tm.stop();
+
+	double fullMs = tm.getTimeMilli();
+	double fullLength = totalLength(lineSegments);
+
+	std::cout << "anytime " << width << "x" << height << ", full linking "
+		<< fullMs << " ms, " << lineSegments.size() << " segments\n";
+
+	const char* orderNames[] = { "extraction", "strength", "length" };
+	for (int order = AED::SEED_BY_EXTRACTION; order <= AED::SEED_BY_LENGTH; ++order)
+	{
+		for (double ratio : { 0.1, 0.25, 0.5 })
+		{
+			AED::DetectBudget budget;
+			budget.order = AED::SeedOrder(order);
+			budget.deadline = std::chrono::steady_clock::now() + 
+				std::chrono::microseconds(int64(1000.0 * ratio * fullMs));
+
+			bool truncated = false;
+			lineSegments.clear(), candidateSegments.clear();
+			AED::detectAnytime(&gradInfo, anchors, anchorsED, budget, 
+				lineSegments, candidateSegments, truncated);
+
+			std::cout << "  " << orderNames[order] << ", budget " << ratio * 100 << "%: "
+				<< lineSegments.size() << " segments, "
+				<< 100.0 * totalLength(lineSegments) / fullLength << "% of length"
+				<< (truncated ? ", truncated" : "") << "\n";
+		}
+	}
+
+	return 0;
+}
+
+
+/* @brief Top-K longest segments, compared with full linking plus sorting.
+Usage: topk [K] [min-length] [width] [height] */
+static int benchTopK(int argc, char** argv)
+{
+	int K = argc > 0 ? std::stoi(argv[0]) : 20;
+	float minLength = argc > 1 ? std::stof(argv[1]) : 20.0f;
+	int width = argc > 2 ? std::stoi(argv[2]) : 1920;
+	int height = argc > 3 ? std::stoi(argv[3]) : 1080;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), 400, 19);
+
+	cv::Mat blurred;
+	cv::GaussianBlur(frame, blurred, cv::Size(5, 5), 1.0);
+
+	GradientInfo gradInfo;
+	calcGradInfo(blurred, &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+	PixelList anchors, anchorsED;
+	AED::extractAlignedAnchors(&gradInfo, pxLists, anchors);
+	NMS(&gradInfo, anchorsED);
+
+	LineSegList fullSegments, candidateSegments, topSegments;
+
+	cv::TickMeter tmFull;
+	tmFull.start();
+	AED::detect(&gradInfo, anchors, anchorsED, fullSegments, candidateSegments);
+	std::stable_sort(fullSegments.begin(), fullSegments.end(),
+		[](LineSegment lhs, LineSegment rhs)->bool { return lhs.length() > rhs.length(); });
+	if (fullSegments.size() > K)
+		fullSegments.resize(K);
+	tmFull.stop();
+
+	cv::TickMeter tmTopK;
+	tmTopK.start();
+	AED::detectTopK(&gradInfo, anchors, anchorsED, K, minLength, topSegments);
+	tmTopK.stop();
+
+	std::cout << "topk K=" << K << ", min length " << minLength << ", "
+		<< width << "x" << height << "\n"
+		<< "  full + sort : " << tmFull.getTimeMilli() << " ms, total length "
+		<< totalLength(fullSegments) << "\n"
+		<< "  detectTopK  : " << tmTopK.getTimeMilli() << " ms, total length "
+		<< totalLength(topSegments) << "\n";
+
+	return 0;
+}
+
+
+/* @brief Aligned anchors from pseudoSort's lists vs. flat buckets vs. the candidate mask,
+same bins and range.
+Usage: anchors [width] [height] [bins] [mag-range] */
+static int benchAnchors(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+	int bins = argc > 2 ? std::stoi(argv[2]) : 1024;
+	double magRange = argc > 3 ? std::stod(argv[3]) : 512.0;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), 400, 23);
+
+	GradientInfo gradInfo;
+	calcGradInfo(makeImageView(frame), &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	PixelList listAnchors;
+
+	cv::TickMeter tmList;
+	tmList.start();
+	AED::pseudoSort<float>(gradInfo.mag, pxLists, bins, magRange);
+	AED::extractAlignedAnchors(&gradInfo, pxLists, listAnchors);
+	tmList.stop();
+
+	AED::HierarchicalAnchorDetector detector(&gradInfo);
+	detector.detect(bins, magRange);	// warm up buffers
+
+	cv::TickMeter tmFlat;
+	tmFlat.start();
+	detector.detect(bins, magRange);
+	tmFlat.stop();
+
+	AED::AnchorCandidateMask mask;
+	PixelList maskAnchors;
+	std::vector<bool> used(frame.rows * frame.cols, false);
+
+	cv::TickMeter tmMaskPass, tmMask;
+	tmMask.start();
+	tmMaskPass.start();
+	AED::calcAnchorCandidates(&gradInfo, mask);
+	tmMaskPass.stop();
+	AED::extractAlignedAnchors(&gradInfo, mask, used, maskAnchors, bins, magRange);
+	tmMask.stop();
+
+	auto isSameTriplets = [&](const PixelList& anchors)->bool {
+		return listAnchors.size() == anchors.size() &&
+			std::equal(listAnchors.begin(), listAnchors.end(), anchors.begin(),
+				[](const Pixel& lhs, const Pixel& rhs)->bool {
+					return lhs.x == rhs.x && lhs.y == rhs.y && lhs.val == rhs.val; });
+	};
+
+	const PixelList& flatAnchors = detector.alignedAnchors();
+	bool isSame = isSameTriplets(flatAnchors);
+	bool isSameMask = isSameTriplets(maskAnchors);
+
+	std::cout << "anchors " << width << "x" << height << ", " << bins << " bins, range " << magRange << "\n"
+		<< "  linked lists : " << tmList.getTimeMilli() << " ms, " << listAnchors.size() / 3 << " anchors\n"
+		<< "  flat buckets : " << tmFlat.getTimeMilli() << " ms, " << detector.numAnchors() << " anchors, "
+		<< (isSame ? "identical" : "DIFFERENT") << " triplets\n"
+		<< "  candidates   : " << tmMask.getTimeMilli() << " ms (mask pass " << tmMaskPass.getTimeMilli()
+		<< " ms), " << maskAnchors.size() / 3 << " anchors, " << (isSameMask ? "identical" : "DIFFERENT")
+		<< " triplets, " << 100.0 * mask.count() / (frame.rows * frame.cols) << "% pixels visited\n";
+
+	return isSame && isSameMask ? 0 : -1;
+}
+
+
+/* @brief Collinear merging after linking, counts and time.
+Usage: merge [width] [height] [max-gap] [angle-tolerance] */
+static int benchMerge(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+
+	AED::MergeParams params;
+	if (argc > 2)
+		params.maxGap = std::stof(argv[2]);
+	if (argc > 3)
+		params.angleTolerance = std::stof(argv[3]);
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), 400, 29);
+
+	LineSegList lineSegments, candidateSegments;
+	cv::TickMeter tmDetect;
+	tmDetect.start();
+	detectFrame(frame, lineSegments, candidateSegments);
+	tmDetect.stop();
+
+	GradientInfo gradInfo;
+	calcGradInfo(makeImageView(frame), &gradInfo);
+
+	AED::MergeStats stats;
+	AED::mergeCollinearSegments(&gradInfo, lineSegments, params, &stats);
+
+	std::cout << "merge " << width << "x" << height << ", max gap " << params.maxGap
+		<< ", angle tolerance " << params.angleTolerance << "\n"
+		<< "  detect : " << tmDetect.getTimeMilli() << " ms, " << stats.numInput << " segments\n"
+		<< "  merge  : " << stats.ms << " ms, " << stats.numOutput << " segments, "
+		<< stats.numMerged << " merges, " << stats.numRejected << " rejected by validation\n";
+
+	return 0;
+}
+
+
+/* @brief Sequential walking vs. graph linking vs. routing on a dense scene, same anchors.
+Usage: engines [width] [height] [shapes] [runs] */
+static int benchEngines(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+	int numShapes = argc > 2 ? std::stoi(argv[2]) : 1500;
+	int runs = argc > 3 ? std::stoi(argv[3]) : 5;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), numShapes, 31);
+
+	GradientInfo gradInfo;
+	calcGradInfo(makeImageView(frame), &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+	PixelList anchors, anchorsED;
+	AED::extractAlignedAnchors(&gradInfo, pxLists, anchors);
+	NMS(&gradInfo, anchorsED);
+
+	std::cout << "engines " << width << "x" << height << ", " << numShapes << " shapes, "
+		<< anchors.size() / 3 << " groups, " << runs << " runs\n";
+
+	for (auto engine : { AED::LINK_WALK, AED::LINK_GRAPH, AED::LINK_ROUTING })
+	{
+		AED::LinkParams params;
+		params.engine = engine;
+
+		LineSegList lineSegments, candidateSegments;
+		cv::TickMeter tm;
+		for (int run = 0; run != runs; ++run)
+		{
+			lineSegments.clear();
+			candidateSegments.clear();
+
+			tm.start();
+			AED::detect(&gradInfo, anchors, anchorsED, lineSegments, candidateSegments, params);
+			tm.stop();
+		}
+
+		std::cout << "  " << AED::linkEngineName(engine) << " : " << tm.getTimeMilli() / runs << " ms, "
+			<< lineSegments.size() << " segments, total length " << totalLength(lineSegments)
+			<< ", " << candidateSegments.size() << " candidates\n";
+	}
+
+	return 0;
+}
+
+
+/* @brief Walking with on-the-fly successor selection vs. the precomputed successor map.
+Usage: successors [width] [height] [shapes] [runs] */
+static int benchSuccessors(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+	int numShapes = argc > 2 ? std::stoi(argv[2]) : 1500;
+	int runs = argc > 3 ? std::stoi(argv[3]) : 5;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), numShapes, 37);
+
+	GradientInfo gradInfo;
+	calcGradInfo(makeImageView(frame), &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+	PixelList anchors, anchorsED;
+	AED::extractAlignedAnchors(&gradInfo, pxLists, anchors);
+	NMS(&gradInfo, anchorsED);
+
+	LineSegList lineSegments, candidateSegments;
+	cv::TickMeter tmFly, tmMap, tmBuild;
+	for (int run = 0; run != runs; ++run)
+	{
+		lineSegments.clear();
+		candidateSegments.clear();
+		tmFly.start();
+		AED::detect(&gradInfo, anchors, anchorsED, lineSegments, candidateSegments);
+		tmFly.stop();
+	}
+	size_t numFly = lineSegments.size();
+	double lengthFly = totalLength(lineSegments);
+
+	for (int run = 0; run != runs; ++run)
+	{
+		gradInfo.successors.release();
+		tmBuild.start();
+		AED::calcSuccessorMap(&gradInfo);
+		tmBuild.stop();
+
+		lineSegments.clear();
+		candidateSegments.clear();
+		tmMap.start();
+		AED::detect(&gradInfo, anchors, anchorsED, lineSegments, candidateSegments);
+		tmMap.stop();
+	}
+
+	double mapMB = gradInfo.successors.total() * gradInfo.successors.elemSize() / (1024.0 * 1024.0);
+	double magMB = gradInfo.mag.total() * gradInfo.mag.elemSize() / (1024.0 * 1024.0);
+
+	std::cout << "successors " << width << "x" << height << ", " << numShapes << " shapes, "
+		<< anchors.size() / 3 << " groups, " << runs << " runs\n"
+		<< "  on-the-fly : link " << tmFly.getTimeMilli() / runs << " ms, "
+		<< numFly << " segments, total length " << lengthFly << "\n"
+		<< "  map        : build " << tmBuild.getTimeMilli() / runs << " ms + link "
+		<< tmMap.getTimeMilli() / runs << " ms, " << lineSegments.size() << " segments, total length "
+		<< totalLength(lineSegments) << "\n"
+		<< "  memory     : map " << mapMB << " MB, magnitude " << magMB << " MB" << std::endl;
+
+	return 0;
+}
+
+
+/* @brief Scalar reference of NMS, one pixel at a time with branches. */
+static void scalarNMS(const GradientInfo& gradInfo, PixelList& anchorPixels)
+{
+	const cv::Mat& mag = gradInfo.mag;
+	auto magAt = [&](const cv::Point& pt)->float { return mag.ptr<float>(pt.y)[pt.x]; };
+	anchorPixels.clear();
+
+	for (int row = 1; row < mag.rows - 1; ++row)
+	{
+		for (int col = 1; col < mag.cols - 1; ++col)
+		{
+			float currGx = gradInfo.gradx.ptr<float>(row)[col];
+			float currGy = gradInfo.grady.ptr<float>(row)[col];
+			float currOri = gradInfo.ori.ptr<float>(row)[col];
+			cv::Point pt1, pt2, pt3, pt4;
+
+			if (currOri < 45.0)
+				pt1 = { col - 1, row - 1 }, pt3 = { col + 1, row + 1 }, pt2 = { col - 1, row }, pt4 = { col + 1, row };
+			else if (currOri >= 45.0 && currOri < 90.0)
+				pt1 = { col - 1, row - 1 }, pt3 = { col + 1, row + 1 }, pt2 = { col, row - 1 }, pt4 = { col, row + 1 };
+			else if (currOri >= 90.0 && currOri < 135.0)
+				pt1 = { col + 1, row - 1 }, pt3 = { col - 1, row + 1 }, pt2 = { col, row - 1 }, pt4 = { col, row + 1 };
+			else
+				pt1 = { col - 1, row + 1 }, pt3 = { col + 1, row - 1 }, pt2 = { col - 1, row }, pt4 = { col + 1, row };
+
+			float w = (currOri >= 45.0 && currOri < 135.0) ?
+				std::abs(currGx / currGy) : std::abs(currGy / currGx);
+
+			float temp1 = w * magAt(pt1) + (1 - w) * magAt(pt2);
+			float temp2 = w * magAt(pt3) + (1 - w) * magAt(pt4);
+
+			float currMag = mag.ptr<float>(row)[col];
+			if (currMag > temp1 && currMag > temp2)
+				anchorPixels.emplace_back(col, row, currMag);
+		}
+	}
+
+	return;
+}
+
+
+/* @brief Anchor kernels, scalar references vs. the row-parallel bitmap versions, in Gpx/s.
+Usage: kernels [width] [height] [runs] */
+static int benchKernels(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+	int runs = argc > 2 ? std::stoi(argv[2]) : 10;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), 1500, 41);
+
+	GradientInfo gradInfo;
+	calcGradInfo(makeImageView(frame), &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+	PixelList refNMS, fastNMS, refED, fastED;
+	AED::AnchorCandidateMask mask;
+	cv::TickMeter tmRefNMS, tmNMS, tmRefED, tmED;
+	for (int run = 0; run != runs; ++run)
+	{
+		tmRefNMS.start();
+		scalarNMS(gradInfo, refNMS);
+		tmRefNMS.stop();
+
+		tmNMS.start();
+		NMS(&gradInfo, fastNMS);
+		tmNMS.stop();
+
+		tmRefED.start();
+		AED::extractAnchorED(&gradInfo, pxLists, refED);
+		tmRefED.stop();
+
+		tmED.start();
+		AED::calcAnchorEDMask(&gradInfo, mask);
+		AED::extractAnchorED(&gradInfo, mask, fastED);
+		tmED.stop();
+	}
+
+	auto isSame = [](const PixelList& lhs, const PixelList& rhs)->bool {
+		return lhs.size() == rhs.size() &&
+			std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const Pixel& a, const Pixel& b)->bool {
+				return a.x == b.x && a.y == b.y && a.val == b.val; });
+	};
+	auto gpxPerSec = [&](const cv::TickMeter& tm)->double {
+		return 1e-6 * width * height * runs / tm.getTimeMilli();
+	};
+
+	bool isSameNMS = isSame(refNMS, fastNMS);
+	bool isSameED = isSame(refED, fastED);
+
+	std::cout << "kernels " << width << "x" << height << ", " << runs << " runs, "
+		<< cv::getNumThreads() << " threads\n"
+		<< "  NMS scalar     : " << gpxPerSec(tmRefNMS) << " Gpx/s, " << refNMS.size() << " anchors\n"
+		<< "  NMS bitmap     : " << gpxPerSec(tmNMS) << " Gpx/s, " << fastNMS.size() << " anchors, "
+		<< (isSameNMS ? "identical" : "DIFFERENT") << "\n"
+		<< "  ED lists       : " << gpxPerSec(tmRefED) << " Gpx/s (pseudo-sort excluded), "
+		<< refED.size() << " anchors\n"
+		<< "  ED bitmap      : " << gpxPerSec(tmED) << " Gpx/s, " << fastED.size() << " anchors, "
+		<< (isSameED ? "identical" : "DIFFERENT") << std::endl;
+
+	return isSameNMS && isSameED ? 0 : -1;
+}
+
+
+/* @brief Serial vs. tile-parallel aligned-anchor extraction over the candidate mask.
+Usage: tiles [width] [height] [tile-size] [runs] */
+static int benchTiles(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 5472;
+	int height = argc > 1 ? std::stoi(argv[1]) : 3648;
+	int tileSize = argc > 2 ? std::stoi(argv[2]) : 256;
+	int runs = argc > 3 ? std::stoi(argv[3]) : 5;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), width * height / 4000, 43);
+
+	GradientInfo gradInfo;
+	calcGradInfo(makeImageView(frame), &gradInfo);
+
+	AED::AnchorCandidateMask mask;
+	AED::calcAnchorCandidates(&gradInfo, mask);
+
+	PixelList serialAnchors, tiledAnchors;
+	size_t numDeferred = 0;
+	double replayMs = 0.0, sumReplayMs = 0.0;
+	cv::TickMeter tmSerial, tmTiled;
+	for (int run = 0; run != runs; ++run)
+	{
+		std::vector<bool> used(width * height, false);
+		serialAnchors.clear();
+		tmSerial.start();
+		AED::extractAlignedAnchors(&gradInfo, mask, used, serialAnchors);
+		tmSerial.stop();
+
+		used.assign(width * height, false);
+		tiledAnchors.clear();
+		tmTiled.start();
+		AED::extractAlignedAnchorsTiled(&gradInfo, mask, used, tiledAnchors, 1024, 255.0, 22.5f, tileSize,
+			&numDeferred, &replayMs);
+		tmTiled.stop();
+		sumReplayMs += replayMs;
+	}
+
+	bool isSame = serialAnchors.size() == tiledAnchors.size() &&
+		std::equal(serialAnchors.begin(), serialAnchors.end(), tiledAnchors.begin(),
+			[](const Pixel& lhs, const Pixel& rhs)->bool {
+				return lhs.x == rhs.x && lhs.y == rhs.y && lhs.val == rhs.val; });
+
+	std::cout << "tiles " << width << "x" << height << ", tile " << tileSize << ", "
+		<< cv::getNumThreads() << " threads, " << runs << " runs\n"
+		<< "  serial : " << tmSerial.getTimeMilli() / runs << " ms, " << serialAnchors.size() / 3 << " anchors\n"
+		<< "  tiled  : " << tmTiled.getTimeMilli() / runs << " ms, " << tiledAnchors.size() / 3 << " anchors, "
+		<< (isSame ? "identical" : "DIFFERENT") << ", " << numDeferred << " triplets deferred, "
+		<< "threshold bin " << sumReplayMs / runs << " ms" << std::endl;
+
+	return isSame ? 0 : -1;
+}
+
+
+/* @brief Heap allocations of linking and validation per frame, a workspace per frame vs.
+a kept workspace whose arena and visit map are reused.
+Usage: arena [width] [height] [shapes] [frames] */
+static int benchArena(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+	int numShapes = argc > 2 ? std::stoi(argv[2]) : 1500;
+	int frames = argc > 3 ? std::stoi(argv[3]) : 10;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), numShapes, 47);
+
+	GradientInfo gradInfo;
+	calcGradInfo(makeImageView(frame), &gradInfo);
+
+	std::vector<PixelLinkList> pxLists;
+	AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+	PixelList anchors, anchorsED;
+	AED::extractAlignedAnchors(&gradInfo, pxLists, anchors);
+	NMS(&gradInfo, anchorsED);
+
+	LineSegList lineSegments, candidateSegments;
+	lineSegments.reserve(anchors.size());
+	candidateSegments.reserve(anchors.size());
+
+	// a workspace per frame, as AED::detect without workspace
+	size_t coldNew = 0;
+	cv::TickMeter tmCold;
+	for (int f = 0; f != frames; ++f)
+	{
+		lineSegments.clear();
+		candidateSegments.clear();
+
+		size_t numNew = g_numNew;
+		tmCold.start();
+		AED::detect(&gradInfo, anchors, anchorsED, lineSegments, candidateSegments);
+		AED::validateCandidateSegments(&gradInfo, candidateSegments);
+		tmCold.stop();
+		coldNew += g_numNew - numNew;
+	}
+	size_t numCold = lineSegments.size();
+
+	// a kept workspace, the first frame warms it up
+	AED::LinkWorkspace ws;
+	size_t warmNew = 0, arenaAllocs = 0, blockAllocs = 0;
+	cv::TickMeter tmWarm;
+	for (int f = 0; f <= frames; ++f)
+	{
+		lineSegments.clear();
+		candidateSegments.clear();
+
+		size_t numNew = g_numNew;
+		if (f > 0) tmWarm.start();
+		AED::detect(&gradInfo, anchors, anchorsED, ws, lineSegments, candidateSegments);
+		AED::validateCandidateSegments(&gradInfo, candidateSegments, &ws.arena);
+		if (f > 0) tmWarm.stop();
+
+		if (f == 0)
+			continue;
+
+		warmNew += g_numNew - numNew;
+		arenaAllocs += ws.arena.numAllocs();
+		blockAllocs += ws.arena.numBlockAllocs();
+	}
+
+	std::cout << "arena " << width << "x" << height << ", " << numShapes << " shapes, "
+		<< anchors.size() / 3 << " groups, " << frames << " frames\n"
+		<< "  workspace per frame : " << tmCold.getTimeMilli() / frames << " ms, "
+		<< coldNew / frames << " heap allocations per frame, " << numCold << " segments\n"
+		<< "  kept workspace      : " << tmWarm.getTimeMilli() / frames << " ms, "
+		<< warmNew / frames << " heap allocations per frame, " << lineSegments.size() << " segments\n"
+		<< "  arena               : " << arenaAllocs / frames << " allocations served per frame, "
+		<< blockAllocs << " blocks added, " << ws.arena.capacity() / 1024 << " KB" << std::endl;
+
+	return numCold == lineSegments.size() ? 0 : -1;
+}
+
+
+/* @brief Maps of two gradient stages are identical, bit by bit. */
+static bool isSameGradInfo(const GradientInfo& lhs, const GradientInfo& rhs)
+{
+	auto isSame = [](const cv::Mat& a, const cv::Mat& b)->bool {
+		return a.size() == b.size() && a.type() == b.type() &&
+			std::equal(a.ptr<uchar>(), a.ptr<uchar>() + a.total() * a.elemSize(), b.ptr<uchar>());
+	};
+
+	return isSame(lhs.gradx, rhs.gradx) && isSame(lhs.grady, rhs.grady) &&
+		isSame(lhs.mag, rhs.mag) && isSame(lhs.ori, rhs.ori);
+}
+
+
+/* @brief Generic gradient stage (filter2D, magnitude and orientation passes with runtime
+options) vs. the fused stage specialized per policy.
+Usage: policies [width] [height] [runs] */
+static int benchPolicies(int argc, char** argv)
+{
+	int width = argc > 0 ? std::stoi(argv[0]) : 1920;
+	int height = argc > 1 ? std::stoi(argv[1]) : 1080;
+	int runs = argc > 2 ? std::stoi(argv[2]) : 10;
+
+	cv::Mat frame = syntheticScene(cv::Size(width, height), width * height / 4000, 53);
+	cv::GaussianBlur(frame, frame, cv::Size(5, 5), 1.0);
+
+	std::cout << "policies " << width << "x" << height << ", " << runs << " runs\n";
+
+	const char* names[] = { "2x2   L1", "2x2   L2", "Sobel L1", "Sobel L2" };
+	bool isAllSame = true;
+	for (int ind = 0; ind != 4; ++ind)
+	{
+		int kernelType = ind < 2 ? MASK2x2 : SOBEL;
+		bool useL1 = ind % 2 == 0;
+
+		GradientInfo generic, specialized;
+		cv::TickMeter tmGeneric, tmSpecialized;
+		for (int run = 0; run != runs; ++run)
+		{
+			tmGeneric.start();
+			calcGradInfo(frame, &generic, kernelType);
+			if (!useL1)
+				calcMagnitude(generic.gradx, generic.grady, generic.mag, false);
+			tmGeneric.stop();
+
+			tmSpecialized.start();
+			calcGradInfoFused(frame, &specialized, kernelType, useL1);
+			tmSpecialized.stop();
+		}
+
+		bool isSame = isSameGradInfo(generic, specialized);
+		isAllSame &= isSame;
+
+		std::cout << "  " << names[ind] << " : generic " << tmGeneric.getTimeMilli() / runs
+			<< " ms, specialized " << tmSpecialized.getTimeMilli() / runs << " ms, "
+			<< (isSame ? "identical" : "DIFFERENT") << "\n";
+	}
+	std::cout << std::flush;
+
+	return isAllSame ? 0 : -1;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string name = argc > 1 ? argv[1] : "video";
+
+	if (name == "video")
+		return benchVideo(argc - 2, argv + 2);
+	if (name == "tracking")
+		return benchTracking(argc - 2, argv + 2);
+	if (name == "anytime")
+		return benchAnytime(argc - 2, argv + 2);
+	if (name == "topk")
+		return benchTopK(argc - 2, argv + 2);
+	if (name == "anchors")
+		return benchAnchors(argc - 2, argv + 2);
+	if (name == "merge")
+		return benchMerge(argc - 2, argv + 2);
+	if (name == "engines")
+		return benchEngines(argc - 2, argv + 2);
+	if (name == "successors")
+		return benchSuccessors(argc - 2, argv + 2);
+	if (name == "kernels")
+		return benchKernels(argc - 2, argv + 2);
+	if (name == "tiles")
+		return benchTiles(argc - 2, argv + 2);
+	if (name == "arena")
+		return benchArena(argc - 2, argv + 2);
+	if (name == "policies")
+		return benchPolicies(argc - 2, argv + 2);
+
+	std::cerr << "Usage: AlignEDBench <case> [options]\n"
+		<< "  video [width] [height] [frames] [moving-area-ratio]\n"
+		<< "  tracking [width] [height] [frames] [pixels-per-frame]\n"
+		<< "  anytime [width] [height]\n"
+		<< "  topk [K] [min-length] [width] [height]\n"
+		<< "  anchors [width] [height] [bins] [mag-range]\n"
+		<< "  merge [width] [height] [max-gap] [angle-tolerance]\n"
+		<< "  engines [width] [height] [shapes] [runs]\n"
+		<< "  successors [width] [height] [shapes] [runs]\n"
+		<< "  kernels [width] [height] [runs]\n"
+		<< "  tiles [width] [height] [tile-size] [runs]\n"
+		<< "  arena [width] [height] [shapes] [frames]\n"
+		<< "  policies [width] [height] [runs]\n";
+
+	return -1;
+}
@@ -0,0 +1,187 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "detectd.hpp"
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+/* @brief Draw a synthetic scene of random lines and rectangles. */
+static cv::Mat syntheticScene(const cv::Size& size, int numShapes, uint64 seed)
+{
+	cv::RNG rng(seed);
+	cv::Mat scene(size, CV_8UC1, cv::Scalar(128));
+
+	for (int i = 0; i != numShapes; ++i)
+	{
+		cv::Point pt0(rng.uniform(0, size.width), rng.uniform(0, size.height));
+		cv::Point pt1(rng.uniform(0, size.width), rng.uniform(0, size.height));
+		cv::Scalar color(rng.uniform(0, 256));
+
+		if (i % 3 == 0)
+			cv::rectangle(scene, cv::Rect(pt0, pt1), color, 2);
+		else
+			cv::line(scene, pt0, pt1, color, 2);
+	}
+
+	return scene;
+}
+
+
+/* @brief Copy the frame into a slot of the ring. */
+static void writeFrame(const ShmRing& ring, uint32_t slot, const cv::Mat& frame)
+{
+	SlotHeader* header = ring.slotHeader(slot);
+	header->width = frame.cols;
+	header->height = frame.rows;
+	header->stride = uint32_t(frame.cols);
+	header->format = PIX_GRAY8;
+	header->count = 0;
+	header->truncated = 0;
+
+	uint8_t* dst = ring.payload(slot);
+	for (int row = 0; row != frame.rows; ++row, dst += frame.cols)
+		std::memcpy(dst, frame.ptr<uint8_t>(row), frame.cols);
+
+	return;
+}
+
+
+/* @brief Latency percentile of sorted samples. */
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t ind = std::min(sorted.size() - 1, size_t(p * sorted.size()));
+	return sorted[ind];
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: AlignEDClient <socket-path> <image | WxH> [requests] [in-flight]\n"
+			<< "  WxH: synthetic frame of the size, e.g. 1280x720\n"
+			<< "  in-flight: requests pipelined on the connection, one ring slot each\n";
+		return -1;
+	}
+
+	int numRequests = argc > 3 ? std::stoi(argv[3]) : 1000;
+	int inFlight = argc > 4 ? std::max(std::stoi(argv[4]), 1) : 1;
+
+	std::string source = argv[2];
+	int width = 0, height = 0;
+	cv::Mat frame;
+	if (std::sscanf(source.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+		frame = syntheticScene(cv::Size(width, height), 200, 7);
+	else
+		frame = cv::imread(source, cv::IMREAD_GRAYSCALE);
+
+	if (frame.empty())
+	{
+		std::cerr << "Reading " << source << " failed." << std::endl;
+		return -1;
+	}
+
+	// payload holds the frame, or up to one segment per 16 pixels
+	std::string shmName = "/aag-" + std::to_string(getpid());
+	ShmRing ring;
+	if (!ring.create(shmName, uint32_t(inFlight), frame.total()))
+	{
+		std::cerr << "Creating shared memory failed." << std::endl;
+		return -1;
+	}
+
+	sockaddr_un addr;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (!socketAddress(argv[1], addr) || fd == -1 ||
+		connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1)
+	{
+		std::cerr << "Connecting to " << argv[1] << " failed." << std::endl;
+		shm_unlink(shmName.c_str());
+		return -1;
+	}
+
+	Message msg;
+	msg.type = MSG_ATTACH;
+	std::strncpy(msg.shmName, shmName.c_str(), sizeof(msg.shmName) - 1);
+	bool isAttached = sendMessage(fd, msg) && recvMessage(fd, msg) && msg.status == 0;
+
+	// the server holds its own mapping, the name is no longer needed
+	shm_unlink(shmName.c_str());
+	if (!isAttached)
+	{
+		std::cerr << "Attaching shared memory failed." << std::endl;
+		close(fd);
+		return -1;
+	}
+
+	std::vector<Clock::time_point> sendTime(inFlight);
+	std::vector<double> latencies;
+	latencies.reserve(numRequests);
+
+	// send a request on the slot, the frame is rewritten since results overwrite it
+	int numSent = 0;
+	auto submit = [&](uint32_t slot)->bool {
+		writeFrame(ring, slot, frame);
+		Message req;
+		req.type = MSG_DETECT;
+		req.slot = slot;
+		req.seq = uint64_t(numSent++);
+		sendTime[slot] = Clock::now();
+		return sendMessage(fd, req);
+	};
+
+	Clock::time_point t0 = Clock::now();
+	size_t numSegments = 0;
+	bool isOK = true;
+
+	for (int slot = 0; slot != std::min(inFlight, numRequests) && isOK; ++slot)
+		isOK = submit(uint32_t(slot));
+
+	while (isOK && int(latencies.size()) != numRequests)
+	{
+		Message reply;
+		if (!recvMessage(fd, reply) || reply.type != MSG_RESULT || reply.slot >= uint32_t(inFlight))
+		{
+			isOK = false;
+			break;
+		}
+
+		latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sendTime[reply.slot]).count());
+		if (reply.status != 0)
+		{
+			std::cerr << "Request " << reply.seq << " failed with status " << reply.status << std::endl;
+			isOK = false;
+			break;
+		}
+		numSegments += reply.count;
+
+		if (numSent != numRequests)
+			isOK = submit(reply.slot);
+	}
+
+	double totalSec = std::chrono::duration<double>(Clock::now() - t0).count();
+	close(fd);
+
+	if (latencies.empty())
+	{
+		std::cerr << "No reply from server." << std::endl;
+		return -1;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+
+	std::cout << latencies.size() << " requests of " << frame.cols << "x" << frame.rows
+		<< ", " << inFlight << " in flight, " << latencies.size() / totalSec << " frames/s, "
+		<< 1.0 * numSegments / latencies.size() << " segments/frame\n"
+		<< "  latency ms: p50 " << percentile(latencies, 0.50)
+		<< ", p90 " << percentile(latencies, 0.90)
+		<< ", p99 " << percentile(latencies, 0.99)
+		<< ", max " << latencies.back() << std::endl;
+
+	return isOK ? 0 : -1;
+}
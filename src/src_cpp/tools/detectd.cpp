@@ -0,0 +1,241 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <csignal>
+#include <cerrno>
+#include <algorithm>
+#include "utilities.hpp"
+#include "alignED.hpp"
+#include "detectd.hpp"
+
+
+/* @brief A client connection with its mapped ring. */
+struct Connection
+{
+	int        fd = -1;
+	ShmRing    ring;
+	std::mutex writeMutex;	// replies from several workers
+
+	~Connection()
+	{
+		if (fd != -1)
+			close(fd);
+	}
+};
+
+
+/* @brief A pending detection. */
+struct Job
+{
+	std::shared_ptr<Connection> conn;
+	Message                     msg;
+};
+
+
+/* @brief Jobs shared by all connections, served by the workers. */
+class JobQueue
+{
+public:
+	void push(Job&& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+		}
+		cond.notify_one();
+	}
+
+	bool pop(Job& job)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [this] { return !jobs.empty() || isStopped; });
+		if (jobs.empty())
+			return false;
+
+		job = std::move(jobs.front());
+		jobs.pop_front();
+		return true;
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			isStopped = true;
+		}
+		cond.notify_all();
+	}
+
+private:
+	std::mutex              mutex;
+	std::condition_variable cond;
+	std::deque<Job>         jobs;
+	bool                    isStopped = false;
+};
+
+
+/* @brief Detector of a worker, buffers are kept warm across frames. */
+class Detector
+{
+public:
+	/* @brief Detect on the frame of a slot and write segments to its payload. */
+	int32_t run(const ShmRing& ring, uint32_t slot, uint32_t& count)
+	{
+		count = 0;
+		SlotHeader* header = ring.slotHeader(slot);
+		RawImageView view(ring.payload(slot), header->width, header->height,
+			header->stride, PixelFormat(header->format));
+
+		// the frame must be inside the payload, checked on the copied fields only
+		if (!view.isValid() || view.format > PIX_RGBA8 ||
+			view.stride * view.height > ring.slotBytes())
+			return -2;
+
+		if (!calcGradInfo(view, &gradInfo))
+			return -3;
+
+		AED::pseudoSort<float>(gradInfo.mag, pxLists);
+
+		alignedAnchors.clear();
+		anchorsED.clear();
+		AED::extractAlignedAnchors(&gradInfo, pxLists, alignedAnchors);
+		NMS(&gradInfo, anchorsED);
+
+		lineSegments.clear();
+		candidateSegments.clear();
+		AED::detect(&gradInfo, alignedAnchors, anchorsED, ws, lineSegments, candidateSegments);
+
+		// the frame is consumed, segments overwrite it
+		size_t capacity = ring.slotBytes() / (4 * sizeof(float));
+		count = uint32_t(std::min(lineSegments.size(), capacity));
+		float* ptr = reinterpret_cast<float*>(ring.payload(slot));
+		for (uint32_t i = 0; i != count; ++i, ptr += 4)
+		{
+			const auto& seg = lineSegments[i];
+			ptr[0] = seg.begPx.x, ptr[1] = seg.begPx.y;
+			ptr[2] = seg.endPx.x, ptr[3] = seg.endPx.y;
+		}
+
+		header->count = count;
+		header->truncated = count != lineSegments.size();
+
+		return 0;
+	}
+
+private:
+	GradientInfo               gradInfo;
+	std::vector<PixelLinkList> pxLists;
+	PixelList                  alignedAnchors, anchorsED;
+	AED::LinkWorkspace         ws;
+	LineSegList                lineSegments, candidateSegments;
+};
+
+
+/* @brief Worker thread, detects until the queue stops. */
+static void serveJobs(JobQueue& queue)
+{
+	Detector detector;
+	Job job;
+	while (queue.pop(job))
+	{
+		Message reply = job.msg;
+		reply.type = MSG_RESULT;
+		reply.status = job.msg.slot < job.conn->ring.numSlots() ?
+			detector.run(job.conn->ring, job.msg.slot, reply.count) : -1;
+
+		std::lock_guard<std::mutex> lock(job.conn->writeMutex);
+		sendMessage(job.conn->fd, reply);
+		job.conn.reset();
+	}
+
+	return;
+}
+
+
+/* @brief Reader thread of a connection, the ring is attached first. */
+static void serveConnection(std::shared_ptr<Connection> conn, JobQueue& queue)
+{
+	Message msg;
+	if (!recvMessage(conn->fd, msg) || msg.type != MSG_ATTACH)
+		return;
+
+	msg.shmName[sizeof(msg.shmName) - 1] = '\0';
+	msg.status = conn->ring.attach(msg.shmName) ? 0 : -1;
+	if (!sendMessage(conn->fd, msg) || msg.status != 0)
+		return;
+
+	while (recvMessage(conn->fd, msg))
+	{
+		if (msg.type != MSG_DETECT)
+			break;
+
+		queue.push(Job{ conn, msg });
+	}
+
+	// the ring stays mapped until pending jobs drop their references
+	return;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string socketPath = argc > 1 ? argv[1] : "/tmp/aligned.sock";
+	int numWorkers = argc > 2 ? std::stoi(argv[2]) : int(std::thread::hardware_concurrency());
+	numWorkers = std::max(numWorkers, 1);
+
+	// each worker runs one frame, no nested parallelism
+	cv::setNumThreads(1);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_un addr;
+	if (!socketAddress(socketPath, addr))
+	{
+		std::cerr << "Socket path is too long." << std::endl;
+		return -1;
+	}
+
+	int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socketPath.c_str());
+	if (listenFd == -1 || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+		listen(listenFd, 64) == -1)
+	{
+		std::cerr << "Listening on " << socketPath << " failed." << std::endl;
+		return -1;
+	}
+
+	JobQueue queue;
+	std::vector<std::thread> workers;
+	for (int i = 0; i != numWorkers; ++i)
+		workers.emplace_back(serveJobs, std::ref(queue));
+
+	std::cout << "Listening on " << socketPath << " with " << numWorkers << " workers" << std::endl;
+
+	while (true)
+	{
+		int fd = accept(listenFd, nullptr, nullptr);
+		if (fd == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		auto conn = std::make_shared<Connection>();
+		conn->fd = fd;
+		std::thread(serveConnection, conn, std::ref(queue)).detach();
+	}
+
+	queue.stop();
+	for (auto& worker : workers)
+		worker.join();
+
+	close(listenFd);
+	unlink(socketPath.c_str());
+
+	return 0;
+}
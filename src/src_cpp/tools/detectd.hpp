@@ -0,0 +1,243 @@
+#ifndef __DETECT_DAEMON_HPP__
+#define __DETECT_DAEMON_HPP__
+
+
+// Protocol shared by AlignEDServer and AlignEDClient, POSIX only.
+//
+// A client creates a shared-memory ring of slots and attaches it to the server through
+// a Unix domain socket. For each request the client writes a frame into a free slot and
+// sends MSG_DETECT with the slot index. The server detects directly on the shared frame,
+// overwrites the slot's payload with segments (x0, y0, x1, y1 as float32), and replies
+// MSG_RESULT. A slot belongs to the server from MSG_DETECT until its MSG_RESULT.
+
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "imageview.hpp"
+
+
+constexpr uint32_t SHM_RING_MAGIC = 'A' | 'A' << 8 | 'G' << 16 | 'R' << 24;
+
+
+enum MessageType : uint32_t
+{
+	MSG_ATTACH = 1,	// client -> server, shmName is the ring; server replies with status
+	MSG_DETECT,		// client -> server, detect the frame in slot
+	MSG_RESULT		// server -> client, count segments in slot, or status < 0
+};
+
+
+/* @brief Fixed-size socket message. */
+struct Message
+{
+	uint32_t type = 0;
+	uint32_t slot = 0;
+	uint64_t seq = 0;
+	int32_t  status = 0;	// 0 OK, < 0 error
+	uint32_t count = 0;		// number of segments
+	char     shmName[48] = { 0 };
+};
+
+
+/* @brief Header of the ring, at the beginning of shared memory. */
+struct RingHeader
+{
+	uint32_t magic;
+	uint32_t numSlots;
+	uint64_t slotBytes;		// payload bytes of a slot
+};
+
+
+/* @brief Header of a slot, followed by its payload. */
+struct SlotHeader
+{
+	int32_t  width;
+	int32_t  height;
+	uint32_t stride;		// bytes per row of the frame
+	uint32_t format;		// PixelFormat
+	uint32_t count;			// segments written by server
+	uint32_t truncated;		// 1 if segments did not fit in the payload
+	uint8_t  reserved[40];
+};
+
+static_assert(sizeof(SlotHeader) == 64, "slot header must be 64 bytes");
+
+
+/* @brief Shared-memory ring of slots. */
+class ShmRing
+{
+public:
+	ShmRing() = default;
+	ShmRing(const ShmRing&) = delete;
+	ShmRing& operator=(const ShmRing&) = delete;
+	~ShmRing() { close(); }
+
+	/* @brief Create and map a new ring, as client. */
+	bool create(
+		const std::string& name,
+		uint32_t           numSlots,
+		uint64_t           slotBytes
+	)
+	{
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd == -1)
+			return false;
+
+		size_t bytes = sizeof(RingHeader) + size_t(numSlots) * (sizeof(SlotHeader) + slotBytes);
+		if (ftruncate(fd, bytes) == -1 || !map(fd, bytes))
+		{
+			::close(fd);
+			shm_unlink(name.c_str());
+			return false;
+		}
+		::close(fd);
+
+		RingHeader* header = ringHeader();
+		header->magic = SHM_RING_MAGIC;
+		header->numSlots = numSlots;
+		header->slotBytes = slotBytes;
+
+		ringSlots = numSlots;
+		ringSlotBytes = slotBytes;
+
+		return true;
+	}
+
+	/* @brief Map an existing ring, as server. */
+	bool attach(const std::string& name)
+	{
+		int fd = shm_open(name.c_str(), O_RDWR, 0);
+		if (fd == -1)
+			return false;
+
+		struct stat st;
+		bool isOK = fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(RingHeader) && map(fd, st.st_size);
+		::close(fd);
+
+		if (!isOK)
+			return false;
+
+		// the client may rewrite the header at any time, so the checked values are copied once
+		const volatile RingHeader* header = ringHeader();
+		uint32_t magic = header->magic;
+		uint32_t numSlots = header->numSlots;
+		uint64_t slotBytes = header->slotBytes;
+
+		// the size must cover all slots declared in the header
+		if (magic != SHM_RING_MAGIC || slotBytes > length ||
+			sizeof(RingHeader) + size_t(numSlots) * (sizeof(SlotHeader) + slotBytes) > length)
+		{
+			close();
+			return false;
+		}
+
+		ringSlots = numSlots;
+		ringSlotBytes = slotBytes;
+
+		return true;
+	}
+
+	void close()
+	{
+		if (ptr != nullptr)
+			munmap(ptr, length);
+		ptr = nullptr;
+		length = 0;
+		ringSlots = 0;
+		ringSlotBytes = 0;
+	}
+
+	uint32_t numSlots() const { return ringSlots; }
+
+	uint64_t slotBytes() const { return ringSlotBytes; }
+
+	SlotHeader* slotHeader(uint32_t slot) const
+	{
+		return reinterpret_cast<SlotHeader*>(ptr + sizeof(RingHeader) +
+			size_t(slot) * (sizeof(SlotHeader) + ringSlotBytes));
+	}
+
+	uint8_t* payload(uint32_t slot) const
+	{
+		return reinterpret_cast<uint8_t*>(slotHeader(slot) + 1);
+	}
+
+private:
+	bool map(int fd, size_t bytes)
+	{
+		void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (addr == MAP_FAILED)
+			return false;
+
+		ptr = static_cast<uint8_t*>(addr);
+		length = bytes;
+		return true;
+	}
+
+	RingHeader* ringHeader() const { return reinterpret_cast<RingHeader*>(ptr); }
+
+private:
+	uint8_t* ptr = nullptr;
+	size_t   length = 0;
+
+	// layout as of create or attach, never re-read from the shared header
+	uint32_t ringSlots = 0;
+	uint64_t ringSlotBytes = 0;
+};
+
+
+/* @brief Send a whole message, false if the peer is gone. */
+inline bool sendMessage(int fd, const Message& msg)
+{
+	const char* data = reinterpret_cast<const char*>(&msg);
+	size_t sent = 0;
+	while (sent != sizeof(msg))
+	{
+		ssize_t n = send(fd, data + sent, sizeof(msg) - sent, MSG_NOSIGNAL);
+		if (n <= 0)
+			return false;
+		sent += n;
+	}
+
+	return true;
+}
+
+
+/* @brief Receive a whole message, false if the peer is gone. */
+inline bool recvMessage(int fd, Message& msg)
+{
+	char* data = reinterpret_cast<char*>(&msg);
+	size_t received = 0;
+	while (received != sizeof(msg))
+	{
+		ssize_t n = recv(fd, data + received, sizeof(msg) - received, 0);
+		if (n <= 0)
+			return false;
+		received += n;
+	}
+
+	return true;
+}
+
+
+/* @brief Fill a Unix socket address, false if the path is too long. */
+inline bool socketAddress(const std::string& path, sockaddr_un& addr)
+{
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+		return false;
+
+	std::strcpy(addr.sun_path, path.c_str());
+	return true;
+}
+
+
+#endif // !__DETECT_DAEMON_HPP__
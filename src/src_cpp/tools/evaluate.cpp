@@ -0,0 +1,125 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+#include "evaluate.hpp"
+
+
+/* @brief Repeatability on HPatches, the same numbers as evaluation/repeatability_eval.py. */
+static int evalHPatches(int argc, char** argv)
+{
+	std::string hpatchesDir = argv[0];
+	std::string predPath = argv[1];
+
+	RepeatParams params;
+	if (argc > 2)
+		params.distThresh = std::stof(argv[2]);
+	if (argc > 3)
+		params.angThresh = float(std::stod(argv[3]) * CV_PI / 180.0);
+	if (argc > 4)
+		params.areaThresh = std::stof(argv[4]);
+	if (argc > 5)
+		params.pixelwise = std::string(argv[5]) == "pixelwise";
+
+	DetectionSource source;
+	if (!source.open(predPath))
+		return -1;
+
+	int64 t0 = cv::getTickCount();
+
+	std::vector<SequenceResult> results;
+	evaluateHPatches(hpatchesDir, source, params, results);
+
+	double ms = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+
+	// illumination sequences start with 'i_', viewpoint ones with 'v_'
+	double sum = 0.0, lightSum = 0.0, viewSum = 0.0;
+	int num = 0, lightNum = 0, viewNum = 0;
+	for (const auto& result : results)
+	{
+		if (!result.isValid)
+			continue;
+
+		std::cout << result.name << ": " << result.rep << '\n';
+
+		sum += result.rep;
+		++num;
+		if (result.name.compare(0, 2, "i_") == 0)
+		{
+			lightSum += result.rep;
+			++lightNum;
+		}
+		else if (result.name.compare(0, 2, "v_") == 0)
+		{
+			viewSum += result.rep;
+			++viewNum;
+		}
+	}
+
+	std::cout << "Mean Repeatability:" << (num ? sum / num : 0.0) << '\n'
+		<< "Mean Light Repeatability:" << (lightNum ? lightSum / lightNum : 0.0) << '\n'
+		<< "Mean View Repeatability:" << (viewNum ? viewSum / viewNum : 0.0) << '\n'
+		<< num << " sequences evaluated in " << ms << " ms" << std::endl;
+
+	return num == results.size() ? 0 : -1;
+}
+
+
+/* @brief Pixel-level precision, recall, F-score and structural AP on YorkUrban. */
+static int evalYorkUrban(int argc, char** argv)
+{
+	std::string labelDir = argv[0];
+	std::string predPath = argv[1];
+
+	AccuracyParams params;
+	if (argc > 2)
+		params.sapScale = std::stof(argv[2]);
+
+	DetectionSource source;
+	if (!source.open(predPath))
+		return -1;
+
+	int64 t0 = cv::getTickCount();
+
+	AccuracyResult result;
+	bool isOK = evaluateYorkUrban(labelDir, source, params, result);
+
+	double ms = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+
+	// nothing is evaluated, e.g. the label directory is missing
+	if (result.precision.size() != params.pixelThresh.size() ||
+		result.sAP.size() != params.sapThresh.size())
+	{
+		std::cerr << "No image evaluated." << std::endl;
+		return -1;
+	}
+
+	for (size_t k = 0; k != params.pixelThresh.size(); ++k)
+	{
+		std::cout << "Pixel threshold " << params.pixelThresh[k] << ": P " << result.precision[k]
+			<< ", R " << result.recall[k] << ", F " << result.fscore[k] << '\n';
+	}
+
+	for (size_t k = 0; k != params.sapThresh.size(); ++k)
+		std::cout << "sAP" << params.sapThresh[k] << ": " << result.sAP[k] << '\n';
+
+	std::cout << result.numImages << " images evaluated in " << ms << " ms" << std::endl;
+
+	return isOK ? 0 : -1;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string name = argc > 1 ? argv[1] : "";
+
+	if (name == "hpatches" && argc >= 4)
+		return evalHPatches(argc - 2, argv + 2);
+	if (name == "yorkurban" && argc >= 4)
+		return evalYorkUrban(argc - 2, argv + 2);
+
+	std::cerr << "Usage: AlignEDEval <dataset> [options]\n"
+		<< "  hpatches <hpatches-dir> <csv-dir | segbin-file> [dist-thresh] [ang-thresh-deg] [area-thresh] [pixelwise]\n"
+		<< "  yorkurban <label-dir> <csv-dir | segbin-file> [sap-scale]\n";
+
+	return -1;
+}
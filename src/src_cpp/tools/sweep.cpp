@@ -0,0 +1,233 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include "utilities.hpp"
+#include "iofile.hpp"
+#include "drawutils.hpp"
+#include "sweep.hpp"
+#include "gradcache.hpp"
+#include "successor.hpp"
+
+
+/* @brief Parse comma-separated values, e.g. '2,3,4'. */
+template <typename T>
+static std::vector<T> parseList(const std::string& text)
+{
+	std::vector<T> values;
+	std::stringstream ss(text);
+	std::string item;
+	while (std::getline(ss, item, ','))
+		values.push_back(T(std::stod(item)));
+
+	return values;
+}
+
+
+/* @brief List images with the suffix under the directory recursively, sorted. */
+static void listImages(
+	const std::string&        dir,
+	const std::string&        suffix,
+	std::vector<std::string>& filenames
+)
+{
+	std::error_code ec;
+	for (const auto& entry : fs::recursive_directory_iterator(dir, ec))
+	{
+		if (entry.is_regular_file(ec) && entry.path().extension().string() == suffix)
+			filenames.push_back(entry.path().string());
+	}
+
+	std::sort(filenames.begin(), filenames.end());
+
+	return;
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "Usage: AlignEDSweep <image-dir> <suffix> <output.csv> [key=v0,v1,...]\n"
+			<< "  keys: bins, anchor_thresh, angle_tolerance, remain_steps, anchor_density, aligned_density\n"
+			<< "  engine=walk,graph,routing: linking engines, compared on the same gradients and anchors\n"
+			<< "  successors=0,1: walk on a successor map built after the gradient, or select on the fly\n"
+			<< "  labels=<dir>: YorkUrban labels '<dir>/<image>.txt', adds accuracy columns\n"
+			<< "  cache=<dir>, cache_mb=<size>: persistent gradient cache, reused by later runs\n"
+			<< "  e.g. AlignEDSweep YorkUrbanDB .jpg sweep.csv anchor_thresh=2,3,4 remain_steps=5,7,9\n";
+		return -1;
+	}
+
+	AED::SweepGrid grid;
+	std::string labelDir, cacheDir;
+	uint64_t cacheMB = 1024;
+	for (int i = 4; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		size_t pos = arg.find('=');
+		std::string key = arg.substr(0, pos), value = pos == std::string::npos ? "" : arg.substr(pos + 1);
+
+		if (key == "bins")
+			grid.bins = parseList<int>(value);
+		else if (key == "anchor_thresh")
+			grid.anchorThresh = parseList<float>(value);
+		else if (key == "angle_tolerance")
+			grid.angleTolerance = parseList<float>(value);
+		else if (key == "engine")
+		{
+			grid.engine.clear();
+			std::stringstream ss(value);
+			std::string item;
+			while (std::getline(ss, item, ','))
+			{
+				AED::LinkEngineType engine;
+				if (!AED::parseLinkEngine(item, engine))
+				{
+					std::cerr << "Unknown engine " << item << std::endl;
+					return -1;
+				}
+				grid.engine.push_back(engine);
+			}
+		}
+		else if (key == "successors")
+		{
+			grid.useSuccessors.clear();
+			for (int flag : parseList<int>(value))
+				grid.useSuccessors.push_back(flag != 0);
+		}
+		else if (key == "remain_steps")
+			grid.remainSteps = parseList<int>(value);
+		else if (key == "anchor_density")
+			grid.anchorDensity = parseList<float>(value);
+		else if (key == "aligned_density")
+			grid.alignedDensity = parseList<float>(value);
+		else if (key == "labels")
+			labelDir = value;
+		else if (key == "cache")
+			cacheDir = value;
+		else if (key == "cache_mb")
+			cacheMB = std::stoull(value);
+		else
+		{
+			std::cerr << "Unknown parameter " << key << std::endl;
+			return -1;
+		}
+	}
+
+	std::vector<AED::SweepSetting> settings;
+	AED::expandSweepGrid(grid, settings);
+
+	std::vector<std::string> filenames;
+	listImages(argv[1], argv[2], filenames);
+	if (filenames.empty() || settings.empty())
+	{
+		std::cerr << "No image or no setting." << std::endl;
+		return -1;
+	}
+
+	GradientCache cache;
+	if (!cacheDir.empty() && !cache.open(cacheDir, cacheMB << 20))
+		return -1;
+
+	AccuracyParams accParams;
+	std::vector<std::vector<AED::SweepRow>> imageRows(filenames.size());
+	std::vector<AED::SweepStats> imageStats(filenames.size());
+	std::vector<double> gradMs(filenames.size(), 0.0), successorMs(filenames.size(), 0.0);
+
+	// the map is built once per image, only if a setting walks on it
+	bool needSuccessors = std::any_of(settings.begin(), settings.end(),
+		[](const AED::SweepSetting& setting) { return setting.link.useSuccessors; });
+
+	int64 t0 = cv::getTickCount();
+
+	// images in parallel, each image runs all settings on its own gradient
+	cv::parallel_for_(cv::Range(0, int(filenames.size())), [&](const cv::Range& range) {
+		for (int i = range.start; i != range.end; ++i)
+		{
+			int64 t = cv::getTickCount();
+			GradientInfo gradInfo;
+			if (cache.isOpen())
+			{
+				// decoding and gradient are skipped on hit
+				if (!cache.load(filenames[i], &gradInfo))
+					continue;
+			}
+			else
+			{
+				cv::Mat img = cv::imread(filenames[i], cv::IMREAD_GRAYSCALE);
+				if (img.empty())
+					continue;
+
+				calcGradInfo(makeImageView(img), &gradInfo);
+			}
+			gradMs[i] = (cv::getTickCount() - t) * 1000.0 / cv::getTickFrequency();
+
+			if (needSuccessors)
+			{
+				t = cv::getTickCount();
+				AED::calcSuccessorMap(&gradInfo);
+				successorMs[i] = (cv::getTickCount() - t) * 1000.0 / cv::getTickFrequency();
+			}
+
+			LineSegList gt;
+			if (!labelDir.empty())
+				extractYUK(labelDir + '/' + fs::path(filenames[i]).stem().string() + ".txt", gt);
+
+			AED::sweepImage(&gradInfo, settings, labelDir.empty() ? nullptr : &gt,
+				accParams, imageRows[i], imageStats[i]);
+		}
+	});
+
+	double totalMs = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+
+	// merge in file order
+	std::vector<AED::SweepRow> rows(settings.size());
+	AED::SweepStats stats;
+	double sumGradMs = 0.0, sumSuccessorMs = 0.0;
+	for (size_t i = 0; i != settings.size(); ++i)
+		rows[i].setting = settings[i];
+
+	for (size_t img = 0; img != filenames.size(); ++img)
+	{
+		if (imageRows[img].empty())
+		{
+			std::cerr << "Reading " << filenames[img] << " failed." << std::endl;
+			continue;
+		}
+
+		for (size_t i = 0; i != rows.size(); ++i)
+		{
+			const auto& src = imageRows[img][i];
+			rows[i].numImages += src.numImages;
+			rows[i].numSegments += src.numSegments;
+			rows[i].totalLength += src.totalLength;
+			rows[i].linkMs += src.linkMs;
+			rows[i].counts.merge(src.counts);
+		}
+
+		sumGradMs += gradMs[img];
+		sumSuccessorMs += successorMs[img];
+		stats.sortMs += imageStats[img].sortMs;
+		stats.anchorMs += imageStats[img].anchorMs;
+		stats.linkMs += imageStats[img].linkMs;
+		stats.numSorts += imageStats[img].numSorts;
+		stats.numAnchors += imageStats[img].numAnchors;
+		stats.numLinks += imageStats[img].numLinks;
+	}
+
+	if (!AED::writeSweepTable(argv[3], rows, accParams))
+		return -1;
+
+	std::cout << settings.size() << " settings x " << filenames.size() << " images in " << totalMs << " ms\n"
+		<< "  gradient    : " << filenames.size() << " runs, " << sumGradMs << " ms"
+		<< (cache.isOpen() ? ", cache hits " + std::to_string(cache.numHits()) +
+			", misses " + std::to_string(cache.numMisses()) : std::string()) << '\n'
+		<< "  successors  : " << (needSuccessors ? filenames.size() : 0) << " runs, " << sumSuccessorMs << " ms\n"
+		<< "  pseudo-sort : " << stats.numSorts << " runs, " << stats.sortMs << " ms\n"
+		<< "  anchors     : " << stats.numAnchors << " runs, " << stats.anchorMs << " ms\n"
+		<< "  linking     : " << stats.numLinks << " runs, " << stats.linkMs << " ms\n"
+		<< "Table written to " << argv[3] << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,175 @@
+#include "tracking.hpp"
+
+
+namespace AED
+{
+	/* @brief Map a pixel by homography, return itself if homography is empty.
+	* @return false if the pixel maps to or near the line at infinity. */
+	static bool warpPixel(
+		const cv::Mat& H,
+		const Pixel&   px,
+		Pixel&         warpedPx
+	)
+	{
+		if (H.empty())
+		{
+			warpedPx = px;
+			return true;
+		}
+
+		const double* h = H.ptr<double>();
+		double w = h[6] * px.x + h[7] * px.y + h[8];
+		if (std::abs(w) < 1e-8)
+			return false;
+
+		warpedPx = Pixel(
+			(h[0] * px.x + h[1] * px.y + h[2]) / w,
+			(h[3] * px.x + h[4] * px.y + h[5]) / w);
+
+		return true;
+	}
+
+
+	/* @brief Collect not-linked groups inside the corridor, which are aligned with the segment. */
+	static void corridorGroups(
+		const LinkWorkspace& ws,
+		const LineSegment&   seg,
+		float                corridorWidth,
+		std::vector<int>&    groups
+	)
+	{
+		groups.clear();
+
+		Pixel lineVec(seg.endPx - seg.begPx);
+		float len = std::sqrt(lineVec * lineVec);
+		if (len < 1.0f)
+			return;
+
+		// unit normal of the segment
+		Pixel normal(-lineVec.y / len, lineVec.x / len);
+		float segAng = seg.angleDeg();
+
+		PixelList pixels;
+		bresenham(seg.begPx, seg.endPx, pixels);
+
+		int halfWidth = std::ceil(corridorWidth);
+		for (const auto& px : pixels)
+		{
+			for (int t = -halfWidth; t <= halfWidth; ++t)
+			{
+				Pixel temp = (px + normal * t).round();
+				if (!temp.isInMatrix(ws.labels))
+					continue;
+
+				int groupInd = atPixel<int>(ws.labels, temp);
+				if (groupInd < 0 || ws.groups.isLink[groupInd])
+					continue;
+
+				if (angleDiff(lineAngle(ws.groups.line(groupInd), true), segAng) <= ANG_TOLERANCE)
+					groups.push_back(groupInd);
+			}
+		}
+
+		std::sort(groups.begin(), groups.end());
+		groups.erase(std::unique(groups.begin(), groups.end()), groups.end());
+
+		return;
+	}
+
+
+	/* @brief Detect line segments, seeded by segments of previous frame. */
+	void detectTracked(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		TrackingState&      state,
+		const cv::Mat&      H,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params
+	)
+	{
+		auto& gradx = pGradInfo->gradx;
+
+		cv::Mat H64;
+		if (!H.empty())
+			H.convertTo(H64, CV_64F);
+
+		LinkWorkspace& ws = state.ws;
+		initLinkWorkspace(pGradInfo, alignedAnchors, edAnchors, ws);
+
+		// area covered by confirmed segments, not seeded again.
+		cv::Mat covered = cv::Mat::zeros(gradx.size(), CV_8UC1);
+		int thickness = 2 * int(std::ceil(state.corridorWidth)) + 1;
+
+		state.numTracked = state.numLost = 0;
+
+		// 1. Re-confirm previous segments inside predicted corridors.
+		std::vector<int> groups;
+		for (const auto& prevSeg : state.prevSegments)
+		{
+			LineSegment predSeg;
+			if (!warpPixel(H64, prevSeg.begPx, predSeg.begPx) ||
+				!warpPixel(H64, prevSeg.endPx, predSeg.endPx))
+			{
+				++state.numLost;
+				continue;
+			}
+
+			corridorGroups(ws, predSeg, state.corridorWidth, groups);
+
+			// the strongest group first
+			std::sort(groups.begin(), groups.end(), [&](int lhs, int rhs)->bool {
+				return ws.groups.strength[lhs] > ws.groups.strength[rhs]; });
+
+			bool isTracked = false;
+			for (int groupInd : groups)
+			{
+				if (ws.groups.isLink[groupInd])
+					continue;	// absorbed by a walk from previous seed
+
+				// the walker validates by anchor and aligned-point density
+				LineSegment seg = linkAlignedAnchorGroup(
+					pGradInfo, ws, candidateSegments, groupInd, params);
+
+				if (seg == LineSegment())
+					continue;
+
+				lineSegments.emplace_back(seg);
+				cv::line(covered, seg.begPx.point(), seg.endPx.point(), cv::Scalar(255), thickness);
+
+				// consistent with the prediction
+				if (angleDiff(seg.angleDeg(), predSeg.angleDeg()) <= ANG_TOLERANCE &&
+					perpendDist(seg, predSeg) <= state.corridorWidth + DIST_TOLERANCE)
+					isTracked = true;
+			}
+
+			isTracked ? ++state.numTracked : ++state.numLost;
+		}
+
+		// 2. Seed remaining groups out of the covered area, new structure; with banding only
+		// this frame's bands. Without previous segments, e.g. the first frame, everything is new
+		int period = state.prevSegments.empty() ? 1 : MAX(state.redetectPeriod, 1);
+		int band = MAX(state.redetectBand, 1);
+		int phase = state.frameIndex % period;
+		++state.frameIndex;
+
+		std::vector<int> seeds;
+		for (int groupInd = 0; groupInd != ws.groups.size(); ++groupInd)
+		{
+			Pixel centerPx(ws.groups.center(groupInd));
+			if (!ws.groups.isLink[groupInd] &&
+				(int(centerPx.y) / band) % period == phase &&
+				atPixel<uchar>(covered, centerPx) == 0)
+				seeds.push_back(groupInd);
+		}
+
+		state.numNewSeeds = seeds.size();
+
+		linkSeeds(pGradInfo, ws, seeds, lineSegments, candidateSegments, params);
+
+		state.prevSegments = lineSegments;
+
+		return;
+	}
+}
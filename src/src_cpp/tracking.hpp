@@ -0,0 +1,62 @@
+#ifndef __TRACKING_HPP__
+#define __TRACKING_HPP__
+
+
+#include <opencv2/opencv.hpp>
+#include "utilities.hpp"
+#include "segments.hpp"
+#include "alignED.hpp"
+
+
+namespace AED
+{
+	/* @brief State of segment-seeded tracking for moving-camera video.
+	Segments of previous frame are re-confirmed inside predicted corridors first,
+	then all groups out of the confirmed corridors are seeded, so new structure is found at once.
+	Optionally, as a latency knob, the uncovered area is cut into horizontal bands and each frame
+	seeds one band in redetectPeriod; new structure is then found within redetectPeriod frames.
+	A frame without previous segments seeds everywhere. Anchor extraction and initLinkWorkspace
+	are done over the whole frame by the caller. */
+	struct TrackingState
+	{
+		// half width in pixel of the corridor around a predicted segment.
+		float corridorWidth = 3.0f;
+
+		// height in pixel of a re-detect band, and number of frames to cycle all bands;
+		// 1 seeds every uncovered group each frame, greater values trade detection delay for linking time
+		int redetectBand = 64;
+		int redetectPeriod = 1;
+
+		// frames processed, selects the re-detect bands
+		int frameIndex = 0;
+
+		// segments of previous frame, updated after each frame.
+		LineSegList prevSegments;
+
+		// linking buffers, reused across frames of the same size
+		LinkWorkspace ws;
+
+		// statistics of the last frame
+		int numTracked = 0;		// previous segments re-confirmed
+		int numLost = 0;		// previous segments not found in their corridor
+		int numNewSeeds = 0;	// groups seeded out of the corridors
+	};
+
+
+	/* @brief Detect line segments, seeded by segments of previous frame.
+	* @param H: 3x3 homography predicting previous frame to current one, identity if empty. */
+	extern
+	void detectTracked(
+		const GradientInfo* pGradInfo,
+		const PixelList&    alignedAnchors,
+		const PixelList&    edAnchors,
+		TrackingState&      state,
+		const cv::Mat&      H,
+		LineSegList&        lineSegments,
+		LineSegList&        candidateSegments,
+		const LinkParams&   params = LinkParams()
+	);
+}
+
+
+#endif // !__TRACKING_HPP__
@@ -1,4 +1,5 @@
 #include "utilities.hpp"
+#include "gradpolicy.hpp"
 
 
 /* @brief Calculate gradient information. */
@@ -28,6 +29,9 @@ bool calcGradInfo(
 		break;
 	}
 
+	// a successor map of previous magnitudes is stale
+	gradInfo->successors.release();
+
 	// calculate gradient
 	cv::filter2D(src, gradInfo->gradx, CV_32F, kx, anchor, 0.0, cv::BORDER_REPLICATE);
 	cv::filter2D(src, gradInfo->grady, CV_32F, ky, anchor, 0.0, cv::BORDER_REPLICATE);
@@ -43,6 +47,56 @@ bool calcGradInfo(
 }
 
 
+/* @brief Calculate gradient information from a raw buffer, which is only read.
+Gray input without blur is filtered in place of the caller's buffer, 
+otherwise the conversion and blur write to internal buffers. */
+bool calcGradInfo(
+	const RawImageView& src,
+	GradientInfo*       pGradInfo,
+	int                 kernelType,
+	int                 blurSize,
+	double              blurSigma
+)
+{
+	if (!src.isValid() || pGradInfo == nullptr)
+		return false;
+
+	const cv::Mat view = wrapImageView(src);
+
+	cv::Mat gray;
+	switch (src.format)
+	{
+	case PIX_GRAY8:
+		gray = view;
+		break;
+	case PIX_BGR8:
+		cv::cvtColor(view, gray, cv::COLOR_BGR2GRAY);
+		break;
+	case PIX_RGB8:
+		cv::cvtColor(view, gray, cv::COLOR_RGB2GRAY);
+		break;
+	case PIX_BGRA8:
+		cv::cvtColor(view, gray, cv::COLOR_BGRA2GRAY);
+		break;
+	case PIX_RGBA8:
+		cv::cvtColor(view, gray, cv::COLOR_RGBA2GRAY);
+		break;
+	default:
+		return false;
+	}
+
+	// the specialized gradient stage is selected once per frame, see gradpolicy.hpp
+	if (blurSize <= 1)
+		return calcGradInfoFused(gray, pGradInfo, kernelType);
+
+	// never blur in place, gray may share the caller's buffer
+	cv::Mat blurred;
+	cv::GaussianBlur(gray, blurred, cv::Size(blurSize, blurSize), blurSigma);
+
+	return calcGradInfoFused(blurred, pGradInfo, kernelType);
+}
+
+
 /* @brief Canny Non-maximal suppress. */
 void NMS(
 	const GradientInfo* pGradInfo,
@@ -52,137 +106,112 @@ void NMS(
 	anchorPixels.clear();
 
 	auto& gradx = pGradInfo->gradx;
-	auto& grady = pGradInfo->grady;
-	auto& mag = pGradInfo->mag;
-	auto& ori = pGradInfo->ori;
-	
-	if (gradx.size != grady.size)
-		return;
 
-	Pixel px1, px2, px3, px4;	// for NMS interpolate
+	NMS(pGradInfo, cv::Rect(0, 0, gradx.cols, gradx.rows), anchorPixels);
 
-	for (int row = 1; row < gradx.rows - 1; ++row)
-	{
-		for (int col = 1; col < gradx.cols - 1; ++col)
-		{
-			const auto& currGx  = gradx.ptr<float>(row)[col];
-			const auto& currGy  = grady.ptr<float>(row)[col];
-			const auto& currMag = mag.ptr<float>(row)[col];
-			const auto& currOri = ori.ptr<float>(row)[col];
+	return;
+}
 
-			if (currOri < 45.0)
-			{
-				px1.y = row - 1, px1.x = col - 1;
-				px3.y = row + 1, px3.x = col + 1;
-				px2.y = row, px2.x = col - 1;
-				px4.y = row, px4.x = col + 1;
-			}
-			else if (currOri >= 45.0 && currOri < 90.0)
-			{
-				px1.y = row - 1, px1.x = col - 1;
-				px3.y = row + 1, px3.x = col + 1;
-				px2.y = row - 1, px2.x = col;
-				px4.y = row + 1, px4.x = col;
-			}
-			else if (currOri >= 90.0 && currOri < 135.0)
-			{
-				px1.y = row - 1, px1.x = col + 1;
-				px3.y = row + 1, px3.x = col - 1;
-				px2.y = row - 1, px2.x = col;
-				px4.y = row + 1, px4.x = col;
-			}
-			else
-			{
-				px1.y = row + 1, px1.x = col - 1;
-				px3.y = row - 1, px3.x = col + 1;
-				px2.y = row, px2.x = col - 1;
-				px4.y = row, px4.x = col + 1;
-			}
 
-			float w = (currOri >= 45.0 && currOri < 135.0) ? 
-				std::abs(currGx / currGy) : std::abs(currGy / currGx);
+/* @brief Canny non-maximal suppress inside the region, appending to the output. */
+void NMS(
+	const GradientInfo* pGradInfo,
+	const cv::Rect&     roi,
+	PixelList&          anchorPixels
+)
+{
+	if (pGradInfo->gradx.size != pGradInfo->grady.size)
+		return;
 
-			float temp1 = w * mag.ptr<float>(px1.y)[int(px1.x)] + 
-				(1 - w) * mag.ptr<float>(px2.y)[int(px2.x)];
+	const GradientView view(pGradInfo);
+	auto& gradx = view.gradx;
+	auto& grady = view.grady;
+	auto& mag = view.mag;
+	auto& ori = view.ori;
+
+	// border pixels have no complete neighborhood
+	int rowBeg = MAX(1, roi.y), rowEnd = MIN(gradx.height - 1, roi.y + roi.height);
+	int colBeg = MAX(1, roi.x), colEnd = MIN(gradx.width - 1, roi.x + roi.width);
+	if (rowBeg >= rowEnd || colBeg >= colEnd)
+		return;
 
-			float temp2 = w * mag.ptr<float>(px3.y)[int(px3.x)] +
-				(1 - w) * mag.ptr<float>(px4.y)[int(px4.x)];
+	const int width = colEnd - colBeg, height = rowEnd - rowBeg;
 
-			if (currMag > temp1 && currMag > temp2)
+	// 1. Flag local maxima, rows in parallel. The neighbors and the weight of each
+	// orientation are selected without branches, so the inner loop vectorizes.
+	std::vector<uint8_t> flags(size_t(width) * height);
+	std::vector<int> offsets(height + 1, 0);
+
+	cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+		for (int i = range.start; i != range.end; ++i)
+		{
+			int row = rowBeg + i;
+			const float* m0 = mag.row(row - 1);
+			const float* m1 = mag.row(row);
+			const float* m2 = mag.row(row + 1);
+			const float* gxPtr = gradx.row(row);
+			const float* gyPtr = grady.row(row);
+			const float* oriPtr = ori.row(row);
+			uint8_t* flag = flags.data() + size_t(i) * width;
+
+			for (int j = 0; j != width; ++j)
 			{
-				anchorPixels.emplace_back(col, row, currMag);
-			}
-		}
-	}
-	return;
-}
+				int col = colBeg + j;
+				float currOri = oriPtr[col];
 
+				bool isOri0 = currOri < 45.0f;
+				bool isOri45 = currOri >= 45.0f && currOri < 90.0f;
+				bool isOri90 = currOri >= 90.0f && currOri < 135.0f;
+				bool isSteep = isOri45 || isOri90;
 
-/*@brief Returns the line pixels using the Bresenham Algorithm:
- * https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm */
-void bresenham(
-	const Pixel& px0, 
-	const Pixel& px1, 
-	PixelList& pixels
-) 
-{
-	pixels.clear();
+				// px1/px3 on the diagonal, px2/px4 on the axis, as in the scalar cases
+				float mag1 = isOri0 || isOri45 ? m0[col - 1] : isOri90 ? m0[col + 1] : m2[col - 1];
+				float mag3 = isOri0 || isOri45 ? m2[col + 1] : isOri90 ? m2[col - 1] : m0[col + 1];
+				float mag2 = isSteep ? m0[col] : m1[col - 1];
+				float mag4 = isSteep ? m2[col] : m1[col + 1];
 
-	int x0 = px0.round().x;
-	int y0 = px0.round().y;
+				float w = std::abs(isSteep ? gxPtr[col] / gyPtr[col] : gyPtr[col] / gxPtr[col]);
 
-	int x1 = px1.round().x;
-	int y1 = px1.round().y;
+				float temp1 = w * mag1 + (1 - w) * mag2;
+				float temp2 = w * mag3 + (1 - w) * mag4;
 
-	int dx = x1 - x0, dy = y1 - y0;
-	int p = 0, x = x0, y = y0; 
+				flag[j] = m1[col] > temp1 && m1[col] > temp2;
+			}
 
-	// Determine the line direction
-	int xIncrement = dx < 0 ? -1 : +1;
-	int yIncrement = dy < 0 ? -1 : +1;
+			int count = 0;
+			for (int j = 0; j != width; ++j)
+				count += flag[j];
+			offsets[i + 1] = count;
+		}
+	});
 
-	dx = std::abs(dx);
-	dy = std::abs(dy);
+	// 2. Stable compaction, anchors stay in row-major order.
+	for (int i = 0; i != height; ++i)
+		offsets[i + 1] += offsets[i];
 
-	if (dx >= dy) {
-		// Horizontal like line
-		p = 2 * dy - dx;
-		while (x != x1) {
-			pixels.emplace_back(x, y);
-			if (p >= 0) {
-				y += yIncrement;
-				p += 2 * dy - 2 * dx;
-			}
-			else {
-				p += 2 * dy;
-			}
-			// Increment the axis in which we are moving
-			x += xIncrement;
-		}  // End of while
-	}
-	else {
-		// Vertical like line
-		p = 2 * dx - dy;
-		while (y != y1) {
-			pixels.emplace_back(x, y);
-			if (p >= 0) {
-				x += xIncrement;
-				p += +2 * dx - 2 * dy;
-			}
-			else {
-				p += 2 * dx;
+	size_t base = anchorPixels.size();
+	anchorPixels.resize(base + offsets[height]);
+
+	cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+		for (int i = range.start; i != range.end; ++i)
+		{
+			int row = rowBeg + i;
+			const float* magPtr = mag.row(row);
+			const uint8_t* flag = flags.data() + size_t(i) * width;
+			Pixel* out = anchorPixels.data() + base + offsets[i];
+
+			for (int j = 0; j != width; ++j)
+			{
+				if (flag[j])
+					*out++ = Pixel(colBeg + j, row, magPtr[colBeg + j]);
 			}
-			// Increment the axis in which we are moving
-			y += yIncrement;
-		}  // End of while
-	}
+		}
+	});
 
-	pixels.emplace_back(x1, y1);
 	return;
 }
 
 
-
 /* @brief Number of False Alarm(NFA). */
 bool NFA(
 	const cv::Mat&     src,
@@ -225,17 +254,12 @@ bool NFA(
 
 
 
-/* @brief Return a bounding rectangle of the point-set. */
-cv::Rect pointsBoundingRect(
-	const cv::Size&               size,
-	const std::vector<cv::Point>& points
+/* @brief Grow a bounding rectangle by 1 pixel, inside the image. */
+static cv::Rect expandBoundingRect(
+	const cv::Size& size,
+	cv::Rect        rect
 )
 {
-	if (points.size() < 2)
-		return cv::Rect();
-
-	cv::Rect rect = cv::boundingRect(points);
-	
 	rect.x = MAX(0, rect.x - 1);
 	rect.y = MAX(0, rect.y - 1);
 	
@@ -248,20 +272,36 @@ cv::Rect pointsBoundingRect(
 }
 
 
+/* @brief Return a bounding rectangle of the point-set. */
+cv::Rect pointsBoundingRect(
+	const cv::Size&               size,
+	const std::vector<cv::Point>& points
+)
+{
+	if (points.size() < 2)
+		return cv::Rect();
+
+	return expandBoundingRect(size, cv::boundingRect(points));
+}
+
+
 /* @brief Return a bounding rectangle of the line segment. */
 cv::Rect segmentBoundingRect(
 	const cv::Size&    size,
 	const LineSegment& segment
 )
 {
-	PixelList pixels;
-	bresenham(segment.begPx, segment.endPx, pixels);
+	// Bresenham pixels run from one rounded end-point to the other,
+	// so they span the same rectangle and need not be built
+	cv::Point pt0 = segment.begPx.round().point();
+	cv::Point pt1 = segment.endPx.round().point();
+	if (pt0 == pt1)
+		return cv::Rect();	// a single pixel
 
-	std::vector<cv::Point> points;
-	for (const auto& px : pixels)
-		points.emplace_back(px.point());
+	cv::Rect rect(cv::Point(MIN(pt0.x, pt1.x), MIN(pt0.y, pt1.y)),
+		cv::Point(MAX(pt0.x, pt1.x) + 1, MAX(pt0.y, pt1.y) + 1));
 
-	return pointsBoundingRect(size, points);
+	return expandBoundingRect(size, rect);
 }
 
 
@@ -7,6 +7,8 @@
 #include <limits.h>
 #include <math.h>
 #include "segments.hpp"
+#include "imageview.hpp"
+#include "arena.hpp"
 
 
 constexpr double MIN_GRAD_THRESH = 5.22;	// According to LSD, we choose angle-tolerance = 22.5 degree, and p = 1/8.
@@ -27,11 +29,28 @@ struct GradientInfo
 	cv::Mat grady;
 	cv::Mat mag;
 	cv::Mat ori;
+	cv::Mat successors;	// optional, see AED::calcSuccessorMap
 };
 
 typedef std::shared_ptr<GradientInfo> GradientInfoPtr;
 
 
+/* @brief Typed views of the gradient maps, built once per frame for the inner loops. */
+struct GradientView
+{
+	ImageView<const float>    gradx;
+	ImageView<const float>    grady;
+	ImageView<const float>    mag;
+	ImageView<const float>    ori;
+	ImageView<const uint16_t> successors;	// empty without a successor map
+
+	GradientView() = default;
+	explicit GradientView(const GradientInfo* pGradInfo) :
+		gradx(pGradInfo->gradx), grady(pGradInfo->grady), mag(pGradInfo->mag),
+		ori(pGradInfo->ori), successors(pGradInfo->successors) { }
+};
+
+
 /* @brief Return cv::Vec4f line angle, its range is in [-pi/2, pi/2] or [-90, 90]. */
 inline
 float lineAngle(const cv::Vec4f& _line, bool isDegree = true)
@@ -133,6 +152,22 @@ T& atPixel(cv::Mat& src, const cv::Point& pt)
 }
 
 
+/* @brief Visit the given pixel in a view. */
+template <typename T = float, typename V>
+T atPixel(const ImageView<V>& view, const Pixel& px)
+{
+	return view(int(px.x), int(px.y));
+}
+
+
+/* @brief Visit the given point in a view. */
+template <typename T = float, typename V>
+T atPixel(const ImageView<V>& view, const cv::Point& pt)
+{
+	return view(pt);
+}
+
+
 /* @brief Calculate magnitude-map from input gradient-map. */
 template <typename T = float>
 bool calcMagnitude(
@@ -152,17 +187,22 @@ bool calcMagnitude(
 	
 	mag = cv::Mat_<T>::zeros(gradx.rows, gradx.cols);
 	
-	size_t sz = gradx.rows * gradx.cols;
-	const T* ptrX = (const T*)gradx.ptr();
-	const T* ptrY = (const T*)grady.ptr();
+	const ImageView<const T> viewX(gradx), viewY(grady);
+	const ImageView<T> viewMag(mag);
 
-	for (size_t i = 0; i != sz; ++i)
+	for (int y = 0; y != viewMag.height; ++y)
 	{
-		mag.ptr<T>()[i] = useL1 ? std::abs(ptrX[i]) + std::abs(ptrY[i]) :
-			std::sqrt(ptrX[i] * ptrX[i] + ptrY[i] * ptrY[i]);
+		const T* ptrX = viewX.row(y);
+		const T* ptrY = viewY.row(y);
+		T* ptrMag = viewMag.row(y);
 
-		if (mag.ptr<T>()[i] < MIN_GRAD_THRESH)
-			mag.ptr<T>()[i] = 0;
+		for (int x = 0; x != viewMag.width; ++x)
+		{
+			T val = useL1 ? std::abs(ptrX[x]) + std::abs(ptrY[x]) :
+				std::sqrt(ptrX[x] * ptrX[x] + ptrY[x] * ptrY[x]);
+
+			ptrMag[x] = val < MIN_GRAD_THRESH ? T(0) : val;
+		}
 	}
 
 	return true;
@@ -188,17 +228,23 @@ bool calcOrientation(
 	
 	ori = cv::Mat_<T>::zeros(gradx.rows, gradx.cols);
 
-	size_t sz = gradx.rows * gradx.cols;
-	const T* ptrX = (const T*)gradx.ptr();
-	const T* ptrY = (const T*)grady.ptr();
+	const ImageView<const T> viewX(gradx), viewY(grady);
+	const ImageView<T> viewOri(ori);
 
-	for (size_t i = 0; i != sz; ++i)
+	for (int y = 0; y != viewOri.height; ++y)
 	{
-		auto& ref = ori.ptr<T>()[i];
-		if (ptrX[i] < 0 && ptrY[i] < 0 || ptrX[i] > 0 && ptrY[i] < 0)
-			ref = std::atan2(-ptrY[i], -ptrX[i]) * 180.0 / CV_PI;
-		else
-			ref = std::atan2(ptrY[i], ptrX[i]) * 180.0 / CV_PI;
+		const T* ptrX = viewX.row(y);
+		const T* ptrY = viewY.row(y);
+		T* ptrOri = viewOri.row(y);
+
+		for (int x = 0; x != viewOri.width; ++x)
+		{
+			// negative y is flipped to the other half-plane, the range is [0, 180]
+			bool isFlip = ptrY[x] < 0 && ptrX[x] != 0;
+			T gx = isFlip ? -ptrX[x] : ptrX[x];
+			T gy = isFlip ? -ptrY[x] : ptrY[x];
+			ptrOri[x] = std::atan2(gy, gx) * 180.0 / CV_PI;
+		}
 	}
 	
 	return true;
@@ -221,22 +267,25 @@ bool getMeanStd(
 	if (!checkRect(src.size(), rect))
 		return false;
 
-	cv::Mat roi = src(rect).clone();
-
-	size_t sz = rect.width * rect.height;
-	T* ptr = (T*)roi.ptr<T>();
+	// rows of the region in place, no copy
+	const ImageView<const T> view(src);
+	size_t sz = size_t(rect.width) * rect.height;
 
 	mean = 0.0;
-	for (size_t i = 0; i != sz; ++i)
+	for (int y = rect.y; y != rect.y + rect.height; ++y)
 	{
-		mean += ptr[i];
+		const T* ptr = view.row(y) + rect.x;
+		for (int x = 0; x != rect.width; ++x)
+			mean += ptr[x];
 	}
 	mean /= sz;
 	
 	std = 0.0;
-	for (size_t i = 0; i != sz; ++i)
+	for (int y = rect.y; y != rect.y + rect.height; ++y)
 	{
-		std += 1.0 * (ptr[i] - mean) * (ptr[i] - mean);
+		const T* ptr = view.row(y) + rect.x;
+		for (int x = 0; x != rect.width; ++x)
+			std += 1.0 * (ptr[x] - mean) * (ptr[x] - mean);
 	}
 	std = std::sqrt(std / sz);
 
@@ -245,11 +294,11 @@ bool getMeanStd(
 
 
 /* @brief Calculate Kurtosis. */
-template <typename T>
+template <typename T, typename Alloc = std::allocator<T>>
 double kurtosis(
-	const std::vector<T>& data,
-	double                mean,
-	double                std
+	const std::vector<T, Alloc>& data,
+	double                       mean,
+	double                       std
 )
 {
 	assert(!data.empty());
@@ -266,11 +315,11 @@ double kurtosis(
 
 
 /* @brief Calculate Kurtosis. */
-template <typename T>
+template <typename T, typename Alloc = std::allocator<T>>
 double skewness(
-	const std::vector<T>& data,
-	double                mean,
-	double                std
+	const std::vector<T, Alloc>& data,
+	double                       mean,
+	double                       std
 )
 {
 	assert(!data.empty() && std > 0);
@@ -294,6 +343,18 @@ bool calcGradInfo(
 );
 
 
+/* @brief Calculate gradient information from a raw buffer, which is only read.
+* @param blurSize: kernel size of Gaussian blur before gradient, no blur if <= 1. */
+extern
+bool calcGradInfo(
+	const RawImageView& src,
+	GradientInfo*       pGradInfo,
+	int                 kernelType = 0,
+	int                 blurSize = 5,
+	double              blurSigma = 1.0
+);
+
+
 /* @brief Canny non-maximal suppress. */
 extern 
 void NMS(
@@ -302,14 +363,82 @@ void NMS(
 );
 
 
+/* @brief Canny non-maximal suppress inside the region, appending to the output. */
+extern
+void NMS(
+	const GradientInfo* pGradInfo,
+	const cv::Rect&     roi,
+	PixelList&          anchorPixels
+);
+
+
 /* @brief Returns the line pixels using the Bresenham Algorithm:
- * https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm */
-extern 
+ * https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
+The list may use any allocator, e.g. ArenaVector<Pixel> for per-frame scratch. */
+template <typename Alloc>
 void bresenham(
-	const Pixel& px0,
-	const Pixel& px1,
-	PixelList& pixels
-);
+	const Pixel&               px0,
+	const Pixel&               px1,
+	std::vector<Pixel, Alloc>& pixels
+)
+{
+	pixels.clear();
+
+	int x0 = px0.round().x;
+	int y0 = px0.round().y;
+
+	int x1 = px1.round().x;
+	int y1 = px1.round().y;
+
+	int dx = x1 - x0, dy = y1 - y0;
+	int p = 0, x = x0, y = y0; 
+
+	// Determine the line direction
+	int xIncrement = dx < 0 ? -1 : +1;
+	int yIncrement = dy < 0 ? -1 : +1;
+
+	dx = std::abs(dx);
+	dy = std::abs(dy);
+
+	// the pixels are known in advance, one allocation at most
+	pixels.reserve(size_t(MAX(dx, dy)) + 1);
+
+	if (dx >= dy) {
+		// Horizontal like line
+		p = 2 * dy - dx;
+		while (x != x1) {
+			pixels.emplace_back(x, y);
+			if (p >= 0) {
+				y += yIncrement;
+				p += 2 * dy - 2 * dx;
+			}
+			else {
+				p += 2 * dy;
+			}
+			// Increment the axis in which we are moving
+			x += xIncrement;
+		}  // End of while
+	}
+	else {
+		// Vertical like line
+		p = 2 * dx - dy;
+		while (y != y1) {
+			pixels.emplace_back(x, y);
+			if (p >= 0) {
+				x += xIncrement;
+				p += +2 * dx - 2 * dy;
+			}
+			else {
+				p += 2 * dx;
+			}
+			// Increment the axis in which we are moving
+			y += yIncrement;
+		}  // End of while
+	}
+
+	pixels.emplace_back(x1, y1);
+	return;
+}
 
 
 /* @brief Return a bounding rectangle of the point-set. */